@@ -1,15 +1,12 @@
 #version 410 core
 
-//out vec4 FragColor;
-layout (location = 0) out vec4 gPosition;
-layout (location = 1) out vec4 gAlbedoSpec;
+// The position isn't stored, the light pass reconstructs it from the screen coordinates
+layout (location = 0) out vec4 gAlbedoSpec;
 
 in vec4 Color;
 in vec2 TexCoord;
 in float TexIndex;
 
-in vec4 fragPos;
-
 // Texture samplers
 uniform sampler2D textures[16];
 
@@ -74,6 +71,11 @@ void main()
             break;
     }
 
-    gPosition = fragPos;
+    // The transparent pixels mustn't write the depth, or they would hide the sprites behind them
+    if (fragColor.a < 0.01)
+    {
+        discard;
+    }
+
     gAlbedoSpec = fragColor;
 }
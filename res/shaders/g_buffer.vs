@@ -1,27 +1,57 @@
 #version 410 core
 
-layout (location = 0) in vec2 aPos;
+layout (location = 0) in vec3 aPos; // z is the depth of the layer and the order
 layout (location = 1) in vec4 aColor;
 layout (location = 2) in vec2 aTexCoord;
 layout (location = 3) in float aTexIndex;
+layout (location = 4) in vec4 aAnimation; // animation ID or -1, start time, corner
+layout (location = 5) in vec4 aUvTransform; // pixels to texture coordinates: offset, scale
 
 out vec4 Color;
 out vec2 TexCoord;
 out float TexIndex;
 
-out vec4 fragPos;
-
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// The frame tables of SpriteAnimationTable: the header (frame count, duration), then (rect) and (end time) per frame
+uniform samplerBuffer animationFrames;
+uniform float animationTime;
+
+vec2 animateTexCoord()
+{
+    int base = int(aAnimation.x + 0.5);
+    vec4 header = texelFetch(animationFrames, base);
+    int frameCount = int(header.x + 0.5);
+
+    float time = header.y > 0.0 ? mod(animationTime - aAnimation.y, header.y) : 0.0;
+
+    int frame = frameCount - 1;
+    for (int i = 0; i < frameCount; i++)
+    {
+        if (time < texelFetch(animationFrames, base + 2 + 2 * i).x)
+        {
+            frame = i;
+            break;
+        }
+    }
+
+    vec4 rect = texelFetch(animationFrames, base + 1 + 2 * frame);
+
+    // The same as prepareRect in SpriteBatch.cpp
+    rect.xy += sign(rect.zw) * 0.5;
+    rect.zw = sign(rect.zw) * (abs(rect.zw) - 1.0);
+
+    vec2 pixel = rect.xy + rect.zw * aAnimation.zw;
+    return aUvTransform.xy + pixel * aUvTransform.zw;
+}
+
 void main()
 {
-    vec4 worldPos = model * vec4(aPos, 0, 1);
-    gl_Position = projection * view * worldPos;
-    fragPos = vec4(worldPos.xyz, 1);
+    gl_Position = projection * view * model * vec4(aPos, 1);
 
     Color = aColor;
-    TexCoord = vec2(aTexCoord.x, aTexCoord.y);
+    TexCoord = aAnimation.x >= 0.0 ? animateTexCoord() : vec2(aTexCoord.x, aTexCoord.y);
     TexIndex = aTexIndex;
 }
@@ -0,0 +1,34 @@
+#version 410 core
+
+// The position isn't stored, the light pass reconstructs it from the screen coordinates
+layout (location = 0) out vec4 gAlbedoSpec;
+
+in vec4 Color;
+in vec2 TexCoord;
+in float TexIndex;
+
+// All sprite sheets are layers of one array texture, so there is nothing to choose from
+uniform sampler2DArray textureArray;
+
+// Must be the same as MaxTextures in SpriteBatch.h
+const int MAX_TEXTURES = 16;
+
+void main()
+{
+    int index = int(TexIndex + 0.5);
+
+    // Smaller indices are usual textures, in this mode it can only be the empty (white) one
+    vec4 fragColor = Color;
+    if (index >= MAX_TEXTURES)
+    {
+        fragColor *= texture(textureArray, vec3(TexCoord, float(index - MAX_TEXTURES)));
+    }
+
+    // The transparent pixels mustn't write the depth, or they would hide the sprites behind them
+    if (fragColor.a < 0.01)
+    {
+        discard;
+    }
+
+    gAlbedoSpec = fragColor;
+}
@@ -4,14 +4,12 @@ out vec4 FragColor;
 
 in vec2 texCoords;
 
-uniform sampler2D gPosition;
 uniform sampler2D gAlbedoSpec;
 
 uniform float brightness;
 
 void main() {
     // Retrieve data from g-buffer
-    vec2 fragPos = texture(gPosition, texCoords).rg;
     vec3 diffuse = texture(gAlbedoSpec, texCoords).rgb;
 
     vec3 nightColor = vec3(0.1, 0.1, 0.25);
@@ -4,9 +4,12 @@ out vec4 FragColor;
 
 in vec2 texCoords;
 
-uniform sampler2D gPosition;
 uniform sampler2D gAlbedoSpec;
 
+// Used to get the world position of the fragment back from gl_FragCoord
+uniform mat4 invViewProjection;
+uniform vec2 screenSize;
+
 struct Light {
     vec2 pos;
     vec3 color;
@@ -18,8 +21,11 @@ struct Light {
 uniform Light light;
 
 void main() {
+    // The camera is orthographic, so w is always 1 and the depth doesn't matter
+    vec2 ndc = gl_FragCoord.xy / screenSize * 2.0 - 1.0;
+    vec2 fragPos = (invViewProjection * vec4(ndc, 0.0, 1.0)).xy;
+
     // Retrieve data from g-buffer
-    vec2 fragPos = texture(gPosition, texCoords).rg;
     vec3 diffuse = texture(gAlbedoSpec, texCoords).rgb;
 
     float distance = distance(fragPos, light.pos);
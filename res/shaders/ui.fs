@@ -6,8 +6,15 @@ in vec4 Color;
 in vec2 TexCoord;
 in float TexIndex;
 
-// Texture samplers
-uniform sampler2D textures[16];
+// Texture samplers, one less than MAX_TEXTURES, with the array it's the 16 samplers macOS allows.
+// Must be the same as MaxBoundTextures in SpriteBatch.h
+uniform sampler2D textures[15];
+
+// The sprite sheets, the indices from MAX_TEXTURES are its layers
+uniform sampler2DArray textureArray;
+
+// Must be the same as MaxTextures in SpriteBatch.h
+const int MAX_TEXTURES = 16;
 
 void main()
 {
@@ -16,7 +23,12 @@ void main()
     //int index = int(TexIndex);
     //FragColor = texture(textures[index], TexCoord) * Color;
     // So we have to do this scary thing 👍
-    int index = int(TexIndex);
+    int index = int(TexIndex + 0.5);
+    if (index >= MAX_TEXTURES)
+    {
+        FragColor = texture(textureArray, vec3(TexCoord, float(index - MAX_TEXTURES))) * Color;
+        return;
+    }
     switch (index) {
         case 0:
             FragColor = texture(textures[0], TexCoord) * Color;
@@ -63,8 +75,5 @@ void main()
         case 14:
             FragColor = texture(textures[14], TexCoord) * Color;
             break;
-        case 15:
-            FragColor = texture(textures[15], TexCoord) * Color;
-            break;
     }
 }
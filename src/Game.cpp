@@ -11,6 +11,7 @@
 #include "systems/render/ui/ButtonRenderSystem.h"
 #include "systems/render/TextRenderSystem.h"
 #include "systems/animation/SpriteAnimatorSystem.h"
+#include "client/graphics/SpriteAnimationTable.h"
 #include "systems/audio/AudioSystem.h"
 
 #include "scene/Entity.h"
@@ -24,6 +25,7 @@
 #include "components/physics/RectColliderComponent.h"
 #include "components/physics/RigidbodyComponent.h"
 #include "components/render/AutoOrderComponent.h"
+#include "components/render/StaticSpriteComponent.h"
 #include "components/world/HpComponent.h"
 #include "components/render/ui/ButtonComponent.h"
 #include "components/world/ItemComponent.h"
@@ -47,14 +49,17 @@
 #include "systems/world/ClockSystem.h"
 #include "components/world/EnvironmentComponent.h"
 #include "systems/world/EnvironmentSystem.h"
+#include "client/Engine.h"
+#include "client/assets/AssetCache.h"
 
 Game::Game()
-    : m_font(TRUERPG_RES_DIR "/fonts/vt323.ttf", 32),
-      m_heroTexture(Texture::create(TRUERPG_RES_DIR "/textures/hero.png")),
-      m_baseTexture(Texture::create(TRUERPG_RES_DIR "/textures/base.png")),
-      m_steps(TRUERPG_RES_DIR "/audio/steps.mp3"),
-      m_music(TRUERPG_RES_DIR "/audio/music.mp3"),
-      m_night(TRUERPG_RES_DIR "/audio/night.mp3")
+    : m_font(Engine::getAssetCache().loadFont(TRUERPG_RES_DIR "/fonts/vt323.ttf", 32)),
+      m_spriteSheets(Engine::getAssetCache().loadTextureArray({TRUERPG_RES_DIR "/textures/hero.png", TRUERPG_RES_DIR "/textures/base.png"})),
+      m_heroTexture(m_spriteSheets->getTexture(TRUERPG_RES_DIR "/textures/hero.png")),
+      m_baseTexture(m_spriteSheets->getTexture(TRUERPG_RES_DIR "/textures/base.png")),
+      m_steps(Engine::getAssetCache().loadAudioClip(TRUERPG_RES_DIR "/audio/steps.mp3")),
+      m_music(Engine::getAssetCache().loadAudioClip(TRUERPG_RES_DIR "/audio/music.mp3")),
+      m_night(Engine::getAssetCache().loadAudioClip(TRUERPG_RES_DIR "/audio/night.mp3"))
 {
     // Add systems
     m_scene.addSystem<ClockSystem>();
@@ -66,6 +71,7 @@ Game::Game()
 
     // Render systems
     auto& renderSystem = m_scene.addSystem<RenderSystem>();
+    renderSystem.setTextureArrayMode(true);
     renderSystem.addSubsystem<WorldMapRenderSystem>();
     renderSystem.addSubsystem<SpriteRenderSystem>();
 
@@ -99,7 +105,7 @@ Game::Game()
     // Button
     Entity buttonEntity = m_scene.createEntity("button");
     buttonEntity.getComponent<TransformComponent>().position = {100.f, 100.f};
-    auto &button = buttonEntity.addComponent<ButtonComponent>(&m_font, "test");
+    auto &button = buttonEntity.addComponent<ButtonComponent>(m_font.get(), "test");
     button.onClick = [] {
         std::cout << "button was pressed!" << std::endl;
     };
@@ -111,7 +117,7 @@ Game::Game()
 
     // Create an FPS counter
     Entity debugInfoEntity = m_scene.createEntity("debugInfo");
-    auto &debugText = debugInfoEntity.addComponent<TextRendererComponent>(&m_font, "");
+    auto &debugText = debugInfoEntity.addComponent<TextRendererComponent>(m_font.get(), "");
     debugText.layer = 10;
     auto &fpsTransform = debugInfoEntity.getComponent<TransformComponent>();
     fpsTransform.scale = glm::vec2(0.8f, 0.8f);
@@ -137,9 +143,10 @@ Game::Game()
     heroTransform.origin = glm::vec2(16, 0);
 
     auto stepsSoundEntity = m_scene.createEntity("stepsSound");
-    auto &stepsComponent = stepsSoundEntity.addComponent<AudioSourceComponent>(m_steps);
+    auto &stepsComponent = stepsSoundEntity.addComponent<AudioSourceComponent>(*m_steps);
     stepsComponent.volume = 0.25f;
     stepsComponent.loop = true;
+    stepsComponent.priority = 1; // the player's own steps must always be heard
 
     auto &playerComponent = m_playerEntity.addComponent<PlayerComponent>();
     playerComponent.sprite = spriteEntity;
@@ -152,7 +159,7 @@ Game::Game()
 
     // HP
     auto hpEntity = m_scene.createEntity("hp");
-    auto &hpRenderer = hpEntity.addComponent<TextRendererComponent>(&m_font, "HP: 100");
+    auto &hpRenderer = hpEntity.addComponent<TextRendererComponent>(m_font.get(), "HP: 100");
     hpRenderer.horizontalAlign = HorizontalAlign::Right;
     hpRenderer.verticalAlign = VerticalAlign::Top;
     hpRenderer.layer = 10;
@@ -165,7 +172,7 @@ Game::Game()
     torch.enabled = false;
 
     Entity nightAmbient = m_scene.createEntity("nightAmbient");
-    auto &nightAudio = nightAmbient.addComponent<AudioSourceComponent>(m_night);
+    auto &nightAudio = nightAmbient.addComponent<AudioSourceComponent>(*m_night);
     nightAudio.loop = true;
     nightAudio.global = true;
 
@@ -210,13 +217,15 @@ Game::Game()
     auto &pumpkinRenderer = pumpkinEntity.addComponent<SpriteRendererComponent>(m_baseTexture);
     pumpkinRenderer.textureRect = IntRect(192, 3584, 32, 32);
     pumpkinRenderer.layer = 0;
+    pumpkinRenderer.order = 1; // above the ground tiles, it doesn't depend on how the static sprites break ties
+    pumpkinEntity.addComponent<StaticSpriteComponent>();
 
     auto &pumpkinTransform = pumpkinEntity.getComponent<TransformComponent>();
     pumpkinTransform.position = glm::vec2(384.f - 32, 256.f - 32);
     pumpkinTransform.scale = glm::vec2(2.f, 2.f);
     pumpkinTransform.origin = glm::vec2(16, 16);
 
-    auto &musicComponent = pumpkinEntity.addComponent<AudioSourceComponent>(m_music);
+    auto &musicComponent = pumpkinEntity.addComponent<AudioSourceComponent>(*m_music);
     musicComponent.volume = 1.0f;
 
     auto &pumpkinLight = pumpkinEntity.addComponent<PointLightComponent>();
@@ -226,7 +235,7 @@ Game::Game()
 
     // Text setup for the pumpkin
     Entity pumpkinTextEntity = m_scene.createEntity("text");
-    auto &pumpkinTextRenderer = pumpkinTextEntity.addComponent<TextRendererComponent>(&m_font);
+    auto &pumpkinTextRenderer = pumpkinTextEntity.addComponent<TextRendererComponent>(m_font.get());
     pumpkinTextRenderer.horizontalAlign = HorizontalAlign::Center;
     pumpkinTextRenderer.layer = 10;
 
@@ -253,6 +262,9 @@ Game::Game()
 
         barrels[i].addComponent<RectColliderComponent>().size = glm::vec2(64, 32);
         auto &order = barrels[i].addComponent<AutoOrderComponent>();
+
+        // The barrels never move, so they are kept in the static buffer
+        barrels[i].addComponent<StaticSpriteComponent>();
     }
 
     // Bot
@@ -264,14 +276,15 @@ Game::Game()
     botRenderer.layer = 1;
     botSprite.addComponent<AutoOrderComponent>();
 
-    Animation::addAnimator(botSprite, &m_characterAnimator);
+    // There can be a lot of bots, their frames are picked by the GPU
+    Animation::addAnimator(botSprite, &m_characterAnimator, true);
 
     auto &botSpriteTransform = botSprite.getComponent<TransformComponent>();
     botSpriteTransform.scale = glm::vec2(2.f, 2.f);
     botSpriteTransform.origin = glm::vec2(16, 0);
 
     Entity botNameEntity = m_scene.createEntity("name");
-    auto& botTextRenderer = botNameEntity.addComponent<TextRendererComponent>(&m_font, "Bot");
+    auto& botTextRenderer = botNameEntity.addComponent<TextRendererComponent>(m_font.get(), "Bot");
     botTextRenderer.horizontalAlign = HorizontalAlign::Center;
     botTextRenderer.layer = 10;
     auto &botNameTransform = botNameEntity.getComponent<TransformComponent>();
@@ -286,6 +299,8 @@ Game::Game()
     Hierarchy::addChild(botEntity, botNameEntity);
 
     botEntity.addComponent<NativeScriptComponent>().bind<BotScript>();
+
+    Engine::getAssetCache().printStats();
 }
 
 void Game::update(float deltaTime)
@@ -296,7 +311,12 @@ void Game::update(float deltaTime)
 void Game::destroy()
 {
     m_scene.destroy();
-    m_font.destroy();
-    m_heroTexture.destroy();
-    m_baseTexture.destroy();
+
+    // Release the assets while the GL context is still alive
+    m_font.reset();
+    m_spriteSheets.reset();
+    Engine::getSpriteAnimationTable().destroy();
+    m_steps.reset();
+    m_music.reset();
+    m_night.reset();
 }
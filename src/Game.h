@@ -5,20 +5,25 @@
 #include "scene/Entity.h"
 #include "client/graphics/SpriteBatch.h"
 #include "client/graphics/Font.h"
+#include "client/graphics/TextureArray.h"
 #include "client/audio/StreamAudioClip.h"
 #include "client/audio/CachedAudioClip.h"
 #include "client/animation/SpriteAnimator.h"
 
+#include <memory>
+
 class Game
 {
-    Font m_font;
+    std::shared_ptr<Font> m_font;
+
+    std::shared_ptr<TextureArray> m_spriteSheets; // the world and the UI sample the same pages
     Texture m_heroTexture;
     Texture m_baseTexture;
     SpriteAnimator m_characterAnimator;
 
-    StreamAudioClip m_steps;
-    StreamAudioClip m_music;
-    StreamAudioClip m_night;
+    std::shared_ptr<IAudioClip> m_steps;
+    std::shared_ptr<IAudioClip> m_music;
+    std::shared_ptr<IAudioClip> m_night;
 
     Scene m_scene;
 
@@ -2,9 +2,30 @@
 #include "Engine.h"
 
 #include "window/GlfwWindow.h"
+#include "assets/AssetCache.h"
+#include "audio/AudioStreamer.h"
+#include "graphics/SpriteAnimationTable.h"
 
 IWindow &Engine::getWindow(int width, int height, const std::string &title)
 {
     static GlfwWindow window(width, height, title);
     return window;
 }
+
+AssetCache &Engine::getAssetCache()
+{
+    static AssetCache assetCache;
+    return assetCache;
+}
+
+AudioStreamer &Engine::getAudioStreamer()
+{
+    static AudioStreamer audioStreamer;
+    return audioStreamer;
+}
+
+SpriteAnimationTable &Engine::getSpriteAnimationTable()
+{
+    static SpriteAnimationTable spriteAnimationTable;
+    return spriteAnimationTable;
+}
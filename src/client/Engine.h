@@ -6,10 +6,20 @@
 #include <string>
 #include "window/IWindow.h"
 
+class AssetCache;
+class AudioStreamer;
+class SpriteAnimationTable;
+
 class Engine
 {
 public:
     static IWindow &getWindow(int width = 0, int height = 0, const std::string& title = "");
+
+    static AssetCache &getAssetCache();
+
+    static AudioStreamer &getAudioStreamer();
+
+    static SpriteAnimationTable &getSpriteAnimationTable();
 };
 
 #endif // RPG_ENGINE_H
@@ -0,0 +1,70 @@
+#ifndef RPG_ANIMATORCONTAINER_H
+#define RPG_ANIMATORCONTAINER_H
+
+#include "../../utils/Types.h"
+
+// Compiled animator container (.ranim), written to the cache the first time a YAML animator is loaded.
+// The file is mapped into memory and copied into the animator arrays as is, so the layout is plain and 4-byte aligned:
+// [RanimHeader][RanimNode x nodeCount][RanimFrame x frameCount][RanimTransition x transitionCount]
+// [RanimInstruction x instructionCount][RanimParameter x parameterCount][names]
+// The names are not null-terminated, they are referred to by their offset from the beginning of the names.
+
+#define RANIM_MAGIC 0x4d494e52 // "RNIM"
+#define RANIM_VERSION 1
+
+struct RanimHeader
+{
+    u32 magic;
+    u32 version;
+    u64 sourceHash; // the hash of the YAML file, the cache is stale if it doesn't match
+    u32 nodeCount;
+    u32 frameCount;
+    u32 transitionCount;
+    u32 instructionCount;
+    u32 parameterCount;
+    u32 namesSize;
+};
+
+struct RanimNode
+{
+    u32 nameOffset;
+    u32 nameSize;
+    u16 firstFrame;
+    u16 frameCount;
+    u16 firstTransition;
+    u16 transitionCount;
+};
+
+struct RanimFrame
+{
+    i32 left;
+    i32 bottom;
+    i32 width;
+    i32 height;
+    float duration;
+};
+
+struct RanimTransition
+{
+    u16 destination;
+    u16 firstInstruction;
+    u16 instructionCount;
+    u16 padding;
+};
+
+struct RanimInstruction
+{
+    u32 opcode;
+    u32 offset;
+    float value;
+};
+
+struct RanimParameter
+{
+    u32 nameOffset;
+    u32 nameSize;
+    u32 type;
+    u32 offset;
+};
+
+#endif // RPG_ANIMATORCONTAINER_H
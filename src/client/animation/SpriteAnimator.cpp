@@ -1,51 +1,191 @@
 #include "../../pch.h"
 #include "SpriteAnimator.h"
 
+#include <algorithm>
+
+bool SpriteAnimatorCondition::evaluate(const SpriteAnimatorInstruction *code, std::size_t size,
+                                       const SpriteAnimatorParameterStorage &storage)
+{
+    if (size == 0)
+    {
+        return true;
+    }
+
+    // The comparisons push 1 or 0, the depth was checked when the condition was compiled
+    std::array<float, SPRITE_ANIMATOR_STACK_SIZE> stack;
+    std::size_t top = 0;
+
+    for (const auto *instruction = code; instruction != code + size; ++instruction)
+    {
+        switch (instruction->opcode)
+        {
+        case SpriteAnimatorOpcode::Push:
+            stack[top++] = instruction->value;
+            break;
+        case SpriteAnimatorOpcode::Load:
+            stack[top++] = storage.values[instruction->offset];
+            break;
+        case SpriteAnimatorOpcode::Lt:
+            top--;
+            stack[top - 1] = stack[top - 1] < stack[top] ? 1.f : 0.f;
+            break;
+        case SpriteAnimatorOpcode::Gt:
+            top--;
+            stack[top - 1] = stack[top - 1] > stack[top] ? 1.f : 0.f;
+            break;
+        case SpriteAnimatorOpcode::Le:
+            top--;
+            stack[top - 1] = stack[top - 1] <= stack[top] ? 1.f : 0.f;
+            break;
+        case SpriteAnimatorOpcode::Ge:
+            top--;
+            stack[top - 1] = stack[top - 1] >= stack[top] ? 1.f : 0.f;
+            break;
+        }
+    }
+
+    return stack[0] != 0.f;
+}
+
+const SpriteAnimatorParameter *SpriteAnimator::findParameter(std::string_view name) const
+{
+    for (const auto &parameter : parameters)
+    {
+        if (parameter.name == name)
+        {
+            return &parameter;
+        }
+    }
+    return nullptr;
+}
+
+u16 SpriteAnimator::findTransition(u16 node, const SpriteAnimatorParameterStorage &storage) const
+{
+    const auto &n = nodes[node];
+    for (u16 i = n.firstTransition; i != n.firstTransition + n.transitionCount; i++)
+    {
+        const auto &transition = transitions[i];
+        if (SpriteAnimatorCondition::evaluate(&code[transition.firstInstruction], transition.instructionCount, storage))
+        {
+            return transition.destination;
+        }
+    }
+    return node;
+}
+
 SpriteAnimatorBuilder::SpriteAnimatorBuilder()
 {
-    m_animator.nodes.push_back({"entry"});
+    m_nodes.push_back({"entry"});
 }
 
 SpriteAnimatorBuilder::Node SpriteAnimatorBuilder::entry()
 {
-    return {&m_animator, &m_animator.nodes.front()};
+    return {this, SPRITE_ANIMATOR_ENTRY_NODE};
 }
 
 SpriteAnimatorBuilder::Node SpriteAnimatorBuilder::node(std::string name, std::vector<SpriteAnimationFrame> frames)
 {
-    auto *n = &m_animator.nodes.emplace_back(SpriteAnimatorNode{std::move(name), std::move(frames)});
+    auto index = static_cast<u16>(m_nodes.size());
+    m_nodes.push_back({std::move(name), {std::move(frames)}});
 
-    return {&m_animator, n};
+    return {this, index};
 }
 
 SpriteAnimatorBuilder::Parameter SpriteAnimatorBuilder::parameter(std::string name, SpriteAnimatorParameterType type)
 {
-    auto *p = &m_animator.parameters.emplace_back(SpriteAnimatorParameter{std::move(name), type});
+    // The parameters are packed one after another
+    u16 offset = m_parameterValueCount;
+    u16 size = getSpriteAnimatorParameterSize(type);
+    if (offset + size > SPRITE_ANIMATOR_MAX_PARAMETER_VALUES)
+    {
+        std::cout << "There is no room for the animator parameter " << name << std::endl;
+        offset = SPRITE_ANIMATOR_INVALID_PARAMETER;
+    }
+    else
+    {
+        m_parameterValueCount += size;
+    }
 
-    return {&m_animator, p};
+    return Parameter(m_parameters.emplace_back(SpriteAnimatorParameter{std::move(name), type, offset}));
 }
 
 SpriteAnimator SpriteAnimatorBuilder::build()
 {
-    return std::move(m_animator);
+    SpriteAnimator animator;
+    animator.parameters = std::move(m_parameters);
+
+    // The transitions are grouped by their source node, the order inside a node stays the same
+    std::stable_sort(m_transitions.begin(), m_transitions.end(),
+                     [](const PendingTransition &a, const PendingTransition &b) { return a.source < b.source; });
+
+    std::size_t frameCount = 0;
+    std::size_t codeSize = 0;
+    for (const auto &node : m_nodes)
+    {
+        frameCount += node.animation.frames.size();
+    }
+    for (const auto &transition : m_transitions)
+    {
+        codeSize += transition.condition.code.size();
+    }
+    if (m_nodes.size() > SPRITE_ANIMATOR_MAX_ITEMS || frameCount > SPRITE_ANIMATOR_MAX_ITEMS ||
+        m_transitions.size() > SPRITE_ANIMATOR_MAX_ITEMS || codeSize > SPRITE_ANIMATOR_MAX_ITEMS)
+    {
+        std::cout << "The animator is too big" << std::endl;
+        m_nodes.resize(1);
+        m_transitions.clear();
+    }
+
+    animator.nodes.reserve(m_nodes.size());
+    animator.frames.reserve(frameCount);
+    animator.transitions.reserve(m_transitions.size());
+    animator.code.reserve(codeSize);
+
+    auto transition = m_transitions.begin();
+    for (std::size_t i = 0; i < m_nodes.size(); i++)
+    {
+        auto &pending = m_nodes[i];
+
+        SpriteAnimatorNode node{std::move(pending.name)};
+        node.firstFrame = static_cast<u16>(animator.frames.size());
+        node.frameCount = static_cast<u16>(pending.animation.frames.size());
+        animator.frames.insert(animator.frames.end(), pending.animation.frames.begin(), pending.animation.frames.end());
+
+        node.firstTransition = static_cast<u16>(animator.transitions.size());
+        for (; transition != m_transitions.end() && transition->source == i; ++transition)
+        {
+            const auto &code = transition->condition.code;
+            animator.transitions.push_back({transition->destination, static_cast<u16>(animator.code.size()),
+                                            static_cast<u16>(code.size())});
+            animator.code.insert(animator.code.end(), code.begin(), code.end());
+        }
+        node.transitionCount = static_cast<u16>(animator.transitions.size() - node.firstTransition);
+
+        animator.nodes.push_back(std::move(node));
+    }
+
+    m_nodes.clear();
+    m_transitions.clear();
+
+    return animator;
 }
 
-SpriteAnimatorBuilder::Node::Node(SpriteAnimator *animator, SpriteAnimatorNode *node) :
-    m_animator(animator), m_node(node)
+SpriteAnimatorBuilder::Node::Node(SpriteAnimatorBuilder *builder, u16 node) :
+    m_builder(builder), m_node(node)
 {
 }
 
-void SpriteAnimatorBuilder::Node::transition(SpriteAnimatorBuilder::Node &destination,
-                                             std::function<bool(const SpriteAnimatorParameterStorage &)> condition)
+void SpriteAnimatorBuilder::Node::transition(SpriteAnimatorBuilder::Node &destination, SpriteAnimatorCondition condition)
 {
-    SpriteAnimatorTransition *t = &m_animator->transitions.emplace_back(
-        SpriteAnimatorTransition{m_node, destination.m_node, std::move(condition)});
+    m_builder->m_transitions.push_back({m_node, destination.m_node, std::move(condition)});
+}
 
-    m_node->fromTransitions.push_back(t);
-    destination.m_node->toTransitions.push_back(t);
+SpriteAnimatorBuilder::Parameter::Parameter(SpriteAnimatorParameter parameter) :
+    m_parameter(std::move(parameter))
+{
 }
 
-SpriteAnimatorBuilder::Parameter::Parameter(SpriteAnimator *animator, SpriteAnimatorParameter *parameter) :
-    m_animator(animator), m_parameter(parameter)
+u16 SpriteAnimatorBuilder::Parameter::getOffset() const
 {
+    return m_parameter.offset;
 }
@@ -1,48 +1,130 @@
 #ifndef RPG_SPRITEANIMATOR_HPP
 #define RPG_SPRITEANIMATOR_HPP
 
-#include <functional>
-#include <variant>
-#include <glm/vec2.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "SpriteAnimation.h"
+#include "SpriteAnimatorParameter.h"
 
-struct SpriteAnimatorNode;
+// The deepest value stack a condition can use while it's evaluated
+#define SPRITE_ANIMATOR_STACK_SIZE 8
 
-enum class SpriteAnimatorParameterType
-{
-    Vec2
-};
+// Every animator starts in this node, it has no frames and only leaves through its transitions
+#define SPRITE_ANIMATOR_ENTRY_NODE 0
+
+// An animator can't have more nodes, frames, transitions or instructions than this, they are addressed by u16
+#define SPRITE_ANIMATOR_MAX_ITEMS 0xFFFF
 
 struct SpriteAnimatorParameter
 {
     std::string name;
     SpriteAnimatorParameterType type;
+    u16 offset; // the index of the first value of the parameter in the storage
 };
 
-using SpriteAnimatorParameterVariant = std::variant<glm::vec2>;
-using SpriteAnimatorParameterStorage = std::unordered_map<std::string, SpriteAnimatorParameterVariant>;
+enum class SpriteAnimatorOpcode : u8
+{
+    Push, // push the constant
+    Load, // push the parameter value at the offset
+    Lt,
+    Gt,
+    Le,
+    Ge
+};
+
+struct SpriteAnimatorInstruction
+{
+    SpriteAnimatorOpcode opcode;
+    u16 offset; // only for Load
+    float value; // only for Push
+};
+
+/**
+ * A transition condition compiled into a flat stack program.
+ * The parameters are addressed by their offsets in the storage, so evaluating it costs only a few loads and compares.
+ * An empty program is always true.
+ */
+struct SpriteAnimatorCondition
+{
+    std::vector<SpriteAnimatorInstruction> code;
+
+    /**
+     * Evaluate a compiled condition.
+     *
+     * @param code the first instruction
+     * @param size the number of instructions
+     * @param storage the parameter values
+     * @return true if the condition is met
+     */
+    static bool evaluate(const SpriteAnimatorInstruction *code, std::size_t size,
+                         const SpriteAnimatorParameterStorage &storage);
+};
 
 struct SpriteAnimatorTransition
 {
-    SpriteAnimatorNode *source;
-    SpriteAnimatorNode *destination;
-    std::function<bool(const SpriteAnimatorParameterStorage &)> condition;
+    u16 destination; // the node index
+    u16 firstInstruction;
+    u16 instructionCount;
 };
 
 struct SpriteAnimatorNode
 {
     std::string name;
-    SpriteAnimation animation;
-    std::vector<SpriteAnimatorTransition *> fromTransitions;
-    std::vector<SpriteAnimatorTransition *> toTransitions;
+    u16 firstFrame;
+    u16 frameCount;
+    u16 firstTransition; // the transitions from the node are next to each other, in the order they are checked
+    u16 transitionCount;
 };
 
+/**
+ * A compiled animator, it's immutable and shared by all the animated entities.
+ * The nodes, the frames, the transitions and the condition code are kept in flat arrays and refer to each other
+ * by 16-bit indices, so an animator instance is only a node index, a frame index and a time.
+ */
 struct SpriteAnimator
 {
-    std::list<SpriteAnimatorNode> nodes;
-    std::list<SpriteAnimatorTransition> transitions;
-    std::list<SpriteAnimatorParameter> parameters;
+    std::vector<SpriteAnimatorNode> nodes;
+    std::vector<SpriteAnimationFrame> frames;
+    std::vector<SpriteAnimatorTransition> transitions;
+    std::vector<SpriteAnimatorInstruction> code;
+    std::vector<SpriteAnimatorParameter> parameters;
+
+    /**
+     * Find a parameter by its name.
+     *
+     * @param name the parameter name
+     * @return the parameter or nullptr if there is no such parameter
+     */
+    const SpriteAnimatorParameter *findParameter(std::string_view name) const;
+
+    /**
+     * Resolve a parameter by its name, the handle is used to set the parameter of the animator instances.
+     *
+     * @tparam T the C++ type of the parameter
+     * @param name the parameter name
+     * @return the handle, it isn't valid if there is no such parameter of this type
+     */
+    template <class T>
+    SpriteAnimatorParameterHandle<T> getParameter(std::string_view name) const
+    {
+        const auto *parameter = findParameter(name);
+        if (!parameter || parameter->type != SpriteAnimatorParameterTraits<T>::type)
+        {
+            return {};
+        }
+        return {parameter->offset};
+    }
+
+    /**
+     * Find the first transition from the node whose condition is met.
+     *
+     * @param node the node index
+     * @param storage the parameter values
+     * @return the destination node index or the given node if no condition is met
+     */
+    u16 findTransition(u16 node, const SpriteAnimatorParameterStorage &storage) const;
 };
 
 class Animation;
@@ -53,33 +135,44 @@ public:
     class Node
     {
     public:
-        void transition(Node &destination, std::function<bool(const SpriteAnimatorParameterStorage &)> condition);
+        void transition(Node &destination, SpriteAnimatorCondition condition);
 
     private:
         friend SpriteAnimatorBuilder;
 
-        SpriteAnimator *m_animator;
-        SpriteAnimatorNode *m_node;
+        SpriteAnimatorBuilder *m_builder;
+        u16 m_node;
 
-        Node(SpriteAnimator *animator, SpriteAnimatorNode *node);
+        Node(SpriteAnimatorBuilder *builder, u16 node);
     };
 
     class Parameter
     {
     public:
         template<class T>
-        const T &get(const SpriteAnimatorParameterStorage &storage) const
+        T get(const SpriteAnimatorParameterStorage &storage) const
+        {
+            return storage.get(handle<T>());
+        }
+
+        template<class T>
+        SpriteAnimatorParameterHandle<T> handle() const
         {
-            return std::get<T>(storage.at(m_parameter->name));
+            if (m_parameter.type != SpriteAnimatorParameterTraits<T>::type)
+            {
+                return {};
+            }
+            return {m_parameter.offset};
         }
 
+        u16 getOffset() const;
+
     private:
         friend SpriteAnimatorBuilder;
 
-        SpriteAnimator *m_animator;
-        SpriteAnimatorParameter *m_parameter;
+        SpriteAnimatorParameter m_parameter;
 
-        Parameter(SpriteAnimator *animator, SpriteAnimatorParameter *parameter);
+        explicit Parameter(SpriteAnimatorParameter parameter);
     };
 
     Node entry();
@@ -89,11 +182,27 @@ public:
     Parameter parameter(std::string name, SpriteAnimatorParameterType type);
 
 private:
+    struct PendingNode
+    {
+        std::string name;
+        SpriteAnimation animation;
+    };
+
+    struct PendingTransition
+    {
+        u16 source;
+        u16 destination;
+        SpriteAnimatorCondition condition;
+    };
+
     SpriteAnimatorBuilder();
 
     friend Animation;
 
-    SpriteAnimator m_animator;
+    std::vector<PendingNode> m_nodes;
+    std::vector<PendingTransition> m_transitions;
+    std::vector<SpriteAnimatorParameter> m_parameters;
+    u16 m_parameterValueCount{0};
 
     SpriteAnimator build();
 };
@@ -0,0 +1,118 @@
+#ifndef RPG_SPRITEANIMATORPARAMETER_H
+#define RPG_SPRITEANIMATORPARAMETER_H
+
+#include <array>
+#include <cstring>
+#include <glm/vec2.hpp>
+
+#include "../../utils/Types.h"
+
+// The number of floats an animator instance can keep its parameters in, a vec2 parameter takes two of them
+#define SPRITE_ANIMATOR_MAX_PARAMETER_VALUES 8
+
+// The offset of a parameter which doesn't exist
+#define SPRITE_ANIMATOR_INVALID_PARAMETER 0xFFFF
+
+enum class SpriteAnimatorParameterType
+{
+    Vec2
+};
+
+/**
+ * Describes how a parameter type is kept in the storage.
+ *
+ * @tparam T the C++ type of the parameter
+ */
+template <class T>
+struct SpriteAnimatorParameterTraits;
+
+template <>
+struct SpriteAnimatorParameterTraits<glm::vec2>
+{
+    static constexpr SpriteAnimatorParameterType type = SpriteAnimatorParameterType::Vec2;
+    static constexpr u16 size = 2;
+};
+
+/**
+ * Get the number of floats a parameter of the type takes.
+ *
+ * @param type the parameter type
+ * @return the number of floats
+ */
+constexpr u16 getSpriteAnimatorParameterSize(SpriteAnimatorParameterType type)
+{
+    switch (type)
+    {
+    case SpriteAnimatorParameterType::Vec2:
+        return SpriteAnimatorParameterTraits<glm::vec2>::size;
+    }
+    return 0;
+}
+
+/**
+ * A parameter of an animator resolved once by its name, it's used to set the parameter without looking it up.
+ * The handle is valid for every instance of the animator it was taken from.
+ *
+ * @tparam T the C++ type of the parameter
+ */
+template <class T>
+struct SpriteAnimatorParameterHandle
+{
+    u16 offset{SPRITE_ANIMATOR_INVALID_PARAMETER};
+
+    bool isValid() const
+    {
+        return offset != SPRITE_ANIMATOR_INVALID_PARAMETER;
+    }
+};
+
+/**
+ * The parameter values of one animator instance.
+ * They are kept inline as floats, every parameter starts at its offset.
+ */
+struct SpriteAnimatorParameterStorage
+{
+    std::array<float, SPRITE_ANIMATOR_MAX_PARAMETER_VALUES> values{};
+
+    // A value was changed since the transitions were checked
+    bool changed{true};
+
+    /**
+     * Set a parameter. Nothing happens if the handle isn't valid or the value is the same.
+     *
+     * @param handle the parameter handle
+     * @param value the new value
+     */
+    template <class T>
+    void set(SpriteAnimatorParameterHandle<T> handle, const T &value)
+    {
+        static_assert(sizeof(T) == SpriteAnimatorParameterTraits<T>::size * sizeof(float));
+
+        if (handle.isValid() && std::memcmp(&values[handle.offset], &value, sizeof(T)) != 0)
+        {
+            std::memcpy(&values[handle.offset], &value, sizeof(T));
+            changed = true;
+        }
+    }
+
+    /**
+     * Get a parameter.
+     *
+     * @param handle the parameter handle
+     * @return the value or the default value if the handle isn't valid
+     */
+    template <class T>
+    T get(SpriteAnimatorParameterHandle<T> handle) const
+    {
+        static_assert(sizeof(T) == SpriteAnimatorParameterTraits<T>::size * sizeof(float));
+
+        T value{};
+        if (handle.isValid())
+        {
+            std::memcpy(&value, &values[handle.offset], sizeof(T));
+        }
+        return value;
+    }
+};
+
+#endif // RPG_SPRITEANIMATORPARAMETER_H
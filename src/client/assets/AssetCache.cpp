@@ -0,0 +1,224 @@
+#include "../../pch.h"
+#include "AssetCache.h"
+
+#include <chrono>
+#include <filesystem>
+
+static const char *typeNames[] = {"textures", "shaders", "fonts", "audio"};
+
+template <typename T, typename Create, typename Measure, typename Destroy>
+std::shared_ptr<T> AssetCache::acquire(AssetType type, const std::string &key, Create create, Measure measure, Destroy destroy)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end())
+        {
+            if (auto asset = it->second.asset.lock())
+            {
+                // Keys are prefixed by the asset type, so the cast is always correct
+                return std::static_pointer_cast<T>(asset);
+            }
+        }
+    }
+
+    // Loading is done outside the lock, because it can take a while
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<T> asset(create(), [this, key, destroy](T *asset) {
+        release(key, asset);
+        destroy(*asset);
+        delete asset;
+    });
+    std::chrono::duration<double> loadTime = std::chrono::steady_clock::now() - start;
+
+    auto [cpuBytes, gpuBytes] = measure(*asset);
+
+    std::shared_ptr<void> loaded;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        AssetMemoryStats &stats = m_stats[(std::size_t) type];
+        stats.loadSeconds += loadTime.count();
+
+        Entry &entry = m_entries[key];
+        loaded = entry.asset.lock();
+        if (!loaded)
+        {
+            if (entry.address)
+            {
+                // The previous asset is still dying on another thread, it won't touch the entry anymore
+                AssetMemoryStats &previous = m_stats[(std::size_t) entry.type];
+                previous.count--;
+                previous.cpuBytes -= entry.cpuBytes;
+                previous.gpuBytes -= entry.gpuBytes;
+            }
+            entry.asset = asset;
+            entry.address = asset.get();
+            entry.type = type;
+            entry.cpuBytes = cpuBytes;
+            entry.gpuBytes = gpuBytes;
+
+            stats.count++;
+            stats.cpuBytes += cpuBytes;
+            stats.gpuBytes += gpuBytes;
+            return asset;
+        }
+    }
+
+    // Another thread has loaded the same asset meanwhile, its copy wins, so the asset stays deduplicated.
+    // Ours is destroyed outside the lock, its release() doesn't match the entry and leaves it alone.
+    return std::static_pointer_cast<T>(loaded);
+}
+
+std::shared_ptr<Texture> AssetCache::loadTexture(const std::string &path)
+{
+    return acquire<Texture>(
+        AssetType::Texture, "texture:" + canonicalPath(path),
+        [&] { return new Texture(Texture::create(path)); },
+        [](const Texture &texture) { return std::make_pair(std::size_t(0), texture.getGpuMemorySize()); },
+        [](Texture &texture) { texture.destroy(); });
+}
+
+std::shared_ptr<TextureArray> AssetCache::loadTextureArray(const std::vector<std::string> &paths)
+{
+    std::string key = "texture_array:";
+    for (const auto &path : paths)
+    {
+        key += canonicalPath(path) + "|";
+    }
+
+    return acquire<TextureArray>(
+        AssetType::Texture, key,
+        [&] { return new TextureArray(TextureArray::create(paths)); },
+        [](const TextureArray &array) { return std::make_pair(std::size_t(0), array.getGpuMemorySize()); },
+        [](TextureArray &array) { array.destroy(); });
+}
+
+std::shared_ptr<Shader> AssetCache::loadShader(const std::string &vertexPath, const std::string &fragmentPath)
+{
+    return acquire<Shader>(
+        AssetType::Shader, "shader:" + canonicalPath(vertexPath) + "|" + canonicalPath(fragmentPath),
+        [&] { return new Shader(Shader::createShader(vertexPath, fragmentPath)); },
+        [](const Shader &shader) {
+            // The size of the program binary is the best estimation we can get
+            int binaryLength = 0;
+            glGetProgramiv(shader.getId(), GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+            return std::make_pair(std::size_t(0), (std::size_t) binaryLength);
+        },
+        [](Shader &shader) { shader.destroy(); });
+}
+
+std::shared_ptr<Font> AssetCache::loadFont(const std::string &path, int size)
+{
+    return acquire<Font>(
+        AssetType::Font, "font:" + canonicalPath(path) + "|" + std::to_string(size),
+        [&] { return new Font(path, size); },
+        [](const Font &font) { return std::make_pair(font.getCpuMemorySize(), font.getGpuMemorySize()); },
+        [](Font &font) { font.destroy(); });
+}
+
+std::shared_ptr<IAudioClip> AssetCache::loadAudioClip(const std::string &path)
+{
+    std::error_code error;
+    auto size = std::filesystem::file_size(path, error);
+    if (error)
+    {
+        // Let the stream report the problem when it's played
+        return loadStreamAudioClip(path);
+    }
+
+    if (size <= DECODED_AUDIO_MAX_FILE_SIZE)
+    {
+        return loadDecodedAudioClip(path);
+    }
+    if (size <= CACHED_AUDIO_MAX_FILE_SIZE)
+    {
+        return loadCachedAudioClip(path);
+    }
+    return loadStreamAudioClip(path);
+}
+
+std::shared_ptr<DecodedAudioClip> AssetCache::loadDecodedAudioClip(const std::string &path)
+{
+    // The size is known before the decoding finishes, the memory is allocated up front
+    return acquire<DecodedAudioClip>(
+        AssetType::Audio, "decodedAudio:" + canonicalPath(path),
+        [&] { return new DecodedAudioClip(path); },
+        [](const DecodedAudioClip &clip) { return std::make_pair(clip.getDataSize(), std::size_t(0)); },
+        [](DecodedAudioClip &) {});
+}
+
+std::shared_ptr<CachedAudioClip> AssetCache::loadCachedAudioClip(const std::string &path)
+{
+    return acquire<CachedAudioClip>(
+        AssetType::Audio, "cachedAudio:" + canonicalPath(path),
+        [&] { return new CachedAudioClip(path); },
+        [](const CachedAudioClip &clip) { return std::make_pair(clip.getDataSize(), std::size_t(0)); },
+        [](CachedAudioClip &) {});
+}
+
+std::shared_ptr<StreamAudioClip> AssetCache::loadStreamAudioClip(const std::string &path)
+{
+    // Streamed clips only own the decoder buffers, which live in the audio device
+    return acquire<StreamAudioClip>(
+        AssetType::Audio, "streamAudio:" + canonicalPath(path),
+        [&] { return new StreamAudioClip(path); },
+        [](const StreamAudioClip &) { return std::make_pair(std::size_t(0), std::size_t(0)); },
+        [](StreamAudioClip &) {});
+}
+
+AssetMemoryStats AssetCache::getStats(AssetType type) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats[(std::size_t) type];
+}
+
+AssetMemoryStats AssetCache::getTotalStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    AssetMemoryStats total;
+    for (const auto &stats : m_stats)
+    {
+        total.count += stats.count;
+        total.cpuBytes += stats.cpuBytes;
+        total.gpuBytes += stats.gpuBytes;
+        total.loadSeconds += stats.loadSeconds;
+    }
+    return total;
+}
+
+void AssetCache::printStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (std::size_t i = 0; i < m_stats.size(); i++)
+    {
+        std::cout << typeNames[i] << ": " << m_stats[i].count << " loaded, "
+                  << m_stats[i].cpuBytes / 1024 << " KiB CPU, "
+                  << m_stats[i].gpuBytes / 1024 << " KiB GPU, "
+                  << m_stats[i].loadSeconds * 1000.0 << " ms loading" << std::endl;
+    }
+}
+
+void AssetCache::release(const std::string &key, const void *address)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(key);
+
+    // The entry could be replaced by a new load while the old asset was dying
+    if (it == m_entries.end() || it->second.address != address)
+    {
+        return;
+    }
+
+    AssetMemoryStats &stats = m_stats[(std::size_t) it->second.type];
+    stats.count--;
+    stats.cpuBytes -= it->second.cpuBytes;
+    stats.gpuBytes -= it->second.gpuBytes;
+    m_entries.erase(it);
+}
+
+std::string AssetCache::canonicalPath(const std::string &path)
+{
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    return error ? path : canonical.string();
+}
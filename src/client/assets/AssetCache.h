@@ -0,0 +1,170 @@
+#ifndef RPG_ASSETCACHE_H
+#define RPG_ASSETCACHE_H
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../graphics/Texture.h"
+#include "../graphics/TextureArray.h"
+#include "../graphics/Shader.h"
+#include "../graphics/Font.h"
+#include "../audio/CachedAudioClip.h"
+#include "../audio/StreamAudioClip.h"
+#include "../audio/DecodedAudioClip.h"
+
+// Audio files up to this size are decoded into memory
+#define DECODED_AUDIO_MAX_FILE_SIZE (1024 * 1024)
+
+// Audio files up to this size are kept in memory compressed, bigger ones are streamed
+#define CACHED_AUDIO_MAX_FILE_SIZE (2 * 1024 * 1024)
+
+enum class AssetType
+{
+    Texture,
+    Shader,
+    Font,
+    Audio,
+    Count
+};
+
+/**
+ * Memory usage of all loaded assets of one type.
+ */
+struct AssetMemoryStats
+{
+    std::size_t count{};
+    std::size_t cpuBytes{};
+    std::size_t gpuBytes{}; // estimated, the driver doesn't tell us the real size
+    double loadSeconds{}; // total time spent on loading, it isn't reduced when assets are unloaded
+};
+
+/**
+ * Central storage of all assets loaded from disk.
+ *
+ * Assets are deduplicated by their canonical path, so loading "base.png" twice returns the same texture.
+ * Every load returns a reference-counted handle and the asset is unloaded (including its GL objects)
+ * as soon as the last handle is released. It means the handles must be released before the GL context is gone.
+ */
+class AssetCache
+{
+    struct Entry
+    {
+        std::weak_ptr<void> asset;
+        const void *address{};
+        AssetType type{};
+        std::size_t cpuBytes{};
+        std::size_t gpuBytes{};
+    };
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;
+    std::array<AssetMemoryStats, (std::size_t) AssetType::Count> m_stats{};
+
+public:
+    AssetCache() = default;
+    AssetCache(const AssetCache &) = delete;
+    AssetCache &operator=(const AssetCache &) = delete;
+
+    /**
+     * Load a texture or return the already loaded one.
+     *
+     * @param path the file path
+     * @return the texture handle
+     */
+    std::shared_ptr<Texture> loadTexture(const std::string &path);
+
+    /**
+     * Load sprite sheets into a texture array or return the already loaded one.
+     * The same sheets in a different order are treated as a different array.
+     *
+     * @param paths the image paths
+     * @return the texture array handle
+     */
+    std::shared_ptr<TextureArray> loadTextureArray(const std::vector<std::string> &paths);
+
+    /**
+     * Load a shader program or return the already loaded one.
+     *
+     * @param vertexPath the vertex shader path
+     * @param fragmentPath the fragment shader path
+     * @return the shader handle
+     */
+    std::shared_ptr<Shader> loadShader(const std::string &vertexPath, const std::string &fragmentPath);
+
+    /**
+     * Load a font or return the already loaded one.
+     * The same file with different sizes is treated as different assets.
+     *
+     * @param path the file path
+     * @param size the font size
+     * @return the font handle
+     */
+    std::shared_ptr<Font> loadFont(const std::string &path, int size);
+
+    /**
+     * Load an audio clip choosing the best way to keep it by the file size:
+     * small files are decoded, medium ones are kept compressed and big ones are streamed.
+     *
+     * @param path the file path
+     * @return the audio clip handle
+     */
+    std::shared_ptr<IAudioClip> loadAudioClip(const std::string &path);
+
+    /**
+     * Load an audio clip which is decoded into memory.
+     *
+     * @param path the file path
+     * @return the audio clip handle
+     */
+    std::shared_ptr<DecodedAudioClip> loadDecodedAudioClip(const std::string &path);
+
+    /**
+     * Load an audio clip which is kept in memory.
+     *
+     * @param path the file path
+     * @return the audio clip handle
+     */
+    std::shared_ptr<CachedAudioClip> loadCachedAudioClip(const std::string &path);
+
+    /**
+     * Load an audio clip which is streamed from disk.
+     *
+     * @param path the file path
+     * @return the audio clip handle
+     */
+    std::shared_ptr<StreamAudioClip> loadStreamAudioClip(const std::string &path);
+
+    /**
+     * Get the memory usage of the assets of the given type.
+     *
+     * @param type the asset type
+     * @return the memory stats
+     */
+    AssetMemoryStats getStats(AssetType type) const;
+
+    /**
+     * Get the memory usage of all loaded assets.
+     *
+     * @return the memory stats
+     */
+    AssetMemoryStats getTotalStats() const;
+
+    /**
+     * Print the memory usage of every asset type.
+     */
+    void printStats() const;
+
+private:
+    template <typename T, typename Create, typename Measure, typename Destroy>
+    std::shared_ptr<T> acquire(AssetType type, const std::string &key, Create create, Measure measure, Destroy destroy);
+
+    void release(const std::string &key, const void *address);
+
+    static std::string canonicalPath(const std::string &path);
+};
+
+#endif // RPG_ASSETCACHE_H
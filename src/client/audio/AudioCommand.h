@@ -0,0 +1,49 @@
+#ifndef RPG_AUDIOCOMMAND_H
+#define RPG_AUDIOCOMMAND_H
+
+#include <miniaudio.h>
+#include "../../utils/Types.h"
+
+enum class AudioCommandType : u8
+{
+    Add,
+    Remove,
+    Play,
+    Pause,
+    Stop,
+    SetVolume,
+    SetPan,
+    SetLoop,
+    SetReal,
+    SetPitch
+};
+
+/**
+ * A message from the game thread to the audio thread.
+ */
+struct AudioCommand
+{
+    AudioCommandType type;
+    u32 voice;
+    float value; // volume, pan, loop or real (0 or 1), pitch
+    ma_data_source *dataSource; // only for Add
+    ma_uint64 length; // only for Add, the length of the sound in frames or 0 if it's unknown
+    ma_uint32 sampleRate; // only for Add, the sample rate of the data source
+};
+
+enum class AudioEventType : u8
+{
+    Released, // the audio thread doesn't use the data source anymore, it can be destroyed
+    Finished // a not looped sound reached the end
+};
+
+/**
+ * A message from the audio thread back to the game thread.
+ */
+struct AudioEvent
+{
+    AudioEventType type;
+    u32 voice;
+};
+
+#endif // RPG_AUDIOCOMMAND_H
@@ -1,11 +1,68 @@
 #include "../../pch.h"
 #include "AudioDevice.h"
+#include "AudioMixer.h"
 
 #include <iostream>
 #include <algorithm>
-#include <vector>
+#include <chrono>
+#include <cstdlib>
 
-AudioDevice::AudioDevice() : m_userData({m_sources, m_mutex})
+AudioDevice::AudioDevice()
+{
+    initVoices();
+
+    const char *wavPath = std::getenv(AUDIO_WAV_ENV);
+    if (wavPath && *wavPath)
+    {
+        openWav(wavPath, true);
+    }
+    else
+    {
+        openDevice();
+    }
+}
+
+AudioDevice::AudioDevice(const std::string &wavPath, bool realTime)
+{
+    initVoices();
+    openWav(wavPath, realTime);
+}
+
+AudioDevice::~AudioDevice()
+{
+    clear();
+    stopAudioThread();
+
+    if (m_offline)
+    {
+        AudioMixStats stats = getMixStats();
+        double audioSeconds = (double) stats.frames / SAMPLE_RATE;
+        std::cout << "Rendered " << audioSeconds << " s of audio, mixing took " << stats.seconds * 1000.0 << " ms";
+        if (audioSeconds > 0.0)
+        {
+            std::cout << " (" << stats.seconds * 1000.0 / audioSeconds << " ms per second of audio)";
+        }
+        std::cout << std::endl;
+        ma_encoder_uninit(&m_encoder);
+    }
+
+    // The audio thread is stopped, so we can destroy everything right away
+    for (u32 i = 0; i < MAX_VOICES; i++)
+    {
+        destroyDataSource(i);
+    }
+}
+
+void AudioDevice::initVoices()
+{
+    // Free voices are taken from the back, so start with the first one
+    for (u32 i = MAX_VOICES; i > 0; i--)
+    {
+        m_freeVoices.push_back(i - 1);
+    }
+}
+
+void AudioDevice::openDevice()
 {
     ma_device_config deviceConfig;
     deviceConfig = ma_device_config_init(ma_device_type_playback);
@@ -13,12 +70,11 @@ AudioDevice::AudioDevice() : m_userData({m_sources, m_mutex})
     deviceConfig.playback.channels = CHANNELS;
     deviceConfig.sampleRate = SAMPLE_RATE;
     deviceConfig.dataCallback = dataCallback;
-    deviceConfig.pUserData = &m_userData;
+    deviceConfig.pUserData = this;
 
     if (ma_device_init(nullptr, &deviceConfig, &m_device) != MA_SUCCESS)
     {
         std::cerr << "Failed to open playback device" << std::endl;
-        ma_device_uninit(&m_device);
         return;
     }
 
@@ -28,107 +84,544 @@ AudioDevice::AudioDevice() : m_userData({m_sources, m_mutex})
         ma_device_uninit(&m_device);
         return;
     }
+    m_deviceOpen = true;
+    m_running = true;
 }
 
-AudioDevice::~AudioDevice()
+void AudioDevice::openWav(const std::string &wavPath, bool realTime)
 {
-    clear();
-    ma_device_uninit(&m_device);
+    ma_encoder_config config = ma_encoder_config_init(ma_resource_format_wav, FORMAT, CHANNELS, SAMPLE_RATE);
+    if (ma_encoder_init_file(wavPath.c_str(), &config, &m_encoder) != MA_SUCCESS)
+    {
+        std::cerr << "Failed to open audio output file " << wavPath << std::endl;
+        return;
+    }
+    m_offline = true;
+    std::cout << "Writing audio into " << wavPath << std::endl;
+
+    if (realTime)
+    {
+        // The render thread takes the place of the audio thread
+        m_rendering = true;
+        m_running = true;
+        m_renderThread = std::thread(&AudioDevice::renderLoop, this);
+    }
+}
+
+void AudioDevice::renderLoop()
+{
+    std::array<float, MIX_BLOCK_FRAMES * CHANNELS> buffer{};
+    auto blockDuration = std::chrono::nanoseconds(1000000000ll * MIX_BLOCK_FRAMES / SAMPLE_RATE);
+    auto next = std::chrono::steady_clock::now();
+
+    while (m_rendering)
+    {
+        buffer.fill(0.f);
+        mix(buffer.data(), MIX_BLOCK_FRAMES);
+        ma_encoder_write_pcm_frames(&m_encoder, buffer.data(), MIX_BLOCK_FRAMES);
+
+        // Simulate a sound card, which takes the blocks at a steady pace
+        next += blockDuration;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void AudioDevice::stopAudioThread()
+{
+    // Both wait for the running callback to return
+    if (m_deviceOpen)
+    {
+        ma_device_uninit(&m_device);
+        m_deviceOpen = false;
+    }
+    if (m_renderThread.joinable())
+    {
+        m_rendering = false;
+        m_renderThread.join();
+    }
+    m_running = false;
+}
+
+void AudioDevice::render(ma_uint32 frameCount)
+{
+    if (!m_offline || m_running)
+    {
+        std::cerr << "Only the offline audio devices which aren't rendered in real time can be rendered manually"
+                  << std::endl;
+        return;
+    }
+
+    std::array<float, MIX_BLOCK_FRAMES * CHANNELS> buffer{};
+    for (ma_uint32 offset = 0; offset < frameCount; offset += MIX_BLOCK_FRAMES)
+    {
+        ma_uint32 blockFrames = std::min<ma_uint32>(MIX_BLOCK_FRAMES, frameCount - offset);
+        buffer.fill(0.f);
+        mix(buffer.data(), blockFrames);
+        ma_encoder_write_pcm_frames(&m_encoder, buffer.data(), blockFrames);
+    }
+}
+
+bool AudioDevice::isOffline() const
+{
+    return m_offline;
+}
+
+AudioMixStats AudioDevice::getMixStats() const
+{
+    AudioMixStats stats;
+    stats.frames = m_mixedFrames.load(std::memory_order_relaxed);
+    stats.seconds = (double) m_mixNanoseconds.load(std::memory_order_relaxed) / 1e9;
+    return stats;
 }
 
 void AudioDevice::add(AudioSource &source)
 {
-    auto result = m_sources.find(&source);
-    if (result == m_sources.end())
+    if (source.m_device) return;
+
+    if (m_freeVoices.empty())
     {
-        m_mutex.lock();
-        m_sources.insert({&source, {}});
-        ma_decoder_config config = ma_decoder_config_init(FORMAT, CHANNELS, SAMPLE_RATE);
-        source.getAudioClip().createDecoder(&m_sources[&source], &config);
-        m_mutex.unlock();
+        std::cerr << "Cannot add an audio source! The maximum number of voices is " << MAX_VOICES << std::endl;
+        return;
+    }
+    u32 voice = m_freeVoices.back();
+    m_freeVoices.pop_back();
+
+    // The data source is created here, so the audio thread never opens files or allocates memory
+    const IAudioClip &clip = source.getAudioClip();
+    ma_data_source *dataSource = clip.createDataSource();
+    if (!dataSource)
+    {
+        m_freeVoices.push_back(voice);
+        return;
+    }
+
+    // The length is unknown for some formats, virtual voices can't loop them precisely then
+    ma_uint64 length = 0;
+    ma_data_source_get_length_in_pcm_frames(dataSource, &length);
+
+    ma_format format;
+    ma_uint32 channels;
+    ma_uint32 sampleRate = SAMPLE_RATE;
+    ma_data_source_get_data_format(dataSource, &format, &channels, &sampleRate);
+
+    m_sources[voice] = &source;
+    m_dataSources[voice] = dataSource;
+    m_clips[voice] = &clip;
+    source.m_device = this;
+    source.m_voice = voice;
+
+    // The voice starts as virtual, updateVoices() decides whether it's worth decoding
+    source.m_real = false;
+
+    sendCommand({AudioCommandType::Add, voice, 0.f, dataSource, length, sampleRate});
+    sendCommand({AudioCommandType::SetVolume, voice, source.m_volume});
+    sendCommand({AudioCommandType::SetPan, voice, source.m_pan});
+    sendCommand({AudioCommandType::SetLoop, voice, source.m_loop ? 1.f : 0.f});
+    sendCommand({AudioCommandType::SetPitch, voice, source.m_pitch});
+    if (source.m_state == AudioState::Play)
+    {
+        sendCommand({AudioCommandType::Play, voice});
     }
 }
 
 void AudioDevice::remove(AudioSource &source)
 {
-    auto result = m_sources.find(&source);
-    if (result != m_sources.end())
+    if (source.m_device != this) return;
+
+    // The voice is released when the audio thread confirms that it doesn't use the data source anymore
+    u32 voice = source.m_voice;
+    m_sources[voice] = nullptr;
+    source.m_device = nullptr;
+    sendCommand({AudioCommandType::Remove, voice});
+}
+
+void AudioDevice::clear()
+{
+    for (auto *source : m_sources)
     {
-        m_mutex.lock();
-        ma_decoder_uninit(&result->second);
-        m_sources.erase(&source);
-        m_mutex.unlock();
+        if (source)
+        {
+            remove(*source);
+        }
     }
 }
 
-void AudioDevice::clear()
+void AudioDevice::drain()
 {
-    m_mutex.lock();
-    for (auto &source : m_sources)
+    clear();
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(AUDIO_DRAIN_TIMEOUT_MS);
+    while (true)
+    {
+        update();
+        if (!hasDataSources()) return;
+
+        if (!m_running || std::chrono::steady_clock::now() >= deadline)
+        {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // The audio thread is stuck, so take its place: nobody else reads the queue or the voices once it's stopped
+    stopAudioThread();
+
+    AudioCommand command;
+    while (m_commands.pop(command))
+    {
+        processCommand(command);
+    }
+    for (const auto &pending : m_pendingCommands)
     {
-        ma_decoder_uninit(&source.second);
+        processCommand(pending);
     }
-    m_sources.clear();
-    m_mutex.unlock();
+    m_pendingCommands.clear();
+
+    for (u32 i = 0; i < MAX_VOICES; i++)
+    {
+        postEvents(m_voices[i], i);
+    }
+    update();
 }
 
-void AudioDevice::dataCallback(ma_device *pDevice, void *pOutput, const void *pInput, ma_uint32 frameCount)
+bool AudioDevice::hasDataSources() const
+{
+    return std::any_of(m_dataSources.begin(), m_dataSources.end(), [](const ma_data_source *dataSource) { return dataSource; });
+}
+
+void AudioDevice::update()
 {
-    auto *userData = (UserData *) pDevice->pUserData;
+    flushPendingCommands();
 
-    // Get all sources
-    auto &sources = userData->sources;
+    AudioEvent event;
+    while (m_events.pop(event))
+    {
+        switch (event.type)
+        {
+            case AudioEventType::Released:
+                destroyDataSource(event.voice);
+                m_freeVoices.push_back(event.voice);
+                break;
+            case AudioEventType::Finished:
+                if (m_sources[event.voice])
+                {
+                    m_sources[event.voice]->m_state = AudioState::Stop;
+                    m_sources[event.voice]->m_finished = true;
+                }
+                break;
+        }
+    }
+}
 
-    // Lock the mutex
-    std::lock_guard<std::mutex> lockGuard(userData->mutex);
+void AudioDevice::updateVoices()
+{
+    m_candidates.clear();
+    for (auto *source : m_sources)
+    {
+        if (source && source->m_state == AudioState::Play && source->m_volume > AUDIBLE_VOLUME)
+        {
+            m_candidates.push_back(source);
+        }
+    }
 
-    if (sources.empty()) return;
+    // Only the first ones are needed, the order of the rest doesn't matter
+    std::size_t realCount = std::min<std::size_t>(m_maxRealVoices, m_candidates.size());
+    std::partial_sort(m_candidates.begin(), m_candidates.begin() + (long) realCount, m_candidates.end(),
+                      [](const AudioSource *a, const AudioSource *b)
+                      {
+                          if (a->m_priority != b->m_priority) return a->m_priority > b->m_priority;
+                          return a->m_volume > b->m_volume;
+                      });
 
-    std::vector<AudioSource*> stoppedSources;
+    std::array<bool, MAX_VOICES> real{};
+    for (std::size_t i = 0; i < realCount; i++)
+    {
+        real[m_candidates[i]->m_voice] = true;
+    }
 
-    // Mix all sources
-    for (auto &item : sources)
+    // Send only the changes
+    for (u32 i = 0; i < MAX_VOICES; i++)
     {
-        if (item.first->getState() == AudioState::Play)
+        AudioSource *source = m_sources[i];
+        if (source && source->m_real != real[i])
         {
-            bool result = readAndMixSound(*item.first, item.second, (float *) pOutput, frameCount);
-            if (!result)
+            source->m_real = real[i];
+            sendCommand({AudioCommandType::SetReal, i, real[i] ? 1.f : 0.f});
+        }
+    }
+}
+
+void AudioDevice::setMaxRealVoices(u32 maxRealVoices)
+{
+    m_maxRealVoices = maxRealVoices;
+}
+
+u32 AudioDevice::getMaxRealVoices() const
+{
+    return m_maxRealVoices;
+}
+
+void AudioDevice::sendCommand(const AudioCommand &command)
+{
+    if (!m_running)
+    {
+        // There is no audio thread, so we are the only user of the voices
+        processCommand(command);
+        postEvents(m_voices[command.voice], command.voice);
+        return;
+    }
+
+    // Keep the order: if something is already waiting, this command must wait too
+    if (!m_pendingCommands.empty() || !m_commands.push(command))
+    {
+        m_pendingCommands.push_back(command);
+    }
+}
+
+void AudioDevice::flushPendingCommands()
+{
+    std::size_t sent = 0;
+    while (sent < m_pendingCommands.size() && m_commands.push(m_pendingCommands[sent]))
+    {
+        sent++;
+    }
+    m_pendingCommands.erase(m_pendingCommands.begin(), m_pendingCommands.begin() + (long) sent);
+}
+
+void AudioDevice::destroyDataSource(u32 voice)
+{
+    if (m_dataSources[voice])
+    {
+        m_clips[voice]->destroyDataSource(m_dataSources[voice]);
+        m_dataSources[voice] = nullptr;
+        m_clips[voice] = nullptr;
+    }
+}
+
+void AudioDevice::processCommand(const AudioCommand &command)
+{
+    Voice &voice = m_voices[command.voice];
+    switch (command.type)
+    {
+        case AudioCommandType::Add:
+            voice = Voice();
+            voice.dataSource = command.dataSource;
+            voice.length = command.length;
+            voice.sampleRate = command.sampleRate;
+            voice.active = true;
+            resetResampler(voice);
+            updateRate(voice);
+            break;
+        case AudioCommandType::Remove:
+            voice.active = false;
+            voice.finishedPending = false;
+            voice.releasePending = true;
+            break;
+        case AudioCommandType::Play:
+            voice.state = AudioState::Play;
+            break;
+        case AudioCommandType::Pause:
+            voice.state = AudioState::Pause;
+            break;
+        case AudioCommandType::Stop:
+            if (voice.state != AudioState::Stop && voice.real)
             {
-                item.first->stop();
+                ma_data_source_seek_to_pcm_frame(voice.dataSource, 0);
             }
-        }
-        if (item.first->getState() == AudioState::Stop)
+            voice.state = AudioState::Stop;
+            voice.cursor = 0;
+            resetResampler(voice);
+
+            // The next start fades in from silence
+            voice.gainLeft = 0.f;
+            voice.gainRight = 0.f;
+            break;
+        case AudioCommandType::SetVolume:
+            voice.volume = command.value;
+            break;
+        case AudioCommandType::SetPan:
+            voice.pan = command.value;
+            break;
+        case AudioCommandType::SetLoop:
+            voice.loop = command.value != 0.f;
+            break;
+        case AudioCommandType::SetReal:
+            setReal(voice, command.value != 0.f);
+            break;
+        case AudioCommandType::SetPitch:
+            voice.pitch = command.value;
+            updateRate(voice);
+            break;
+    }
+}
+
+void AudioDevice::setReal(Voice &voice, bool real)
+{
+    if (voice.real == real) return;
+    voice.real = real;
+
+    if (real)
+    {
+        // Continue from where the virtual voice is, the gain ramp fades it in
+        ma_data_source_seek_to_pcm_frame(voice.dataSource, voice.cursor);
+        resetResampler(voice);
+        voice.gainLeft = 0.f;
+        voice.gainRight = 0.f;
+    }
+    else
+    {
+        // From now on the cursor is moved by hand
+        ma_data_source_get_cursor_in_pcm_frames(voice.dataSource, &voice.cursor);
+    }
+}
+
+void AudioDevice::advanceVirtual(Voice &voice, ma_uint32 frameCount)
+{
+    // The cursor counts the source frames
+    voice.cursor += (ma_uint64) std::llround(frameCount * voice.rate);
+
+    // Without the length we can't tell where the sound ends, the seek will find it out when the voice becomes real
+    if (voice.length == 0 || voice.cursor < voice.length) return;
+
+    if (voice.loop)
+    {
+        voice.cursor %= voice.length;
+    }
+    else
+    {
+        voice.state = AudioState::Stop;
+        voice.cursor = 0;
+        voice.finishedPending = true;
+    }
+}
+
+void AudioDevice::postEvents(Voice &voice, u32 index)
+{
+    if (voice.finishedPending && m_events.push({AudioEventType::Finished, index}))
+    {
+        voice.finishedPending = false;
+    }
+    if (voice.releasePending && m_events.push({AudioEventType::Released, index}))
+    {
+        voice.releasePending = false;
+        voice.dataSource = nullptr;
+    }
+}
+
+void AudioDevice::mix(float *pOutputF32, ma_uint32 frameCount)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // Apply everything the game thread asked for since the last callback
+    AudioCommand command;
+    while (m_commands.pop(command))
+    {
+        processCommand(command);
+    }
+
+    // Mix all voices block by block, the scratch buffer holds exactly one block
+    for (ma_uint32 offset = 0; offset < frameCount; offset += MIX_BLOCK_FRAMES)
+    {
+        ma_uint32 blockFrames = std::min<ma_uint32>(MIX_BLOCK_FRAMES, frameCount - offset);
+        float *pBlock = pOutputF32 + offset * CHANNELS;
+
+        for (Voice &voice : m_voices)
         {
-            ma_decoder_seek_to_pcm_frame(&item.second, 0);
+            if (!voice.active || voice.state != AudioState::Play) continue;
+
+            if (!voice.real)
+            {
+                advanceVirtual(voice, blockFrames);
+            }
+            else if (!readAndMixSound(voice, pBlock, blockFrames))
+            {
+                voice.state = AudioState::Stop;
+                ma_data_source_seek_to_pcm_frame(voice.dataSource, 0);
+                voice.gainLeft = 0.f;
+                voice.gainRight = 0.f;
+                voice.finishedPending = true;
+            }
         }
     }
+
+    // Many loud voices can easily sum up above 1, the limiter turns the mix down instead of clipping it
+    AudioMixer::limit(pOutputF32, frameCount, SAMPLE_RATE, m_limiterGain);
+
+    for (u32 i = 0; i < MAX_VOICES; i++)
+    {
+        postEvents(m_voices[i], i);
+    }
+
+    auto mixTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    m_mixedFrames.fetch_add(frameCount, std::memory_order_relaxed);
+    m_mixNanoseconds.fetch_add((u64) mixTime.count(), std::memory_order_relaxed);
 }
 
-bool AudioDevice::readAndMixSound(const AudioSource &source, ma_decoder& decoder, float *pOutputF32, ma_uint32 frameCount)
+void AudioDevice::updateRate(Voice &voice)
 {
-    auto *temp = new float[frameCount * CHANNELS];
+    float pitch = std::clamp(voice.pitch, MIN_PITCH, MAX_PITCH);
+    voice.rate = std::min((float) voice.sampleRate * pitch / SAMPLE_RATE, (float) MAX_RESAMPLE_RATIO);
+    voice.resampling = voice.sampleRate != SAMPLE_RATE || pitch != 1.f;
 
-    ma_result result = ma_data_source_read_pcm_frames(&decoder, temp, frameCount, nullptr, source.isLoop());
-    if (result != MA_SUCCESS)
+    if (voice.resampling)
     {
-        return false;
+        // The pitch is applied by pretending that the source has another sample rate
+        auto rateIn = (ma_uint32) std::lround(voice.rate * SAMPLE_RATE);
+        ma_linear_resampler_set_rate(&voice.resampler, rateIn, SAMPLE_RATE);
     }
+}
 
-    // Mix the frames
-    for (ma_uint32 sample = 0; sample < frameCount * CHANNELS; sample += CHANNELS)
-    {
-        // The volume of the left channel
-        float left = 1 - std::clamp(source.getPan(), 0.f, 1.f);
-        pOutputF32[sample] += source.getVolume() * left * temp[sample];
-        std::clamp(pOutputF32[sample], -1.f, 1.f);
+void AudioDevice::resetResampler(Voice &voice)
+{
+    // It doesn't allocate, so it's safe on the audio thread
+    auto rateIn = (ma_uint32) std::lround(voice.rate * SAMPLE_RATE);
+    ma_linear_resampler_config config = ma_linear_resampler_config_init(FORMAT, CHANNELS, rateIn, SAMPLE_RATE);
+    ma_linear_resampler_init(&config, &voice.resampler);
+}
 
-        // The volume of the right channel
-        float right = 1 - std::abs(std::clamp(source.getPan(), -1.f, 0.f));
-        pOutputF32[sample + 1] += source.getVolume() * right * temp[sample + 1];
-        std::clamp(pOutputF32[sample + 1], -1.f, 1.f);
+void AudioDevice::dataCallback(ma_device *pDevice, void *pOutput, const void *pInput, ma_uint32 frameCount)
+{
+    auto *device = (AudioDevice *) pDevice->pUserData;
+    device->mix((float *) pOutput, frameCount);
+}
+
+ma_uint64 AudioDevice::readFrames(Voice &voice, ma_uint32 frameCount, ma_result &result)
+{
+    ma_uint64 framesRead = 0;
+    if (!voice.resampling)
+    {
+        // The source is already in the device format
+        result = ma_data_source_read_pcm_frames(voice.dataSource, m_scratch.data(), frameCount, &framesRead, voice.loop);
+        return framesRead;
     }
 
-    delete[] temp;
+    ma_uint64 inputFrames = ma_linear_resampler_get_required_input_frame_count(&voice.resampler, frameCount);
+    inputFrames = std::min<ma_uint64>(inputFrames, m_resampleInput.size() / CHANNELS);
+    result = ma_data_source_read_pcm_frames(voice.dataSource, m_resampleInput.data(), inputFrames, &framesRead,
+                                            voice.loop);
+
+    ma_uint64 framesOut = frameCount;
+    ma_linear_resampler_process_pcm_frames(&voice.resampler, m_resampleInput.data(), &framesRead, m_scratch.data(),
+                                           &framesOut);
+    return framesOut;
+}
+
+bool AudioDevice::readAndMixSound(Voice &voice, float *pOutputF32, ma_uint32 frameCount)
+{
+    ma_result result;
+    ma_uint64 framesRead = readFrames(voice, frameCount, result);
+
+    // The channel gains for the current volume and pan
+    float left = voice.volume * (1.f - std::clamp(voice.pan, 0.f, 1.f));
+    float right = voice.volume * (1.f + std::clamp(voice.pan, -1.f, 0.f));
+
+    // The ramp is stretched over the whole block even if the sound ends earlier, so the gains stay continuous
+    float leftEnd = voice.gainLeft + (left - voice.gainLeft) * (float) framesRead / (float) frameCount;
+    float rightEnd = voice.gainRight + (right - voice.gainRight) * (float) framesRead / (float) frameCount;
+    AudioMixer::mixStereo(pOutputF32, m_scratch.data(), (ma_uint32) framesRead, voice.gainLeft, voice.gainRight,
+                          leftEnd, rightEnd);
+    voice.gainLeft = left;
+    voice.gainRight = right;
 
-    return true;
+    return (result == MA_SUCCESS || result == MA_AT_END) && framesRead == frameCount;
 }
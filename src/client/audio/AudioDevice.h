@@ -3,49 +3,171 @@
 
 #include "AudioSource.h"
 #include "AudioState.h"
+#include "AudioCommand.h"
+#include "../../utils/SpscQueue.h"
 
 #include <miniaudio.h>
-#include <mutex>
-#include <unordered_map>
+#include <array>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
 
 #define FORMAT ma_format_f32
 #define CHANNELS 2
 #define SAMPLE_RATE 48000
 
-// The structure for passing data into the decoder callback function
-struct UserData
+#define MAX_VOICES 256
+#define AUDIO_COMMAND_QUEUE_SIZE 1024
+
+// By default only this many sounds are decoded at once, the rest are virtual
+#define DEFAULT_MAX_REAL_VOICES 32
+
+// Quieter sounds can't be heard, so they never get a real voice
+#define AUDIBLE_VOLUME 0.001f
+
+// Set this environment variable to a file path to write the sound into a WAV file instead of playing it
+#define AUDIO_WAV_ENV "TRUERPG_AUDIO_WAV"
+
+// The callback is mixed in blocks of this size, it's also the length of the gain ramps (~5 ms)
+#define MIX_BLOCK_FRAMES 256
+
+// The pitch of a voice is kept in these limits
+#define MIN_PITCH 0.25f
+#define MAX_PITCH 4.f
+
+// A voice never reads more than this many source frames per output frame, it limits the resampler buffer
+#define MAX_RESAMPLE_RATIO 8
+
+// How long drain() waits for the audio thread before it stops the thread
+#define AUDIO_DRAIN_TIMEOUT_MS 500
+
+ /**
+  * How much audio the mixer has produced and how long it took.
+  */
+struct AudioMixStats
 {
-    std::unordered_map<AudioSource *, ma_decoder> &sources;
-    std::mutex &mutex;
+    u64 frames{};
+    double seconds{};
 };
 
  /**
   * Audio device class.
   * It can play sounds and mix them with each other.
   * Ideally, there should be only one audio device for the entire game.
+  *
+  * The mixing is done in a separate real-time thread which never waits for the game thread.
+  * Every audio source gets a voice, and the game thread controls the voices only through a lock-free command queue.
+  * The audio thread answers through another queue, these answers are handled in update().
+  *
+  * Only the most important playing sounds are decoded (real voices), their number is limited.
+  * The others are virtual: they cost almost nothing, because the audio thread only moves their play cursor.
+  * When a virtual voice becomes real, the data source seeks to the cursor, so the sound continues from the right place.
+  *
+  * The data sources play at their own sample rate. A voice is resampled to the device rate by the mixer only
+  * if the rates differ or its pitch is changed, otherwise it's mixed as it is.
+  *
+  * Instead of the sound card, the device can write the mix into a WAV file. It's used where there is no sound card
+  * and for checking the output and the cost of the mixer.
   */
 class AudioDevice
 {
 private:
+    // The state of a voice as the audio thread sees it, only the audio thread touches it
+    struct Voice
+    {
+        ma_data_source *dataSource{};
+        AudioState state{AudioState::Stop};
+        float volume{1.f};
+        float pan{0.f};
+        float pitch{1.f};
+        bool loop{false};
+        bool active{false};
+        bool real{false};
+
+        // The play position of a virtual voice, real voices keep it in the data source
+        ma_uint64 cursor{0};
+        ma_uint64 length{0};
+
+        // Resampling to the device rate, skipped when the rates match and the pitch isn't changed
+        ma_uint32 sampleRate{SAMPLE_RATE};
+        float rate{1.f}; // source frames per output frame
+        bool resampling{false};
+        ma_linear_resampler resampler{};
+
+        // The channel gains the previous block ended with, the next block ramps from them
+        float gainLeft{0.f};
+        float gainRight{0.f};
+
+        // The answer couldn't be sent because the queue was full, try again in the next callback
+        bool releasePending{false};
+        bool finishedPending{false};
+    };
+
     ma_device m_device{};
+    bool m_deviceOpen{false};
+
+    // Is there a separate audio thread
+    bool m_running{false};
+
+    // Offline output
+    ma_encoder m_encoder{};
+    bool m_offline{false};
+    std::thread m_renderThread;
+    std::atomic<bool> m_rendering{false};
+
+    std::atomic<u64> m_mixedFrames{0};
+    std::atomic<u64> m_mixNanoseconds{0};
+
+    // Audio thread data
+    std::array<Voice, MAX_VOICES> m_voices;
 
-    // This audio source map is a shared resource,
-    // because sounds must be played in a separate thread.
-    // So be careful with this.
-    std::unordered_map<AudioSource *, ma_decoder> m_sources;
+    // The gain of the bus limiter, it carries the envelope from one callback to the next
+    float m_limiterGain{1.f};
 
-    std::mutex m_mutex;
+    // The decoded frames of one voice, allocated once so the audio thread never allocates
+    alignas(16) std::array<float, MIX_BLOCK_FRAMES * CHANNELS> m_scratch{};
 
-    // This data we want to pass into the decoder callback function
-    UserData m_userData;
+    // The source frames of a resampled voice
+    std::array<float, (MIX_BLOCK_FRAMES * MAX_RESAMPLE_RATIO + 1) * CHANNELS> m_resampleInput{};
+
+    SpscQueue<AudioCommand, AUDIO_COMMAND_QUEUE_SIZE> m_commands;
+    SpscQueue<AudioEvent, AUDIO_COMMAND_QUEUE_SIZE> m_events;
+
+    // Game thread data
+    std::array<AudioSource *, MAX_VOICES> m_sources{};
+    std::array<ma_data_source *, MAX_VOICES> m_dataSources{};
+    std::array<const IAudioClip *, MAX_VOICES> m_clips{}; // the clips which created the data sources
+    std::vector<u32> m_freeVoices;
+
+    u32 m_maxRealVoices{DEFAULT_MAX_REAL_VOICES};
+
+    // The playing sources sorted by importance, kept here to not allocate every frame
+    std::vector<AudioSource *> m_candidates;
+
+    // Commands which didn't fit into the queue, they are sent first next time
+    std::vector<AudioCommand> m_pendingCommands;
 
 public:
 
     /**
-     * Create an audio device.
+     * Create an audio device which plays through the sound card.
+     * If the TRUERPG_AUDIO_WAV environment variable is set, the sound is written into that file in real time instead.
      */
     AudioDevice();
 
+    /**
+     * Create an offline audio device which writes the sound into a WAV file.
+     *
+     * @param wavPath the file path
+     * @param realTime true to mix in the background as fast as a sound card would take the sound,
+     *                 false to mix only when render() is called
+     */
+    AudioDevice(const std::string &wavPath, bool realTime);
+
+    AudioDevice(const AudioDevice &) = delete;
+    AudioDevice &operator=(const AudioDevice &) = delete;
+
     ~AudioDevice();
 
     /**
@@ -64,13 +186,106 @@ public:
 
     /**
      * Clear the device.
+     * The data sources are released later, when the audio thread confirms it doesn't read them anymore.
      */
     void clear();
 
+    /**
+     * Clear the device and wait until all data sources are released, so the clips can be destroyed right after.
+     * If the audio thread doesn't answer in time, it's stopped and the sources are released on the calling thread.
+     */
+    void drain();
+
+    /**
+     * Handle the answers of the audio thread and send the delayed commands.
+     * Must be called by the game thread regularly.
+     */
+    void update();
+
+    /**
+     * Decide which sounds are decoded for real.
+     * The audible playing sounds are sorted by priority and then by volume, the first ones get the real voices.
+     * Must be called by the game thread after the sources are updated.
+     */
+    void updateVoices();
+
+    /**
+     * Set the maximum number of sounds that are decoded at once.
+     *
+     * @param maxRealVoices the number of real voices
+     */
+    void setMaxRealVoices(u32 maxRealVoices);
+
+    /**
+     * Get the maximum number of sounds that are decoded at once.
+     *
+     * @return the number of real voices
+     */
+    u32 getMaxRealVoices() const;
+
+    /**
+     * Mix the sound and write it into the file right away, on the calling thread.
+     * Works only for offline devices which aren't rendered in real time.
+     *
+     * @param frameCount the number of frames
+     */
+    void render(ma_uint32 frameCount);
+
+    /**
+     * Does the device write into a file instead of the sound card?
+     *
+     * @return true if the device is offline
+     */
+    bool isOffline() const;
+
+    /**
+     * Get the amount of mixed audio and the time spent on mixing it.
+     *
+     * @return the mix stats
+     */
+    AudioMixStats getMixStats() const;
+
 private:
+    void initVoices();
+
+    void openDevice();
+
+    void openWav(const std::string &wavPath, bool realTime);
+
+    void renderLoop();
+
+    void stopAudioThread();
+
+    bool hasDataSources() const;
+
+    void sendCommand(const AudioCommand &command);
+
+    void flushPendingCommands();
+
+    void destroyDataSource(u32 voice);
+
+    // Audio thread functions
+    void processCommand(const AudioCommand &command);
+
+    void postEvents(Voice &voice, u32 index);
+
+    void setReal(Voice &voice, bool real);
+
+    void advanceVirtual(Voice &voice, ma_uint32 frameCount);
+
+    static void updateRate(Voice &voice);
+
+    static void resetResampler(Voice &voice);
+
+    ma_uint64 readFrames(Voice &voice, ma_uint32 frameCount, ma_result &result);
+
+    void mix(float *pOutputF32, ma_uint32 frameCount);
+
     static void dataCallback(ma_device *pDevice, void *pOutput, const void *pInput, ma_uint32 frameCount);
 
-    static bool readAndMixSound(const AudioSource &source, ma_decoder &decoder, float *pOutputF32, ma_uint32 frameCount);
+    bool readAndMixSound(Voice &voice, float *pOutputF32, ma_uint32 frameCount);
+
+    friend class AudioSource;
 };
 
 #endif //RPG_AUDIODEVICE_H
@@ -0,0 +1,77 @@
+#include "../../pch.h"
+#include "AudioMixer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AUDIO_MIXER_SSE2
+#include <emmintrin.h>
+#endif
+
+void AudioMixer::mixStereo(float *pOutput, const float *pInput, ma_uint32 frameCount,
+                           float leftFrom, float rightFrom, float leftTo, float rightTo)
+{
+    if (frameCount == 0) return;
+
+    float leftStep = (leftTo - leftFrom) / (float) frameCount;
+    float rightStep = (rightTo - rightFrom) / (float) frameCount;
+
+    ma_uint32 frame = 0;
+
+#ifdef AUDIO_MIXER_SSE2
+    // One register holds two stereo frames: L0 R0 L1 R1
+    __m128 gain = _mm_setr_ps(leftFrom, rightFrom, leftFrom + leftStep, rightFrom + rightStep);
+    __m128 step = _mm_setr_ps(leftStep * 2, rightStep * 2, leftStep * 2, rightStep * 2);
+    for (; frame + 2 <= frameCount; frame += 2)
+    {
+        __m128 in = _mm_loadu_ps(pInput + frame * 2);
+        __m128 out = _mm_loadu_ps(pOutput + frame * 2);
+        _mm_storeu_ps(pOutput + frame * 2, _mm_add_ps(out, _mm_mul_ps(in, gain)));
+        gain = _mm_add_ps(gain, step);
+    }
+#endif
+
+    // The scalar tail (or everything if there is no SSE2)
+    for (; frame < frameCount; frame++)
+    {
+        pOutput[frame * 2] += pInput[frame * 2] * (leftFrom + leftStep * (float) frame);
+        pOutput[frame * 2 + 1] += pInput[frame * 2 + 1] * (rightFrom + rightStep * (float) frame);
+    }
+}
+
+void AudioMixer::limit(float *pFrames, ma_uint32 frameCount, ma_uint32 sampleRate, float &gain)
+{
+    // One-pole smoothing, the gain moves this much of the way to the target every frame
+    const float attack = 1.f - std::exp(-1000.f / (LIMITER_ATTACK_MS * (float) sampleRate));
+    const float release = 1.f - std::exp(-1000.f / (LIMITER_RELEASE_MS * (float) sampleRate));
+
+    for (ma_uint32 i = 0; i < frameCount; i++)
+    {
+        float *pFrame = pFrames + i * 2;
+        float peak = std::max(std::abs(pFrame[0]), std::abs(pFrame[1]));
+        float target = peak > LIMITER_THRESHOLD ? LIMITER_THRESHOLD / peak : 1.f;
+
+        gain += (target - gain) * (target < gain ? attack : release);
+        pFrame[0] *= gain;
+        pFrame[1] *= gain;
+    }
+
+    // The safety clip for what got through during the attack
+    softLimit(pFrames, frameCount * 2);
+}
+
+void AudioMixer::softLimit(float *pSamples, ma_uint32 sampleCount)
+{
+    const float knee = 1.f - LIMITER_THRESHOLD;
+    for (ma_uint32 i = 0; i < sampleCount; i++)
+    {
+        float magnitude = std::abs(pSamples[i]);
+        if (magnitude <= LIMITER_THRESHOLD) continue;
+
+        // x / (1 + x) has the slope 1 at zero and approaches 1, so the curve continues the linear part smoothly
+        float over = (magnitude - LIMITER_THRESHOLD) / knee;
+        float limited = LIMITER_THRESHOLD + knee * over / (1.f + over);
+        pSamples[i] = std::copysign(limited, pSamples[i]);
+    }
+}
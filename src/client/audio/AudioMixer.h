@@ -0,0 +1,56 @@
+#ifndef RPG_AUDIOMIXER_H
+#define RPG_AUDIOMIXER_H
+
+#include <miniaudio.h>
+
+// The level the bus limiter brings the peaks down to, quieter samples pass through untouched
+#define LIMITER_THRESHOLD 0.8f
+
+// How fast the limiter gain follows a peak down and comes back up after it
+#define LIMITER_ATTACK_MS 1.f
+#define LIMITER_RELEASE_MS 150.f
+
+/**
+ * Utility class with the sample crunching routines of the audio thread.
+ * All functions work on interleaved stereo float frames and never allocate.
+ */
+class AudioMixer
+{
+public:
+    /**
+     * Add the input to the output with a gain that changes linearly over the block.
+     * The ramp hides the steps when the volume or the pan changes, otherwise they are heard as clicks.
+     *
+     * @param pOutput the output frames
+     * @param pInput the input frames
+     * @param frameCount the number of frames
+     * @param leftFrom the gain of the left channel at the first frame
+     * @param rightFrom the gain of the right channel at the first frame
+     * @param leftTo the gain of the left channel after the last frame
+     * @param rightTo the gain of the right channel after the last frame
+     */
+    static void mixStereo(float *pOutput, const float *pInput, ma_uint32 frameCount,
+                          float leftFrom, float rightFrom, float leftTo, float rightTo);
+
+    /**
+     * Limit the summed bus: the gain follows the stereo peaks down fast and recovers slowly,
+     * so a loud moment turns the whole mix down instead of distorting it.
+     * The peaks which are faster than the attack are caught by softLimit at the end.
+     *
+     * @param pFrames the frames
+     * @param frameCount the number of frames
+     * @param sampleRate the sample rate of the frames
+     * @param gain the limiter gain, it has to be kept between the calls and start at 1
+     */
+    static void limit(float *pFrames, ma_uint32 frameCount, ma_uint32 sampleRate, float &gain);
+
+    /**
+     * Bend the samples above the threshold smoothly towards 1, so the mix never goes out of [-1, 1].
+     *
+     * @param pSamples the samples
+     * @param sampleCount the number of samples (not frames)
+     */
+    static void softLimit(float *pSamples, ma_uint32 sampleCount);
+};
+
+#endif // RPG_AUDIOMIXER_H
@@ -1,6 +1,8 @@
 #include "../../pch.h"
 #include "AudioSource.h"
 
+#include "AudioDevice.h"
+
 AudioSource::AudioSource(IAudioClip &audioClip)
     : m_audioClip(audioClip) {}
 
@@ -16,23 +18,23 @@ AudioState AudioSource::getState() const
 
 void AudioSource::play()
 {
-    m_mutex.lock();
+    if (m_state == AudioState::Play) return;
     m_state = AudioState::Play;
-    m_mutex.unlock();
+    send(AudioCommandType::Play);
 }
 
 void AudioSource::pause()
 {
-    m_mutex.lock();
+    if (m_state == AudioState::Pause) return;
     m_state = AudioState::Pause;
-    m_mutex.unlock();
+    send(AudioCommandType::Pause);
 }
 
 void AudioSource::stop()
 {
-    m_mutex.lock();
+    if (m_state == AudioState::Stop) return;
     m_state = AudioState::Stop;
-    m_mutex.unlock();
+    send(AudioCommandType::Stop);
 }
 
 float AudioSource::getVolume() const
@@ -42,9 +44,9 @@ float AudioSource::getVolume() const
 
 void AudioSource::setVolume(float volume)
 {
-    m_mutex.lock();
+    if (m_volume == volume) return;
     m_volume = volume;
-    m_mutex.unlock();
+    send(AudioCommandType::SetVolume, volume);
 }
 
 float AudioSource::getPan() const
@@ -54,9 +56,21 @@ float AudioSource::getPan() const
 
 void AudioSource::setPan(float pan)
 {
-    m_mutex.lock();
+    if (m_pan == pan) return;
     m_pan = pan;
-    m_mutex.unlock();
+    send(AudioCommandType::SetPan, pan);
+}
+
+float AudioSource::getPitch() const
+{
+    return m_pitch;
+}
+
+void AudioSource::setPitch(float pitch)
+{
+    if (m_pitch == pitch) return;
+    m_pitch = pitch;
+    send(AudioCommandType::SetPitch, pitch);
 }
 
 bool AudioSource::isLoop() const
@@ -66,7 +80,38 @@ bool AudioSource::isLoop() const
 
 void AudioSource::setLoop(bool loop)
 {
-    m_mutex.lock();
+    if (m_loop == loop) return;
     m_loop = loop;
-    m_mutex.unlock();
+    send(AudioCommandType::SetLoop, loop ? 1.f : 0.f);
+}
+
+int AudioSource::getPriority() const
+{
+    return m_priority;
+}
+
+void AudioSource::setPriority(int priority)
+{
+    // The priority matters only for the game thread, so there is nothing to send
+    m_priority = priority;
+}
+
+bool AudioSource::isReal() const
+{
+    return m_real;
+}
+
+bool AudioSource::pollFinished()
+{
+    bool finished = m_finished;
+    m_finished = false;
+    return finished;
+}
+
+void AudioSource::send(AudioCommandType type, float value)
+{
+    if (m_device)
+    {
+        m_device->sendCommand({type, m_voice, value});
+    }
 }
@@ -1,13 +1,16 @@
 #ifndef RPG_AUDIOSOURCE_H
 #define RPG_AUDIOSOURCE_H
 
-#include <mutex>
 #include "IAudioClip.h"
 #include "../../utils/Types.h"
 #include "AudioState.h"
+#include "AudioCommand.h"
+
+class AudioDevice;
 
 /**
  * Audio source class. Contains the necessary configuration to play audio.
+ * It lives in the game thread, every change is sent to the audio device as a command, but only if something has changed.
  */
 class AudioSource
 {
@@ -17,9 +20,19 @@ class AudioSource
 
     float m_volume{1.f};
     float m_pan{0.f};
+    float m_pitch{1.f};
     bool m_loop{false};
+    int m_priority{0};
+
+    // Is the voice decoded for real or only its cursor is moved
+    bool m_real{false};
 
-    std::mutex m_mutex;
+    // Set by the device when the sound reached the end
+    bool m_finished{false};
+
+    // The device this source is added to
+    AudioDevice *m_device{};
+    u32 m_voice{};
 
 public:
 
@@ -95,6 +108,23 @@ public:
      */
     void setPan(float pan);
 
+    /**
+     * Get the pitch of the sound.
+     *
+     * @return the pitch
+     */
+    float getPitch() const;
+
+    /**
+     * Set the pitch of the sound, it changes the speed as well.
+     * 0.5f - an octave lower
+     * 1.f - original
+     * 2.f - an octave higher
+     *
+     * @param pitch the pitch
+     */
+    void setPitch(float pitch);
+
     /**
      * Is the audio source is looped?
      *
@@ -108,6 +138,40 @@ public:
      * @param loop make a loop or not
      */
     void setLoop(bool loop);
+
+    /**
+     * Get the priority of the sound.
+     *
+     * @return the priority
+     */
+    int getPriority() const;
+
+    /**
+     * Set the priority of the sound.
+     * When there are more playing sounds than real voices, the sounds with higher priority are heard first.
+     *
+     * @param priority the priority
+     */
+    void setPriority(int priority);
+
+    /**
+     * Is the sound decoded for real? Virtual sounds aren't heard, only their play cursor moves.
+     *
+     * @return true if the sound is real
+     */
+    bool isReal() const;
+
+    /**
+     * Check if the sound has reached the end since the last call.
+     *
+     * @return true if it has finished
+     */
+    bool pollFinished();
+
+private:
+    void send(AudioCommandType type, float value = 0.f);
+
+    friend class AudioDevice;
 };
 
 #endif //RPG_AUDIOSOURCE_H
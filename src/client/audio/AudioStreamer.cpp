@@ -0,0 +1,73 @@
+#include "../../pch.h"
+#include "AudioStreamer.h"
+
+#include <algorithm>
+#include "StreamAudioSource.h"
+
+AudioStreamer::~AudioStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_wake.notify_all();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void AudioStreamer::add(StreamAudioSource *source)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_sources.push_back(source);
+
+        // Fill the buffer right away, so the sound doesn't start with silence
+        source->fill();
+
+        if (!m_running)
+        {
+            m_running = true;
+            m_thread = std::thread(&AudioStreamer::run, this);
+        }
+    }
+}
+
+void AudioStreamer::remove(StreamAudioSource *source)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = std::find(m_sources.begin(), m_sources.end(), source);
+    if (it != m_sources.end())
+    {
+        m_removedUnderruns += source->getUnderrunCount();
+        m_sources.erase(it);
+    }
+}
+
+u32 AudioStreamer::getUnderrunCount() const
+{
+    return m_underruns.load(std::memory_order_relaxed);
+}
+
+void AudioStreamer::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running)
+    {
+        u32 underruns = m_removedUnderruns;
+        for (auto *source : m_sources)
+        {
+            source->fill();
+            underruns += source->getUnderrunCount();
+        }
+
+        if (underruns != m_underruns.load(std::memory_order_relaxed))
+        {
+            std::cout << "Audio stream underrun, " << underruns << " in total" << std::endl;
+            m_underruns.store(underruns, std::memory_order_relaxed);
+        }
+
+        m_wake.wait_for(lock, std::chrono::milliseconds(STREAMER_PERIOD_MS), [this] { return !m_running; });
+    }
+}
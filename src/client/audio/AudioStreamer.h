@@ -0,0 +1,66 @@
+#ifndef RPG_AUDIOSTREAMER_H
+#define RPG_AUDIOSTREAMER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../../utils/Types.h"
+
+// How often the streamer tops up the buffers
+#define STREAMER_PERIOD_MS 10
+
+class StreamAudioSource;
+
+/**
+ * Background thread which reads and decodes the streamed audio files ahead of the audio thread.
+ * All the disk access of the streamed sounds happens here.
+ */
+class AudioStreamer
+{
+    std::vector<StreamAudioSource *> m_sources;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::thread m_thread;
+    bool m_running{false};
+
+    // Underruns of the removed sources, so the total never goes down
+    u32 m_removedUnderruns{0};
+    std::atomic<u32> m_underruns{0};
+
+public:
+    AudioStreamer() = default;
+
+    ~AudioStreamer();
+
+    AudioStreamer(const AudioStreamer &) = delete;
+    AudioStreamer &operator=(const AudioStreamer &) = delete;
+
+    /**
+     * Start decoding the source. The thread is started with the first source.
+     *
+     * @param source the source
+     */
+    void add(StreamAudioSource *source);
+
+    /**
+     * Stop decoding the source. When it returns, the streamer doesn't use the source anymore.
+     *
+     * @param source the source
+     */
+    void remove(StreamAudioSource *source);
+
+    /**
+     * Get the number of times a streamed sound ran out of decoded frames.
+     *
+     * @return the total number of underruns
+     */
+    u32 getUnderrunCount() const;
+
+private:
+    void run();
+};
+
+#endif // RPG_AUDIOSTREAMER_H
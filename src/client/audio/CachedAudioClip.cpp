@@ -17,8 +17,29 @@ std::string CachedAudioClip::getPath() const
     return m_path;
 }
 
-void CachedAudioClip::createDecoder(ma_decoder* decoder, ma_decoder_config* config) const
+std::size_t CachedAudioClip::getDataSize() const
 {
-    ma_decoder_init_memory(m_data.data(), m_data.size() * sizeof(char), config, decoder);
+    return m_data.size();
+}
+
+ma_data_source *CachedAudioClip::createDataSource() const
+{
+    auto *decoder = new ma_decoder();
+    // The native sample rate is kept, the mixer resamples only if it's needed
+    ma_decoder_config config = ma_decoder_config_init(FORMAT, CHANNELS, 0);
+    if (ma_decoder_init_memory(m_data.data(), m_data.size() * sizeof(char), &config, decoder) != MA_SUCCESS)
+    {
+        std::cerr << "Failed to decode audio clip " << m_path << std::endl;
+        delete decoder;
+        return nullptr;
+    }
+    return decoder;
+}
+
+void CachedAudioClip::destroyDataSource(ma_data_source *dataSource) const
+{
+    auto *decoder = (ma_decoder *) dataSource;
+    ma_decoder_uninit(decoder);
+    delete decoder;
 }
 
@@ -25,8 +25,17 @@ public:
 
     virtual std::string getPath() const;
 
+    /**
+     * Get the size of the encoded data kept in memory.
+     *
+     * @return the size in bytes
+     */
+    std::size_t getDataSize() const;
+
 protected:
-    virtual void createDecoder(ma_decoder* decoder, ma_decoder_config* config) const;
+    virtual ma_data_source *createDataSource() const;
+
+    virtual void destroyDataSource(ma_data_source *dataSource) const;
 };
 
 #endif //RPG_CACHEDAUDIOCLIP_H
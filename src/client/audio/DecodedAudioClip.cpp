@@ -0,0 +1,176 @@
+#include "../../pch.h"
+#include "DecodedAudioClip.h"
+
+#include <algorithm>
+#include <cstring>
+#include "AudioDevice.h"
+
+// The worker publishes the progress after every piece of this size
+#define DECODE_CHUNK_FRAMES 4096
+
+/**
+ * Reads the frames of a decoded clip, it's just a cursor into the shared memory.
+ * The base must be the first member, miniaudio casts the pointer to it.
+ */
+struct DecodedAudioSource
+{
+    ma_data_source_base base;
+    const DecodedAudioClip *clip;
+    ma_uint64 cursor;
+
+    static ma_result onRead(ma_data_source *pDataSource, void *pFramesOut, ma_uint64 frameCount, ma_uint64 *pFramesRead)
+    {
+        auto *source = (DecodedAudioSource *) pDataSource;
+        const DecodedAudioClip *clip = source->clip;
+
+        // Load the flag first: once it's set, all frames are decoded
+        bool ready = clip->m_ready.load(std::memory_order_acquire);
+        ma_uint64 decoded = clip->m_decodedFrames.load(std::memory_order_acquire);
+
+        ma_uint64 framesRead = std::min(frameCount, decoded - std::min(source->cursor, decoded));
+        if (pFramesOut)
+        {
+            std::memcpy(pFramesOut, clip->m_frames.data() + source->cursor * CHANNELS,
+                        framesRead * CHANNELS * sizeof(float));
+        }
+        source->cursor += framesRead;
+
+        if (framesRead < frameCount && !ready)
+        {
+            // The worker hasn't got here yet, wait in silence without moving the cursor.
+            // A short read would mean the end of the sound to the mixer
+            if (pFramesOut)
+            {
+                std::memset((float *) pFramesOut + framesRead * CHANNELS, 0,
+                            (frameCount - framesRead) * CHANNELS * sizeof(float));
+            }
+            *pFramesRead = frameCount;
+            return MA_SUCCESS;
+        }
+
+        *pFramesRead = framesRead;
+        return framesRead < frameCount ? MA_AT_END : MA_SUCCESS;
+    }
+
+    static ma_result onSeek(ma_data_source *pDataSource, ma_uint64 frameIndex)
+    {
+        auto *source = (DecodedAudioSource *) pDataSource;
+        if (frameIndex > source->clip->m_frameCount)
+        {
+            return MA_INVALID_ARGS;
+        }
+        source->cursor = frameIndex;
+        return MA_SUCCESS;
+    }
+
+    static ma_result onGetDataFormat(ma_data_source *pDataSource, ma_format *pFormat, ma_uint32 *pChannels,
+                                     ma_uint32 *pSampleRate)
+    {
+        *pFormat = FORMAT;
+        *pChannels = CHANNELS;
+        *pSampleRate = SAMPLE_RATE;
+        return MA_SUCCESS;
+    }
+
+    static ma_result onGetCursor(ma_data_source *pDataSource, ma_uint64 *pCursor)
+    {
+        *pCursor = ((DecodedAudioSource *) pDataSource)->cursor;
+        return MA_SUCCESS;
+    }
+
+    static ma_result onGetLength(ma_data_source *pDataSource, ma_uint64 *pLength)
+    {
+        *pLength = ((DecodedAudioSource *) pDataSource)->clip->m_frameCount;
+        return MA_SUCCESS;
+    }
+};
+
+static ma_data_source_vtable decodedAudioSourceVtable = {
+    DecodedAudioSource::onRead,
+    DecodedAudioSource::onSeek,
+    nullptr,
+    nullptr,
+    DecodedAudioSource::onGetDataFormat,
+    DecodedAudioSource::onGetCursor,
+    DecodedAudioSource::onGetLength
+};
+
+DecodedAudioClip::DecodedAudioClip(const std::string &path)
+        : m_path(path)
+{
+    ma_decoder_config config = ma_decoder_config_init(FORMAT, CHANNELS, SAMPLE_RATE);
+    if (ma_decoder_init_file(path.c_str(), &config, &m_decoder) != MA_SUCCESS)
+    {
+        std::cerr << "Failed to open audio clip " << path << std::endl;
+        m_ready = true;
+        return;
+    }
+
+    // The memory is allocated here, so the audio thread can read the decoded part while the rest is being written
+    m_frameCount = ma_decoder_get_length_in_pcm_frames(&m_decoder);
+    m_frames.resize(m_frameCount * CHANNELS);
+
+    m_worker = std::thread(&DecodedAudioClip::decode, this);
+}
+
+DecodedAudioClip::~DecodedAudioClip()
+{
+    if (m_worker.joinable())
+    {
+        m_worker.join();
+    }
+}
+
+std::string DecodedAudioClip::getPath() const
+{
+    return m_path;
+}
+
+bool DecodedAudioClip::isReady() const
+{
+    return m_ready.load(std::memory_order_acquire);
+}
+
+std::size_t DecodedAudioClip::getDataSize() const
+{
+    return m_frames.size() * sizeof(float);
+}
+
+ma_data_source *DecodedAudioClip::createDataSource() const
+{
+    auto *source = new DecodedAudioSource();
+    ma_data_source_config config = ma_data_source_config_init();
+    config.vtable = &decodedAudioSourceVtable;
+    ma_data_source_init(&config, &source->base);
+    source->clip = this;
+    source->cursor = 0;
+    return source;
+}
+
+void DecodedAudioClip::destroyDataSource(ma_data_source *dataSource) const
+{
+    auto *source = (DecodedAudioSource *) dataSource;
+    ma_data_source_uninit(&source->base);
+    delete source;
+}
+
+void DecodedAudioClip::decode()
+{
+    ma_uint64 decoded = 0;
+    while (decoded < m_frameCount)
+    {
+        ma_uint64 framesToRead = std::min<ma_uint64>(DECODE_CHUNK_FRAMES, m_frameCount - decoded);
+        ma_uint64 framesRead = ma_decoder_read_pcm_frames(&m_decoder, m_frames.data() + decoded * CHANNELS,
+                                                          framesToRead);
+        decoded += framesRead;
+        m_decodedFrames.store(decoded, std::memory_order_release);
+
+        if (framesRead < framesToRead)
+        {
+            // The file is shorter than the decoder guessed, the rest stays silent
+            break;
+        }
+    }
+    ma_decoder_uninit(&m_decoder);
+    m_ready.store(true, std::memory_order_release);
+}
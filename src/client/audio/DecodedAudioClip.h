@@ -0,0 +1,73 @@
+#ifndef RPG_DECODEDAUDIOCLIP_H
+#define RPG_DECODEDAUDIOCLIP_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "IAudioClip.h"
+
+/**
+ * This class decodes the whole audio clip into memory once, in the format of the audio device.
+ * Playing it costs nothing but copying, so it's the best for short sounds which are played often.
+ *
+ * The decoding is done on a worker thread. The clip can be played right away,
+ * the sources are silent until the part they need is decoded.
+ */
+class DecodedAudioClip : public IAudioClip
+{
+    std::string m_path;
+
+    // Interleaved frames, allocated before the decoding starts and never resized
+    std::vector<float> m_frames;
+    ma_uint64 m_frameCount{};
+
+    // How many frames are already decoded, the audio thread reads only them
+    std::atomic<ma_uint64> m_decodedFrames{0};
+    std::atomic<bool> m_ready{false};
+
+    ma_decoder m_decoder{};
+    std::thread m_worker;
+
+public:
+
+    /**
+     * Create an audio clip and start decoding it.
+     *
+     * @param path the file path
+     */
+    DecodedAudioClip(const std::string &path);
+
+    ~DecodedAudioClip() override;
+
+    DecodedAudioClip(const DecodedAudioClip &) = delete;
+    DecodedAudioClip &operator=(const DecodedAudioClip &) = delete;
+
+    virtual std::string getPath() const;
+
+    /**
+     * Check if the whole clip is decoded.
+     *
+     * @return true if it's decoded
+     */
+    bool isReady() const;
+
+    /**
+     * Get the size of the decoded frames kept in memory.
+     *
+     * @return the size in bytes
+     */
+    std::size_t getDataSize() const;
+
+protected:
+    virtual ma_data_source *createDataSource() const;
+
+    virtual void destroyDataSource(ma_data_source *dataSource) const;
+
+private:
+    void decode();
+
+    friend struct DecodedAudioSource;
+};
+
+#endif //RPG_DECODEDAUDIOCLIP_H
@@ -22,12 +22,19 @@ public:
 protected:
 
     /**
-     * Create a decoder for the audio clip.
+     * Create a data source which reads the clip in the format of the audio device.
+     * Every audio source gets its own data source, so they can play the same clip independently.
      *
-     * @param decoder the decoder
-     * @param config the config
+     * @return the data source or nullptr if the clip can't be read
      */
-    virtual void createDecoder(ma_decoder* decoder, ma_decoder_config* config) const = 0;
+    virtual ma_data_source *createDataSource() const = 0;
+
+    /**
+     * Destroy a data source created by this clip.
+     *
+     * @param dataSource the data source
+     */
+    virtual void destroyDataSource(ma_data_source *dataSource) const = 0;
 
     friend class AudioDevice;
 };
@@ -1,6 +1,7 @@
 #include "../../pch.h"
 #include "StreamAudioClip.h"
 #include "AudioDevice.h"
+#include "StreamAudioSource.h"
 
 StreamAudioClip::StreamAudioClip(const std::string &path)
         : m_path(path) {}
@@ -10,9 +11,13 @@ std::string StreamAudioClip::getPath() const
     return m_path;
 }
 
-void StreamAudioClip::createDecoder(ma_decoder *decoder, ma_decoder_config* config) const
+ma_data_source *StreamAudioClip::createDataSource() const
 {
-    // If I get it correctly, it works by default as we need
-    ma_decoder_init_file(m_path.c_str(), config, decoder);
+    // The file is decoded ahead on the streamer thread, the audio thread never waits for the disk
+    return StreamAudioSource::create(m_path);
 }
 
+void StreamAudioClip::destroyDataSource(ma_data_source *dataSource) const
+{
+    StreamAudioSource::destroy((StreamAudioSource *) dataSource);
+}
@@ -6,6 +6,7 @@
 
  /**
   * This class doesn't store anything in memory, it plays the file directly from the disk.
+  * Every source has a small buffer which is filled ahead by the audio streamer thread.
   * It's better to use for long audio files.
   */
 class StreamAudioClip : public IAudioClip
@@ -23,7 +24,9 @@ public:
     virtual std::string getPath() const;
 
 protected:
-    virtual void createDecoder(ma_decoder* decoder, ma_decoder_config* config) const;
+    virtual ma_data_source *createDataSource() const;
+
+    virtual void destroyDataSource(ma_data_source *dataSource) const;
 };
 
 #endif //RPG_STREAMAUDIOCLIP_H
@@ -0,0 +1,234 @@
+#include "../../pch.h"
+#include "StreamAudioSource.h"
+
+#include <algorithm>
+#include <cstring>
+#include "AudioDevice.h"
+#include "AudioStreamer.h"
+#include "../Engine.h"
+
+ma_data_source_vtable StreamAudioSource::s_vtable = {
+    StreamAudioSource::onRead,
+    StreamAudioSource::onSeek,
+    nullptr,
+    nullptr,
+    StreamAudioSource::onGetDataFormat,
+    StreamAudioSource::onGetCursor,
+    StreamAudioSource::onGetLength
+};
+
+StreamAudioSource *StreamAudioSource::create(const std::string &path)
+{
+    auto *source = new StreamAudioSource();
+
+    // The native sample rate is kept, the mixer resamples only if it's needed
+    ma_decoder_config decoderConfig = ma_decoder_config_init(FORMAT, CHANNELS, 0);
+    if (ma_decoder_init_file(path.c_str(), &decoderConfig, &source->m_decoder) != MA_SUCCESS)
+    {
+        std::cerr << "Failed to open audio clip " << path << std::endl;
+        delete source;
+        return nullptr;
+    }
+
+    if (ma_pcm_rb_init(FORMAT, CHANNELS, source->m_decoder.outputSampleRate * STREAM_BUFFER_MS / 1000, nullptr, nullptr,
+                       &source->m_ring) != MA_SUCCESS)
+    {
+        std::cerr << "Failed to allocate the stream buffer for " << path << std::endl;
+        ma_decoder_uninit(&source->m_decoder);
+        delete source;
+        return nullptr;
+    }
+
+    ma_data_source_config config = ma_data_source_config_init();
+    config.vtable = &s_vtable;
+    ma_data_source_init(&config, &source->m_base);
+
+    source->m_length = ma_decoder_get_length_in_pcm_frames(&source->m_decoder);
+
+    Engine::getAudioStreamer().add(source);
+    return source;
+}
+
+void StreamAudioSource::destroy(StreamAudioSource *source)
+{
+    // After this the streamer doesn't touch the source anymore
+    Engine::getAudioStreamer().remove(source);
+
+    ma_data_source_uninit(&source->m_base);
+    ma_pcm_rb_uninit(&source->m_ring);
+    ma_decoder_uninit(&source->m_decoder);
+    delete source;
+}
+
+void StreamAudioSource::fill()
+{
+    u32 request = m_seekRequest.load(std::memory_order_acquire);
+    if (request != m_seekDone.load(std::memory_order_relaxed))
+    {
+        // Wait until the audio thread has thrown away everything decoded before the seek
+        if (ma_pcm_rb_available_read(&m_ring) > 0 || !m_ends.empty()) return;
+
+        ma_decoder_seek_to_pcm_frame(&m_decoder, m_seekFrame.load(std::memory_order_relaxed));
+        m_produced = 0;
+        m_hasPendingEnd = false;
+        m_seekDone.store(request, std::memory_order_release);
+    }
+
+    while (true)
+    {
+        if (m_hasPendingEnd)
+        {
+            if (!m_ends.push(m_pendingEnd)) return;
+            m_hasPendingEnd = false;
+        }
+
+        ma_uint32 framesToWrite = ma_pcm_rb_available_write(&m_ring);
+        if (framesToWrite == 0) return;
+
+        void *buffer;
+        ma_pcm_rb_acquire_write(&m_ring, &framesToWrite, &buffer);
+        ma_uint64 framesRead = ma_decoder_read_pcm_frames(&m_decoder, buffer, framesToWrite);
+        ma_pcm_rb_commit_write(&m_ring, (ma_uint32) framesRead, buffer);
+        m_produced += framesRead;
+
+        if (framesRead < framesToWrite)
+        {
+            // The file has ended, remember where and go on from the start
+            m_pendingEnd = m_produced;
+            m_hasPendingEnd = true;
+            ma_decoder_seek_to_pcm_frame(&m_decoder, 0);
+
+            // An empty or broken file would loop here forever
+            if (framesRead == 0 && m_produced == 0) return;
+        }
+    }
+}
+
+u32 StreamAudioSource::getUnderrunCount() const
+{
+    return m_underruns.load(std::memory_order_relaxed);
+}
+
+void StreamAudioSource::drain()
+{
+    ma_pcm_rb_seek_read(&m_ring, ma_pcm_rb_available_read(&m_ring));
+    ma_uint64 end;
+    while (m_ends.pop(end)) {}
+    m_hasNextEnd = false;
+}
+
+ma_result StreamAudioSource::onRead(ma_data_source *pDataSource, void *pFramesOut, ma_uint64 frameCount,
+                                    ma_uint64 *pFramesRead)
+{
+    auto *source = (StreamAudioSource *) pDataSource;
+    auto *output = (float *) pFramesOut;
+
+    if (source->m_flushing)
+    {
+        if (source->m_seekDone.load(std::memory_order_acquire) != source->m_seekGeneration)
+        {
+            // The streamer hasn't seeked yet, everything in the buffer is from the old position
+            source->drain();
+            if (output)
+            {
+                std::memset(output, 0, frameCount * CHANNELS * sizeof(float));
+            }
+            *pFramesRead = frameCount;
+            return MA_SUCCESS;
+        }
+        source->m_flushing = false;
+        source->m_consumed = 0;
+    }
+
+    // The streamer publishes an end before the frames after it, so looking at the buffer first
+    // guarantees that we know about every end inside the frames we are going to read
+    ma_uint64 framesToRead = std::min<ma_uint64>(frameCount, ma_pcm_rb_available_read(&source->m_ring));
+    if (!source->m_hasNextEnd)
+    {
+        source->m_hasNextEnd = source->m_ends.pop(source->m_nextEnd);
+    }
+
+    // Never read past the end of the file, the frames after it are from the start
+    if (source->m_hasNextEnd)
+    {
+        framesToRead = std::min(framesToRead, source->m_nextEnd - source->m_consumed);
+    }
+
+    ma_uint64 framesRead = 0;
+    while (framesRead < framesToRead)
+    {
+        auto frames = (ma_uint32) std::min<ma_uint64>(framesToRead - framesRead, UINT32_MAX);
+        void *buffer;
+        ma_pcm_rb_acquire_read(&source->m_ring, &frames, &buffer);
+        if (frames == 0) break;
+
+        if (output)
+        {
+            std::memcpy(output + framesRead * CHANNELS, buffer, frames * CHANNELS * sizeof(float));
+        }
+        ma_pcm_rb_commit_read(&source->m_ring, frames, buffer);
+        framesRead += frames;
+    }
+    source->m_consumed += framesRead;
+    source->m_cursor += framesRead;
+
+    if (source->m_hasNextEnd && source->m_consumed == source->m_nextEnd)
+    {
+        *pFramesRead = framesRead;
+        return MA_AT_END;
+    }
+
+    if (framesRead < frameCount)
+    {
+        // The streamer is late, play silence instead of waiting for it
+        if (output)
+        {
+            std::memset(output + framesRead * CHANNELS, 0, (frameCount - framesRead) * CHANNELS * sizeof(float));
+        }
+        source->m_underruns.fetch_add(1, std::memory_order_relaxed);
+    }
+    *pFramesRead = frameCount;
+    return MA_SUCCESS;
+}
+
+ma_result StreamAudioSource::onSeek(ma_data_source *pDataSource, ma_uint64 frameIndex)
+{
+    auto *source = (StreamAudioSource *) pDataSource;
+
+    // Going back to the start right at the end of the file, the streamer is already there
+    if (frameIndex == 0 && !source->m_flushing && source->m_hasNextEnd && source->m_consumed == source->m_nextEnd)
+    {
+        source->m_hasNextEnd = false;
+        source->m_cursor = 0;
+        return MA_SUCCESS;
+    }
+
+    source->m_cursor = frameIndex;
+    source->m_flushing = true;
+    source->m_seekGeneration++;
+    source->m_seekFrame.store(frameIndex, std::memory_order_relaxed);
+    source->m_seekRequest.store(source->m_seekGeneration, std::memory_order_release);
+    source->drain();
+    return MA_SUCCESS;
+}
+
+ma_result StreamAudioSource::onGetDataFormat(ma_data_source *pDataSource, ma_format *pFormat, ma_uint32 *pChannels,
+                                             ma_uint32 *pSampleRate)
+{
+    *pFormat = FORMAT;
+    *pChannels = CHANNELS;
+    *pSampleRate = ((StreamAudioSource *) pDataSource)->m_decoder.outputSampleRate;
+    return MA_SUCCESS;
+}
+
+ma_result StreamAudioSource::onGetCursor(ma_data_source *pDataSource, ma_uint64 *pCursor)
+{
+    *pCursor = ((StreamAudioSource *) pDataSource)->m_cursor;
+    return MA_SUCCESS;
+}
+
+ma_result StreamAudioSource::onGetLength(ma_data_source *pDataSource, ma_uint64 *pLength)
+{
+    *pLength = ((StreamAudioSource *) pDataSource)->m_length;
+    return *pLength > 0 ? MA_SUCCESS : MA_NOT_IMPLEMENTED;
+}
@@ -0,0 +1,101 @@
+#ifndef RPG_STREAMAUDIOSOURCE_H
+#define RPG_STREAMAUDIOSOURCE_H
+
+#include <atomic>
+#include <string>
+#include <miniaudio.h>
+#include "../../utils/Types.h"
+#include "../../utils/SpscQueue.h"
+
+// How much audio is decoded ahead
+#define STREAM_BUFFER_MS 300
+
+/**
+ * A data source which plays a file decoded ahead by the audio streamer.
+ *
+ * The streamer thread is the only user of the decoder, it fills the ring buffer.
+ * The audio thread only copies from the ring buffer, so slow disk access never reaches it.
+ * If the ring buffer runs dry anyway, the missing part is played as silence and counted as an underrun.
+ *
+ * The streamer always keeps decoding from the start when the file ends and tells where the end was,
+ * so looped sounds continue seamlessly. Other seeks throw away everything decoded before them.
+ */
+class StreamAudioSource
+{
+    ma_data_source_base m_base; // must be the first member, miniaudio casts the pointer to it
+
+    ma_decoder m_decoder{};
+    ma_pcm_rb m_ring{};
+    ma_uint64 m_length{};
+
+    // Seeking: the audio thread asks, the streamer answers when the old frames are gone
+    std::atomic<u32> m_seekRequest{0};
+    std::atomic<u32> m_seekDone{0};
+    std::atomic<ma_uint64> m_seekFrame{0};
+
+    // Positions in the decoded stream where the file ended and started again
+    SpscQueue<ma_uint64, 16> m_ends;
+
+    std::atomic<u32> m_underruns{0};
+
+    // Streamer thread data
+    ma_uint64 m_produced{0};
+    ma_uint64 m_pendingEnd{0};
+    bool m_hasPendingEnd{false};
+
+    // Audio thread data
+    ma_uint64 m_consumed{0};
+    ma_uint64 m_cursor{0};
+    ma_uint64 m_nextEnd{0};
+    bool m_hasNextEnd{false};
+    u32 m_seekGeneration{0};
+    bool m_flushing{false};
+
+    StreamAudioSource() = default;
+
+public:
+    /**
+     * Open the file and register the source in the streamer.
+     *
+     * @param path the file path
+     * @return the data source or nullptr if the file can't be opened
+     */
+    static StreamAudioSource *create(const std::string &path);
+
+    /**
+     * Unregister the source from the streamer and close the file.
+     *
+     * @param source the data source
+     */
+    static void destroy(StreamAudioSource *source);
+
+    /**
+     * Decode ahead until the ring buffer is full. Called only by the streamer thread.
+     */
+    void fill();
+
+    /**
+     * Get the number of times the audio thread found the ring buffer empty.
+     *
+     * @return the number of underruns
+     */
+    u32 getUnderrunCount() const;
+
+private:
+    void drain();
+
+    static ma_result onRead(ma_data_source *pDataSource, void *pFramesOut, ma_uint64 frameCount, ma_uint64 *pFramesRead);
+
+    static ma_result onSeek(ma_data_source *pDataSource, ma_uint64 frameIndex);
+
+    static ma_result onGetDataFormat(ma_data_source *pDataSource, ma_format *pFormat, ma_uint32 *pChannels,
+                                     ma_uint32 *pSampleRate);
+
+    static ma_result onGetCursor(ma_data_source *pDataSource, ma_uint64 *pCursor);
+
+    static ma_result onGetLength(ma_data_source *pDataSource, ma_uint64 *pLength);
+
+    static ma_data_source_vtable s_vtable;
+};
+
+#endif // RPG_STREAMAUDIOSOURCE_H
@@ -100,6 +100,16 @@ int Font::getSize() const
     return m_size;
 }
 
+std::size_t Font::getCpuMemorySize() const
+{
+    return m_pixelBuffer.capacity() + m_characters.size() * sizeof(std::pair<const char, Character>);
+}
+
+std::size_t Font::getGpuMemorySize() const
+{
+    return m_texture.getGpuMemorySize();
+}
+
 Texture &Font::getTexture()
 {
     return m_texture;
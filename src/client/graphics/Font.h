@@ -31,6 +31,20 @@ public:
 
     int getSize() const;
 
+    /**
+     * Get the memory used by the glyph data on the CPU side.
+     *
+     * @return the size in bytes
+     */
+    std::size_t getCpuMemorySize() const;
+
+    /**
+     * Estimate the video memory used by the glyph atlas.
+     *
+     * @return the size in bytes
+     */
+    std::size_t getGpuMemorySize() const;
+
     void destroy();
 
 private:
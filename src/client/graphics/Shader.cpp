@@ -1,7 +1,10 @@
 #include "../../pch.h"
 #include "Shader.h"
+#include <chrono>
+#include <filesystem>
 #include <fstream>
-#include <sstream>
+
+#include "../../utils/Hash.h"
 
 Shader::Shader(unsigned int m_id) : m_id(m_id) { }
 
@@ -40,56 +43,67 @@ void checkCompileErrors(unsigned int glHandel, unsigned int status,
 
 Shader Shader::createShader(const std::string& vertexPath, const std::string& fragmentPath)
 {
-    unsigned int shaderProgram = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::string name = std::filesystem::path(vertexPath).stem().string();
+
+    std::string vertexSource = readFile(vertexPath);
+    std::string fragmentSource = readFile(fragmentPath);
+
+    // A program binary works only with the driver that created it, so the driver is a part of the key
+    u64 hash = Hash::fnv1a(vertexSource + '\0' + fragmentSource + '\0' + getDriverString());
+    std::string cachePath = TRUERPG_CACHE_DIR "/shaders/" + Hash::toHex(hash) + ".bin";
+
+    unsigned int shaderProgram = loadProgramBinary(cachePath);
+    if (shaderProgram)
+    {
+        std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+        std::cout << "Shader " << name << " loaded from cache in " << time.count() << " ms" << std::endl;
+        return Shader(shaderProgram);
+    }
 
-    unsigned int vertexShader = compileShader(vertexPath, GL_VERTEX_SHADER);
-    unsigned int fragmentShader = compileShader(fragmentPath, GL_FRAGMENT_SHADER);
+    unsigned int vertexShader = compileShader(vertexSource, GL_VERTEX_SHADER);
+    unsigned int fragmentShader = compileShader(fragmentSource, GL_FRAGMENT_SHADER);
 
     shaderProgram = glCreateProgram();
 
     glAttachShader(shaderProgram, vertexShader);
     glAttachShader(shaderProgram, fragmentShader);
 
+    glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(shaderProgram);
     checkCompileErrors(shaderProgram, GL_LINK_STATUS, glGetProgramiv, glGetProgramInfoLog);
 
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
 
+    std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+    std::cout << "Shader " << name << " compiled in " << time.count() << " ms" << std::endl;
+
+    saveProgramBinary(shaderProgram, cachePath);
+
     return Shader(shaderProgram);
 }
 
-unsigned int Shader::compileShader(const std::string& path, unsigned int type)
+std::string Shader::readFile(const std::string& path)
 {
-    std::ifstream shaderFile;
-    std::string shaderCode;
-    unsigned int shader = 0;
-    const char* sCode = nullptr;
-
-    shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    try
-    {
-        // Open the file
-        shaderFile.open(path);
-        std::stringstream shaderStream;
-
-        // Read the contents of file buffers
-        shaderStream << shaderFile.rdbuf();
-
-        // Close the file
-        shaderFile.close();
-
-        // Convert data from the stream into a string
-        shaderCode = shaderStream.str();
-    }
-    catch (std::ifstream::failure &e)
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
     {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
         exit(1);
     }
 
-    sCode = shaderCode.c_str();
-    shader = glCreateShader(type);
+    // Read the whole file in one go
+    std::string source((std::size_t) file.tellg(), '\0');
+    file.seekg(0);
+    file.read(source.data(), (std::streamsize) source.size());
+    return source;
+}
+
+unsigned int Shader::compileShader(const std::string& source, unsigned int type)
+{
+    const char* sCode = source.c_str();
+    unsigned int shader = glCreateShader(type);
     glShaderSource(shader, 1, (const char* const*)&sCode, nullptr);
     glCompileShader(shader);
     checkCompileErrors(shader, GL_COMPILE_STATUS, glGetShaderiv, glGetShaderInfoLog);
@@ -97,3 +111,75 @@ unsigned int Shader::compileShader(const std::string& path, unsigned int type)
     return shader;
 }
 
+std::string Shader::getDriverString()
+{
+    auto vendor = (const char *) glGetString(GL_VENDOR);
+    auto renderer = (const char *) glGetString(GL_RENDERER);
+    auto version = (const char *) glGetString(GL_VERSION);
+    return std::string(vendor ? vendor : "") + "|" + (renderer ? renderer : "") + "|" + (version ? version : "");
+}
+
+static bool areProgramBinariesSupported()
+{
+    int formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+unsigned int Shader::loadProgramBinary(const std::string& cachePath)
+{
+    if (!areProgramBinariesSupported()) return 0;
+
+    std::ifstream file(cachePath, std::ios::binary | std::ios::ate);
+    if (!file) return 0;
+
+    // The file is the binary format followed by the binary itself
+    auto size = (std::size_t) file.tellg();
+    if (size <= sizeof(u32)) return 0;
+
+    u32 format;
+    std::vector<char> binary(size - sizeof(u32));
+    file.seekg(0);
+    file.read((char *) &format, sizeof(u32));
+    file.read(binary.data(), (std::streamsize) binary.size());
+    if (!file) return 0;
+
+    unsigned int program = glCreateProgram();
+    glProgramBinary(program, format, binary.data(), (int) binary.size());
+
+    // The driver may reject the binary (e.g. after an update), then we just compile the shader again
+    int success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void Shader::saveProgramBinary(unsigned int program, const std::string& cachePath)
+{
+    if (!areProgramBinariesSupported()) return;
+
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    unsigned int format;
+    std::vector<char> binary(length);
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+
+    std::ofstream file(cachePath, std::ios::binary);
+    if (!file)
+    {
+        std::cout << "Failed to write the shader cache " << cachePath << std::endl;
+        return;
+    }
+    u32 storedFormat = format;
+    file.write((const char *) &storedFormat, sizeof(u32));
+    file.write(binary.data(), length);
+}
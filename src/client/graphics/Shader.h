@@ -105,8 +105,17 @@ public:
     static Shader createShader(const std::string& vertexPath, const std::string& fragmentPath);
 
 private:
+    static std::string readFile(const std::string& path);
+
     // Some useful functions to check shader compilation/binding errors
-    static unsigned int compileShader(const std::string& path, unsigned int type);
+    static unsigned int compileShader(const std::string& source, unsigned int type);
+
+    static std::string getDriverString();
+
+    // Program binary cache, returns 0 if there is no usable binary
+    static unsigned int loadProgramBinary(const std::string& cachePath);
+
+    static void saveProgramBinary(unsigned int program, const std::string& cachePath);
 };
 
 #endif //RPG_SHADER_H
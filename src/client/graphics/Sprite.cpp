@@ -68,6 +68,22 @@ void Sprite::setTextureRect(const IntRect &rect)
     m_textureRect = rect;
 }
 
+i32 Sprite::getAnimation() const
+{
+    return m_animation;
+}
+
+float Sprite::getAnimationStart() const
+{
+    return m_animationStart;
+}
+
+void Sprite::setAnimation(i32 animation, float start)
+{
+    m_animation = animation;
+    m_animationStart = start;
+}
+
 FloatRect Sprite::getLocalBounds() const
 {
     return FloatRect(0.f, 0.f,
@@ -4,6 +4,7 @@
 #include <glm/glm.hpp>
 #include "Rect.h"
 #include "Texture.h"
+#include "../../utils/Types.h"
 
 class Sprite
 {
@@ -13,6 +14,8 @@ class Sprite
     glm::vec4 m_color{1.f};
     IntRect m_textureRect{0, 0, 0, 0};
     Texture m_texture{Texture::createEmpty()};
+    i32 m_animation{-1};
+    float m_animationStart{0.f};
 
 public:
     Sprite();
@@ -35,6 +38,17 @@ public:
     IntRect getTextureRect() const;
     void setTextureRect(const IntRect &rect);
 
+    i32 getAnimation() const;
+    float getAnimationStart() const;
+
+    /**
+     * Let the vertex shader animate the sprite, the texture rect is then used only for the size of the sprite.
+     *
+     * @param animation the animation ID from the sprite animation table or -1 to not animate the sprite
+     * @param start the animation clock time when the animation started
+     */
+    void setAnimation(i32 animation, float start);
+
     /**
      * Get the bounds of the sprite in the local coordinates.
      *
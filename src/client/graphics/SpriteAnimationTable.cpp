@@ -0,0 +1,96 @@
+#include "../../pch.h"
+#include "SpriteAnimationTable.h"
+
+#include "Graphics.h"
+
+i32 SpriteAnimationTable::getAnimation(const SpriteAnimationFrame *frames, u16 frameCount)
+{
+    if (frameCount == 0)
+    {
+        return NO_GPU_ANIMATION;
+    }
+
+    auto it = m_animations.find(frames);
+    if (it != m_animations.end())
+    {
+        return it->second;
+    }
+
+    auto id = static_cast<i32>(m_texels.size());
+
+    float endTime = 0.f;
+    for (u16 i = 0; i < frameCount; i++)
+    {
+        endTime += frames[i].duration;
+    }
+    m_texels.emplace_back(frameCount, endTime, 0.f, 0.f);
+
+    endTime = 0.f;
+    for (u16 i = 0; i < frameCount; i++)
+    {
+        const IntRect &rect = frames[i].rect;
+        endTime += frames[i].duration;
+
+        m_texels.emplace_back(rect.getLeft(), rect.getBottom(), rect.getWidth(), rect.getHeight());
+        m_texels.emplace_back(endTime, 0.f, 0.f, 0.f);
+    }
+
+    m_animations.emplace(frames, id);
+    m_dirty = true;
+
+    return id;
+}
+
+void SpriteAnimationTable::advance(float deltaTime)
+{
+    m_time += deltaTime;
+}
+
+float SpriteAnimationTable::getTime() const
+{
+    return static_cast<float>(m_time);
+}
+
+void SpriteAnimationTable::bind(int unit)
+{
+    if (m_texels.empty())
+    {
+        return;
+    }
+
+    if (!m_buffer)
+    {
+        glGenBuffers(1, &m_buffer);
+        glGenTextures(1, &m_texture);
+    }
+
+    if (m_dirty)
+    {
+        // The table only grows when new animations are seen, so it's uploaded whole
+        glBindBuffer(GL_TEXTURE_BUFFER, m_buffer);
+        glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(m_texels.size() * sizeof(glm::vec4)), m_texels.data(),
+                     GL_STATIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        glBindTexture(GL_TEXTURE_BUFFER, m_texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_buffer);
+        m_dirty = false;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_BUFFER, m_texture);
+}
+
+void SpriteAnimationTable::destroy()
+{
+    if (m_buffer)
+    {
+        glDeleteTextures(1, &m_texture);
+        glDeleteBuffers(1, &m_buffer);
+    }
+    m_buffer = 0;
+    m_texture = 0;
+
+    // The IDs stay valid, the table is uploaded again if it's used after this
+    m_dirty = true;
+}
@@ -0,0 +1,76 @@
+#ifndef RPG_SPRITEANIMATIONTABLE_H
+#define RPG_SPRITEANIMATIONTABLE_H
+
+#include <unordered_map>
+#include <vector>
+#include <glm/vec4.hpp>
+
+#include "../animation/SpriteAnimation.h"
+#include "../../utils/Types.h"
+
+// A sprite which isn't animated on the GPU has this animation ID
+#define NO_GPU_ANIMATION (-1)
+
+/**
+ * The frame tables of the animations which are played by the vertex shader.
+ *
+ * The tables are uploaded once into a buffer texture. An animated sprite only has the ID of its animation
+ * and the time the animation started, the shader picks the frame and its texture rect by itself.
+ * So the CPU does nothing for such a sprite until the animation is changed.
+ *
+ * Layout of an animation in the buffer (RGBA32F texels):
+ * the header (frame count, total duration), then every frame as two texels: the rect and (end time).
+ *
+ * The table also has the animation clock, the start times are measured by it.
+ */
+class SpriteAnimationTable
+{
+    std::vector<glm::vec4> m_texels;
+
+    // The animations are found by their first frame, the frames of an animator never move
+    std::unordered_map<const SpriteAnimationFrame *, i32> m_animations;
+
+    bool m_dirty{false};
+    unsigned int m_buffer{};
+    unsigned int m_texture{};
+
+    double m_time{0.0};
+
+public:
+    SpriteAnimationTable() = default;
+
+    SpriteAnimationTable(const SpriteAnimationTable &) = delete;
+    SpriteAnimationTable &operator=(const SpriteAnimationTable &) = delete;
+
+    /**
+     * Get the ID of an animation, it's added to the table the first time.
+     *
+     * @param frames the first frame, it must stay at the same address while the table is used
+     * @param frameCount the number of frames
+     * @return the animation ID
+     */
+    i32 getAnimation(const SpriteAnimationFrame *frames, u16 frameCount);
+
+    /**
+     * Advance the animation clock.
+     *
+     * @param deltaTime the elapsed time in seconds
+     */
+    void advance(float deltaTime);
+
+    /**
+     * @return the animation clock in seconds
+     */
+    float getTime() const;
+
+    /**
+     * Upload the new animations if there are any and bind the buffer texture.
+     *
+     * @param unit the texture unit
+     */
+    void bind(int unit);
+
+    void destroy();
+};
+
+#endif // RPG_SPRITEANIMATIONTABLE_H
@@ -2,16 +2,22 @@
 #include "SpriteBatch.h"
 
 #include "Graphics.h"
+#include "SpriteAnimationTable.h"
+#include <algorithm>
 #include <numeric>
 
-SpriteBatch::SpriteBatch(Shader shader, int maxSprites)
+SpriteBatch::SpriteBatch(Shader shader, int maxSprites, int maxStaticSprites)
     : m_shader(shader),
       m_maxSprites(maxSprites),
       m_vbo(GL_ARRAY_BUFFER),
-      m_ibo(GL_ELEMENT_ARRAY_BUFFER)
+      m_ibo(GL_ELEMENT_ARRAY_BUFFER),
+      m_maxStaticSprites(maxStaticSprites),
+      m_staticVbo(GL_ARRAY_BUFFER)
 {
     const int vertexCount = maxSprites * 4;
-    const int indexCount = maxSprites * 6;
+
+    // Both buffers are drawn with the same indices
+    const int indexCount = std::max(maxSprites, maxStaticSprites) * 6;
 
     m_vao.bind();
     m_vbo.bind();
@@ -19,22 +25,7 @@ SpriteBatch::SpriteBatch(Shader shader, int maxSprites)
     // This is a little trick.
     // Instead of putting the data into vbo, we just allocate memory for later use
     m_vbo.setData(nullptr, sizeof(Vertex) * vertexCount, GL_DYNAMIC_DRAW);
-
-    // Coords
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
-    glEnableVertexAttribArray(0);
-
-    // Color
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)(2 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    // Texture coords
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    // Texture index
-    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)(8 * sizeof(float)));
-    glEnableVertexAttribArray(3);
+    setVertexAttributes();
 
     // Pattern:
     // 0, 1, 2, 2, 3, 0
@@ -60,6 +51,43 @@ SpriteBatch::SpriteBatch(Shader shader, int maxSprites)
     m_vbo.unbind();
     m_vao.unbind();
     delete[] indices;
+
+    // The static sprites are rarely written, so the buffer is filled slot by slot
+    m_staticVao.bind();
+    m_staticVbo.bind();
+    m_staticVbo.setData(nullptr, sizeof(Vertex) * maxStaticSprites * 4, GL_STATIC_DRAW);
+    setVertexAttributes();
+    m_ibo.bind();
+
+    m_staticVbo.unbind();
+    m_staticVao.unbind();
+}
+
+void SpriteBatch::setVertexAttributes()
+{
+    // Coords
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
+    glEnableVertexAttribArray(0);
+
+    // Color
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    // Texture coords
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)(7 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    // Texture index
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)(9 * sizeof(float)));
+    glEnableVertexAttribArray(3);
+
+    // GPU animation
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)(10 * sizeof(float)));
+    glEnableVertexAttribArray(4);
+
+    // Texture coords transform
+    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)(14 * sizeof(float)));
+    glEnableVertexAttribArray(5);
 }
 
 void SpriteBatch::begin()
@@ -70,9 +98,10 @@ void SpriteBatch::begin()
     }
     m_spritesSize = 0;
     m_texturesSize = 0;
+    m_arrayTexture = 0;
 }
 
-void SpriteBatch::end()
+void SpriteBatch::end(bool drawStatic)
 {
     // In this method we draw all vertices at once with a single draw call
     m_vbo.bind();
@@ -81,29 +110,11 @@ void SpriteBatch::end()
     auto *vertices = new Vertex[m_spritesSize * 4];
     int currentVertex = 0;
 
-    for (const auto &layer : m_layers)
+    for (int layer = 0; layer < MaxLayers; layer++)
     {
-        for (const auto &quad : layer)
+        for (const auto &quad : m_layers[layer])
         {
-            vertices[currentVertex].position = quad.vertices[0].position;
-            vertices[currentVertex].texCoord = quad.vertices[0].texCoords;
-            vertices[currentVertex].color = quad.color;
-            vertices[currentVertex].texId = quad.texId;
-
-            vertices[currentVertex + 1].position = quad.vertices[1].position;
-            vertices[currentVertex + 1].texCoord = quad.vertices[1].texCoords;
-            vertices[currentVertex + 1].color = quad.color;
-            vertices[currentVertex + 1].texId = quad.texId;
-
-            vertices[currentVertex + 2].position = quad.vertices[2].position;
-            vertices[currentVertex + 2].texCoord = quad.vertices[2].texCoords;
-            vertices[currentVertex + 2].color = quad.color;
-            vertices[currentVertex + 2].texId = quad.texId;
-
-            vertices[currentVertex + 3].position = quad.vertices[3].position;
-            vertices[currentVertex + 3].texCoord = quad.vertices[3].texCoords;
-            vertices[currentVertex + 3].color = quad.color;
-            vertices[currentVertex + 3].texId = quad.texId;
+            writeVertices(quad, getDepth(layer, quad.order), &vertices[currentVertex]);
             currentVertex += 4;
         }
     }
@@ -124,9 +135,39 @@ void SpriteBatch::end()
         m_textures[i].bind(i);
     }
 
+    drawStatic = drawStatic && m_staticSlotCount > 0;
+
+    // Set even without an array, samplers of different types must never point to the same unit
+    m_shader.setUniform("textureArray", static_cast<int>(ArrayTextureUnit));
+
+    if (m_animationTable)
+    {
+        m_animationTable->bind(AnimationTableUnit);
+        m_shader.setUniform("animationFrames", static_cast<int>(AnimationTableUnit));
+        m_shader.setUniform("animationTime", m_animationTable->getTime());
+    }
+
+    if (m_arrayTexture)
+    {
+        glActiveTexture(GL_TEXTURE0 + ArrayTextureUnit);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_arrayTexture);
+    }
+
     m_vao.bind();
     glDrawElements(GL_TRIANGLES, m_spritesSize * 6, GL_UNSIGNED_INT, nullptr);
 
+    // The static sprites go last: the depth test hides them behind the nearer sprites,
+    // and with GL_LEQUAL they win over the dynamic sprites of the same layer and order
+    if (drawStatic)
+    {
+        // The dynamic sprites can come from another array, so each draw binds its own
+        glActiveTexture(GL_TEXTURE0 + ArrayTextureUnit);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_staticArrayTexture);
+
+        m_staticVao.bind();
+        glDrawElements(GL_TRIANGLES, m_staticSlotCount * 6, GL_UNSIGNED_INT, nullptr);
+    }
+
     delete[] vertices;
     delete[] ids;
 }
@@ -153,7 +194,9 @@ static FloatRect prepareRect(IntRect rect)
 
 static glm::vec2 toTexCoords(Texture &texture, float x, float y)
 {
-    return {(float)x / texture.getWidth(), (float)y / texture.getHeight()};
+    // Textures from an array occupy only a part of the layer
+    glm::vec4 uvRect = texture.getUvRect();
+    return glm::vec2(uvRect.x, uvRect.y) + glm::vec2(x / texture.getWidth(), y / texture.getHeight()) * glm::vec2(uvRect.z, uvRect.w);
 }
 
 void SpriteBatch::draw(const Sprite &sprite, int layer, int order)
@@ -170,55 +213,174 @@ void SpriteBatch::draw(const Sprite &sprite, int layer, int order)
         std::cerr << "Cannot draw a sprite! Maximum number of sprites reached!" << std::endl;
         return;
     }
-    m_spritesSize++;
-
-    glm::vec2 quadPos = sprite.getPosition() - sprite.getOrigin() * sprite.getScale();
-    IntRect rect = sprite.getTextureRect();
 
     Texture texture = sprite.getTexture();
 
-    int i;
-    for (i = 0; i < m_texturesSize; i++)
+    float texId;
+    if (texture.getLayer() >= 0)
+    {
+        if (m_arrayTexture && m_arrayTexture != texture.getId())
+        {
+            std::cerr << "Cannot draw a sprite with texture " << texture.getPath() << "! Only one texture array per batch is allowed!"
+                      << std::endl;
+            return;
+        }
+        m_arrayTexture = texture.getId();
+        texId = static_cast<float>(MaxTextures + texture.getLayer());
+    }
+    else
     {
-        if (m_textures[i].getId() == texture.getId())
+        int i;
+        for (i = 0; i < m_texturesSize; i++)
+        {
+            if (m_textures[i].getId() == texture.getId())
+            {
+                break;
+            }
+        }
+
+        if (i >= MaxBoundTextures)
+        {
+            std::cerr << "Cannot draw a sprite with texture " << texture.getPath() << "! Maximum number of m_texturesSize reached!"
+                      << std::endl;
+            return;
+        }
+
+        // If we get to the end, add a new texture
+        if (i == m_texturesSize)
         {
-            break;
+            m_textures[i] = texture;
+            m_texturesSize++;
         }
+
+        texId = static_cast<float>(i);
     }
+    m_spritesSize++;
+
+    // Create a layer if absent
+    auto &set = m_layers[layer];
 
-    if (i >= MaxTextures)
+    set.insert(createQuad(sprite, texId, order));
+}
+
+int SpriteBatch::addStatic(const Sprite &sprite, int layer, int order)
+{
+    if (layer >= MaxLayers)
     {
-        std::cerr << "Cannot draw a sprite with texture " << texture.getPath() << "! Maximum number of m_texturesSize reached!"
-                  << std::endl;
-        return;
+        std::cerr << "Cannot add a static sprite! The maximum number of layers is " << MaxLayers << std::endl;
+        return -1;
+    }
+
+    // The slots of the usual textures change every frame, only the array layers stay the same
+    Texture texture = sprite.getTexture();
+    if (texture.getLayer() < 0 || (m_staticArrayTexture && m_staticArrayTexture != texture.getId()))
+    {
+        return -1;
     }
 
-    // If we get to the end, add a new texture
-    if (i == m_texturesSize)
+    int slot;
+    if (!m_freeStaticSlots.empty())
+    {
+        slot = m_freeStaticSlots.back();
+        m_freeStaticSlots.pop_back();
+    }
+    else if (m_staticSlotCount < m_maxStaticSprites)
     {
-        m_textures[i] = texture;
-        m_texturesSize++;
+        slot = m_staticSlotCount++;
     }
+    else
+    {
+        std::cerr << "Cannot add a static sprite! Maximum number of static sprites reached!" << std::endl;
+        return -1;
+    }
+
+    m_staticArrayTexture = texture.getId();
+    updateStatic(slot, sprite, layer, order);
+
+    return slot;
+}
+
+void SpriteBatch::updateStatic(int slot, const Sprite &sprite, int layer, int order)
+{
+    Texture texture = sprite.getTexture();
+    float texId = static_cast<float>(MaxTextures + texture.getLayer());
+
+    QuadWrapper quad = createQuad(sprite, texId, order);
+
+    Vertex vertices[4];
+    writeVertices(quad, getDepth(layer, order), vertices);
 
-    auto texId = static_cast<float>(i);
+    m_staticVbo.bind();
+    m_staticVbo.setSubData(vertices, (GLintptr) (slot * sizeof(vertices)), sizeof(vertices));
+    m_staticVbo.unbind();
+}
+
+void SpriteBatch::removeStatic(int slot)
+{
+    // An empty quad covers no pixels, so the slot can stay in the draw call until it's used again
+    Vertex vertices[4]{};
+
+    m_staticVbo.bind();
+    m_staticVbo.setSubData(vertices, (GLintptr) (slot * sizeof(vertices)), sizeof(vertices));
+    m_staticVbo.unbind();
+
+    m_freeStaticSlots.push_back(slot);
+}
+
+float SpriteBatch::getDepth(int layer, int order)
+{
+    // The layers are the integer part of the key, the orders are the fractional part
+    float orderKey = ((float) std::clamp(order, -OrderDepthRange / 2, OrderDepthRange / 2 - 1) + OrderDepthRange / 2) /
+                     (float) OrderDepthRange;
+    float key = ((float) layer + orderKey) / (float) MaxLayers;
+
+    // The camera sees from z = 0 to z = -100, the closest quads are at z = 0
+    return (key - 1.f) * 99.f;
+}
+
+QuadWrapper SpriteBatch::createQuad(const Sprite &sprite, float texId, int order)
+{
+    glm::vec2 quadPos = sprite.getPosition() - sprite.getOrigin() * sprite.getScale();
+    IntRect rect = sprite.getTextureRect();
+
+    Texture texture = sprite.getTexture();
 
     float w = (float)std::abs(rect.getWidth()) * sprite.getScale().x;
     float h = (float)std::abs(rect.getHeight()) * sprite.getScale().y;
 
-    // Create a layer if absent
-    auto &set = m_layers[layer];
-
     FloatRect r = prepareRect(rect);
 
-    set.insert({{{quadPos, // bottom left
-                     toTexCoords(texture, r.getLeft(), r.getBottom())},
-                    {quadPos + glm::vec2(w, 0.f), // bottom right
-                        toTexCoords(texture, r.getLeft() + r.getWidth(), r.getBottom())},
-                    {quadPos + glm::vec2(w, h), // top right
-                        toTexCoords(texture, r.getLeft() + r.getWidth(), r.getBottom() + r.getHeight())},
-                    {quadPos + glm::vec2(0.f, h), // top left
-                        toTexCoords(texture, r.getLeft(), r.getBottom() + r.getHeight())}},
-        sprite.getColor(), texId, order});
+    // The shader needs to map the frame rects by itself, it's the same as toTexCoords
+    glm::vec4 uvRect = texture.getUvRect();
+    glm::vec4 uvTransform(uvRect.x, uvRect.y, uvRect.z / (float) texture.getWidth(), uvRect.w / (float) texture.getHeight());
+
+    return {{{quadPos, // bottom left
+                 toTexCoords(texture, r.getLeft(), r.getBottom())},
+                {quadPos + glm::vec2(w, 0.f), // bottom right
+                    toTexCoords(texture, r.getLeft() + r.getWidth(), r.getBottom())},
+                {quadPos + glm::vec2(w, h), // top right
+                    toTexCoords(texture, r.getLeft() + r.getWidth(), r.getBottom() + r.getHeight())},
+                {quadPos + glm::vec2(0.f, h), // top left
+                    toTexCoords(texture, r.getLeft(), r.getBottom() + r.getHeight())}},
+        sprite.getColor(), texId, order, static_cast<float>(sprite.getAnimation()), sprite.getAnimationStart(),
+        uvTransform};
+}
+
+void SpriteBatch::writeVertices(const QuadWrapper &quad, float depth, Vertex *vertices)
+{
+    // The corners go counterclockwise from the bottom left one
+    static const glm::vec2 corners[4] = {{0.f, 0.f}, {1.f, 0.f}, {1.f, 1.f}, {0.f, 1.f}};
+
+    for (int i = 0; i < 4; i++)
+    {
+        auto &vertex = vertices[i];
+        vertex.position = glm::vec3(quad.vertices[i].position.x, quad.vertices[i].position.y, depth);
+        vertex.texCoord = quad.vertices[i].texCoords;
+        vertex.color = quad.color;
+        vertex.texId = quad.texId;
+        vertex.animation = glm::vec4(quad.animation, quad.animationStart, corners[i].x, corners[i].y);
+        vertex.uvTransform = quad.uvTransform;
+    }
 }
 
 void SpriteBatch::setShader(Shader shader)
@@ -226,6 +388,11 @@ void SpriteBatch::setShader(Shader shader)
     m_shader = shader;
 }
 
+void SpriteBatch::setAnimationTable(SpriteAnimationTable *table)
+{
+    m_animationTable = table;
+}
+
 glm::mat4 SpriteBatch::getProjectionMatrix()
 {
     return m_projMat;
@@ -254,4 +421,9 @@ void SpriteBatch::destroy()
     m_vao.destroy();
     m_vbo.destroy();
     m_ibo.destroy();
+    m_staticVao.destroy();
+    m_staticVbo.destroy();
+    m_staticSlotCount = 0;
+    m_freeStaticSlots.clear();
+    m_staticArrayTexture = 0;
 }
@@ -13,10 +13,16 @@
 
 struct Vertex
 {
-    glm::vec2 position;
+    glm::vec3 position; // z is the depth of the quad
     glm::vec4 color;
     glm::vec2 texCoord;
     float texId;
+
+    // Only for the sprites animated on the GPU: (animation ID or -1, start time, corner x, corner y)
+    glm::vec4 animation;
+
+    // Maps the pixels of the sprite sheet to the texture coordinates: (offset x, offset y, scale x, scale y)
+    glm::vec4 uvTransform;
 };
 
 struct ShortVertex
@@ -31,11 +37,30 @@ struct QuadWrapper
     glm::vec4 color;
     float texId;
     int order{0};
+    float animation{-1.f};
+    float animationStart{0.f};
+    glm::vec4 uvTransform{};
 };
 
+// Texture slots for usual textures. The layers of an array texture get indices starting from MaxTextures
 static const size_t MaxTextures = 16;
 static const size_t MaxLayers = 16;
 
+// A fragment shader can have only 16 samplers on macOS and the UI shader has the array texture too,
+// so a batch binds one usual texture less than MaxTextures
+static const size_t MaxBoundTextures = MaxTextures - 1;
+
+// The texture unit of the sprite animation table, it comes after the usual textures
+static const size_t AnimationTableUnit = MaxTextures;
+
+// The texture unit of the array texture. The UI shader samples it together with the usual textures, so it needs its own unit
+static const size_t ArrayTextureUnit = MaxTextures + 1;
+
+// The orders which are mapped to different depths, bigger and smaller orders are clamped
+static const int OrderDepthRange = 1 << 18;
+
+class SpriteAnimationTable;
+
 class SpriteBatch
 {
     Shader m_shader;
@@ -46,6 +71,14 @@ class SpriteBatch
 
     Buffer m_ibo;
 
+    // Static sprites stay in their own buffer between frames, every sprite has a slot there
+    int m_maxStaticSprites{0};
+    VertexArray m_staticVao;
+    Buffer m_staticVbo;
+    int m_staticSlotCount{0}; // the slots after it were never used
+    std::vector<int> m_freeStaticSlots;
+    unsigned int m_staticArrayTexture{0};
+
     struct QuadComparator
     {
         bool operator()(const QuadWrapper &a, const QuadWrapper &b) const
@@ -61,6 +94,11 @@ class SpriteBatch
     Texture m_textures[MaxTextures];
     int m_texturesSize{0};
 
+    // Only one array texture per batch, but it can have any number of layers
+    unsigned int m_arrayTexture{0};
+
+    SpriteAnimationTable *m_animationTable{nullptr};
+
     // It's not necessary to have these fields here,
     // but it's quite useful for the rendering system
     glm::mat4 m_projMat{};
@@ -69,16 +107,70 @@ class SpriteBatch
 public:
     SpriteBatch() = default;
 
-    SpriteBatch(Shader shader, int spriteCount = 2000);
+    SpriteBatch(Shader shader, int spriteCount = 2000, int staticSpriteCount = 0);
 
     void begin();
 
-    void end();
+    /**
+     * Draw the collected sprites.
+     *
+     * @param drawStatic true to draw the static sprites as well
+     */
+    void end(bool drawStatic = false);
 
     void draw(const Sprite &sprite, int layer = 0, int order = 0);
 
+    /**
+     * Add a static sprite. It's written into the GPU buffer once and drawn every frame until it's removed.
+     * Only the sprites from a texture array can be static.
+     *
+     * The static sprites aren't sorted with the others, they are drawn after them and put in place by the depth test.
+     * A static sprite is drawn over a dynamic one with the same layer and order.
+     * The dynamic sprites should be opaque where they cover a static one, the fully transparent pixels are fine.
+     *
+     * @param sprite the sprite
+     * @param layer the layer
+     * @param order the order in the layer
+     * @return the slot of the sprite or -1 if it can't be static
+     */
+    int addStatic(const Sprite &sprite, int layer = 0, int order = 0);
+
+    /**
+     * Rewrite a static sprite which has changed.
+     *
+     * @param slot the slot of the sprite
+     * @param sprite the sprite
+     * @param layer the layer
+     * @param order the order in the layer
+     */
+    void updateStatic(int slot, const Sprite &sprite, int layer = 0, int order = 0);
+
+    /**
+     * Remove a static sprite.
+     *
+     * @param slot the slot of the sprite
+     */
+    void removeStatic(int slot);
+
+    /**
+     * Get the depth which keeps the quads in the same order as the batch draws them.
+     * The quads with bigger layers and orders are closer.
+     *
+     * @param layer the layer
+     * @param order the order in the layer
+     * @return the z coordinate of the quad
+     */
+    static float getDepth(int layer, int order);
+
     void setShader(Shader shader);
 
+    /**
+     * Set the table of the animations played by the vertex shader, it's bound when the batch is drawn.
+     *
+     * @param table the table or nullptr
+     */
+    void setAnimationTable(SpriteAnimationTable *table);
+
     glm::mat4 getProjectionMatrix();
 
     void setProjectionMatrix(glm::mat4 projMat);
@@ -89,6 +181,12 @@ public:
 
     void destroy();
 
+private:
+    void setVertexAttributes();
+
+    static QuadWrapper createQuad(const Sprite &sprite, float texId, int order);
+
+    static void writeVertices(const QuadWrapper &quad, float depth, Vertex *vertices);
 };
 
 #endif //RPG_SPRITEBATCH_H
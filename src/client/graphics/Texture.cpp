@@ -6,6 +6,30 @@
 #include <stb_image.h>
 
 #include "Bitmap.h"
+#include "TextureContainer.h"
+#include "../../utils/MappedFile.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// S3TC is an extension, so we have to ask the driver if it's there
+static bool isS3tcSupported()
+{
+    static int supported = -1;
+    if (supported == -1)
+    {
+        int count = 0;
+        glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+        std::vector<int> formats(count);
+        glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+        supported = std::find(formats.begin(), formats.end(), GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) != formats.end();
+    }
+    return supported;
+}
 
 Texture::Texture() : m_id(0), m_path(""), m_width(0), m_height(0) { }
 
@@ -15,15 +39,23 @@ Texture::Texture(unsigned int id, const std::string& path, int width, int height
         m_width(width), 
         m_height(height) { }
 
+Texture::Texture(unsigned int id, const std::string& path, int width, int height, int layer, glm::vec4 uvRect)
+        : m_id(id),
+        m_path(path),
+        m_width(width),
+        m_height(height),
+        m_layer(layer),
+        m_uvRect(uvRect) { }
+
 void Texture::bind(unsigned int slot) const
 {
     glActiveTexture(GL_TEXTURE0 + slot);
-    glBindTexture(GL_TEXTURE_2D, m_id);
+    glBindTexture(m_layer >= 0 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, m_id);
 }
 
 void Texture::unbind() const
 {
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindTexture(m_layer >= 0 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, 0);
 }
 
 unsigned int Texture::getId() const noexcept
@@ -52,9 +84,59 @@ int Texture::getHeight() const
     return m_height;
 }
 
+int Texture::getLayer() const
+{
+    return m_layer;
+}
+
+glm::vec4 Texture::getUvRect() const
+{
+    return m_uvRect;
+}
+
+std::size_t Texture::getGpuMemorySize() const
+{
+    // Layers are owned by the texture array
+    if (!m_id || m_layer >= 0) return 0;
+
+    // Walk through the allocated mip levels, uncompressed textures are always RGBA8
+    std::size_t size = 0;
+    glBindTexture(GL_TEXTURE_2D, m_id);
+    for (int level = 0;; level++)
+    {
+        int width = 0;
+        int height = 0;
+        int compressed = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+        if (width == 0 || height == 0) break;
+
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED, &compressed);
+        if (compressed)
+        {
+            int imageSize = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &imageSize);
+            size += (std::size_t) imageSize;
+        }
+        else
+        {
+            size += (std::size_t) width * height * 4;
+        }
+    }
+    return size;
+}
+
 // GL_TEXTURE_RECTANGLE and GL_TEXTURE_2D might be useful for us
 Texture Texture::create(const std::string& path, unsigned int type)
 {
+    // Prefer the cooked version of the texture, it doesn't need any decoding
+    std::string cookedPath = std::filesystem::path(path).replace_extension(".rtex").string();
+    Texture cooked = createCooked(cookedPath, path, type);
+    if (cooked.getId())
+    {
+        return cooked;
+    }
+
     unsigned int texture;
     int channels;
     int width;
@@ -80,9 +162,9 @@ Texture Texture::create(const std::string& path, unsigned int type)
          return Texture(0, "", 0, 0);
     }
 
+    // We use GL_NEAREST filtering, so mipmaps would never be sampled
     glTexImage2D(type, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(type);
-    
+
     stbi_image_free(data);
 
     return Texture(texture, path, width, height);
@@ -106,7 +188,6 @@ Texture Texture::createEmpty()
 
         unsigned char pixel[]{255, 255, 255, 255};
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
-        glGenerateMipmap(GL_TEXTURE_2D);
     }
     return Texture(texture, "no_path", 1, 1);
 }
@@ -126,7 +207,81 @@ Texture Texture::create(const Bitmap &bitmap, unsigned int type)
     glTexParameteri(type, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
     glTexImage2D(type, 0, GL_RGBA8, bitmap.getWidth(), bitmap.getHeight(), 0, GL_RGBA, GL_UNSIGNED_BYTE, bitmap.getRawPixels().data());
-    glGenerateMipmap(type);
 
     return Texture(texture, "no_path", bitmap.getWidth(), bitmap.getHeight());
 }
+
+Texture Texture::createCooked(const std::string &cookedPath, const std::string &path, unsigned int type)
+{
+    MappedFile file(cookedPath);
+    if (!file.isOpen())
+    {
+        return Texture(0, "", 0, 0);
+    }
+
+    auto header = (const RtexHeader *) file.getData();
+    if (file.getSize() < sizeof(RtexHeader) || header->magic != RTEX_MAGIC || header->version != RTEX_VERSION ||
+        header->mipCount == 0 || file.getSize() < sizeof(RtexHeader) + header->mipCount * sizeof(RtexMip))
+    {
+        std::cout << "Broken cooked texture " << cookedPath << std::endl;
+        return Texture(0, "", 0, 0);
+    }
+
+    // Without the source image the cooked texture is all there is
+    MappedFile source(path);
+    if (source.isOpen() && !isRtexSource(*header, source.getData(), source.getSize()))
+    {
+        std::cout << "Cooked texture " << cookedPath << " is older than " << path << ", cook it again" << std::endl;
+        return Texture(0, "", 0, 0);
+    }
+
+    bool compressed = header->format == RtexFormat::BC3;
+    if (compressed && !isS3tcSupported())
+    {
+        // Fall back to the source image
+        return Texture(0, "", 0, 0);
+    }
+
+    // The driver reads as much as the mip size says, so the data must be exactly that long
+    auto mips = (const RtexMip *) (file.getData() + sizeof(RtexHeader));
+    for (u32 level = 0; level < header->mipCount; level++)
+    {
+        const RtexMip &mip = mips[level];
+        if ((std::size_t) mip.offset + mip.size > file.getSize() || mip.width == 0 || mip.height == 0 ||
+            mip.size != getRtexMipSize(header->format, mip.width, mip.height))
+        {
+            std::cout << "Broken cooked texture " << cookedPath << std::endl;
+            return Texture(0, "", 0, 0);
+        }
+    }
+
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(type, texture);
+
+    glTexParameteri(type, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(type, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    // Use the cooked mip chain if there is one, but keep the pixel look
+    glTexParameteri(type, GL_TEXTURE_MIN_FILTER, header->mipCount > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+    glTexParameteri(type, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(type, GL_TEXTURE_MAX_LEVEL, (int) header->mipCount - 1);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (u32 level = 0; level < header->mipCount; level++)
+    {
+        const RtexMip &mip = mips[level];
+        const u8 *data = file.getData() + mip.offset;
+        if (compressed)
+        {
+            glCompressedTexImage2D(type, (int) level, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, (int) mip.width, (int) mip.height, 0,
+                                   (int) mip.size, data);
+        }
+        else
+        {
+            glTexImage2D(type, (int) level, GL_RGBA8, (int) mip.width, (int) mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        }
+    }
+
+    return Texture(texture, path, (int) header->width, (int) header->height);
+}
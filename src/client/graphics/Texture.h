@@ -2,6 +2,7 @@
 #define RPG_TEXTURE_H
 
 #include <string>
+#include <glm/glm.hpp>
 #include "Graphics.h"
 
 class Bitmap;
@@ -13,10 +14,13 @@ private:
     std::string m_path; // The file path
     int m_width{}; // The width of the texture
     int m_height{}; // The height of the texture
+    int m_layer{-1}; // The layer of the array texture, -1 for usual textures
+    glm::vec4 m_uvRect{0.f, 0.f, 1.f, 1.f}; // The place of the texture inside the array layer (offset, size)
 
 public:
     Texture();
     explicit Texture(unsigned int id, const std::string& path, int width, int height);
+    explicit Texture(unsigned int id, const std::string& path, int width, int height, int layer, glm::vec4 uvRect);
 
     void bind(unsigned int slot = 0) const;
 
@@ -32,11 +36,36 @@ public:
 
     int getHeight() const;
 
+    /**
+     * Get the layer of the array texture this texture is stored in.
+     *
+     * @return the layer or -1 if it's a usual texture
+     */
+    int getLayer() const;
+
+    /**
+     * Get the rectangle of the texture inside its array layer in normalized coordinates.
+     *
+     * @return the offset (x, y) and the size (z, w)
+     */
+    glm::vec4 getUvRect() const;
+
+    /**
+     * Estimate the video memory used by the texture, including all mip levels.
+     *
+     * @return the size in bytes
+     */
+    std::size_t getGpuMemorySize() const;
+
     static Texture create(const std::string &path, unsigned int type = GL_TEXTURE_2D);
 
     static Texture createEmpty();
 
     static Texture create(const Bitmap &bitmap, unsigned int type = GL_TEXTURE_2D);
+
+private:
+    // Load a texture cooked by the texture cooker, returns an empty texture if there is no usable file
+    static Texture createCooked(const std::string &cookedPath, const std::string &path, unsigned int type);
 };
 
 
@@ -0,0 +1,229 @@
+#include "../../pch.h"
+#include "TextureArray.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <stb_image.h>
+
+#include "TextureContainer.h"
+#include "../../utils/MappedFile.h"
+
+// The gap between the sheets, so the neighbours never bleed into each other
+#define SHEET_PADDING 2
+
+struct Sheet
+{
+    std::string path;
+    int width{};
+    int height{};
+    const unsigned char *pixels{};
+
+    // The pixels come either from the cooked file or from the decoder
+    MappedFile cooked;
+    unsigned char *decoded{};
+
+    int page{};
+    int x{};
+    int y{};
+};
+
+// Take the first mip of a cooked texture. The pages are RGBA8, so BC3 files can't be copied into them
+static bool loadCookedSheet(const std::string &path, Sheet &sheet)
+{
+    std::string cookedPath = std::filesystem::path(path).replace_extension(".rtex").string();
+    MappedFile file(cookedPath);
+    if (!file.isOpen())
+    {
+        return false;
+    }
+
+    auto header = (const RtexHeader *) file.getData();
+    if (file.getSize() < sizeof(RtexHeader) + sizeof(RtexMip) || header->magic != RTEX_MAGIC ||
+        header->version != RTEX_VERSION || header->mipCount == 0)
+    {
+        std::cout << "Broken cooked texture " << cookedPath << std::endl;
+        return false;
+    }
+    if (header->format != RtexFormat::RGBA8)
+    {
+        return false;
+    }
+
+    MappedFile source(path);
+    if (source.isOpen() && !isRtexSource(*header, source.getData(), source.getSize()))
+    {
+        std::cout << "Cooked texture " << cookedPath << " is older than " << path << ", cook it again" << std::endl;
+        return false;
+    }
+
+    auto mip = (const RtexMip *) (file.getData() + sizeof(RtexHeader));
+    if ((std::size_t) mip->offset + mip->size > file.getSize() ||
+        mip->size != getRtexMipSize(RtexFormat::RGBA8, mip->width, mip->height))
+    {
+        std::cout << "Broken cooked texture " << cookedPath << std::endl;
+        return false;
+    }
+
+    sheet.width = (int) mip->width;
+    sheet.height = (int) mip->height;
+    sheet.pixels = file.getData() + mip->offset;
+    sheet.cooked = std::move(file);
+    return true;
+}
+
+static bool loadSheet(const std::string &path, Sheet &sheet)
+{
+    sheet.path = path;
+
+    // The cooked rows are already flipped, so both ways give the same layout
+    if (loadCookedSheet(path, sheet))
+    {
+        return true;
+    }
+
+    int channels;
+    stbi_set_flip_vertically_on_load(1);
+    sheet.decoded = stbi_load(path.c_str(), &sheet.width, &sheet.height, &channels, 4);
+    sheet.pixels = sheet.decoded;
+    return sheet.decoded != nullptr;
+}
+
+Texture TextureArray::getTexture(const std::string &path) const
+{
+    auto it = m_textures.find(path);
+    if (it == m_textures.end())
+    {
+        std::cout << "Texture " << path << " isn't in the texture array" << std::endl;
+        return Texture(0, "", 0, 0);
+    }
+    return it->second;
+}
+
+unsigned int TextureArray::getId() const noexcept
+{
+    return m_id;
+}
+
+int TextureArray::getPageCount() const
+{
+    return m_pageCount;
+}
+
+std::size_t TextureArray::getGpuMemorySize() const
+{
+    return (std::size_t) m_pageWidth * m_pageHeight * m_pageCount * 4;
+}
+
+void TextureArray::destroy()
+{
+    glDeleteTextures(1, &m_id);
+    m_id = 0;
+    m_textures.clear();
+}
+
+TextureArray TextureArray::create(const std::vector<std::string> &paths, int minPageSize)
+{
+    TextureArray array;
+
+    std::vector<Sheet> sheets;
+    sheets.reserve(paths.size());
+    for (const auto &path : paths)
+    {
+        if (!loadSheet(path, sheets.emplace_back()))
+        {
+            std::cout << "Failed to load texture " << path << std::endl;
+            sheets.pop_back();
+        }
+    }
+
+    if (sheets.empty())
+    {
+        return array;
+    }
+
+    array.m_pageWidth = minPageSize;
+    array.m_pageHeight = minPageSize;
+    for (const auto &sheet : sheets)
+    {
+        array.m_pageWidth = std::max(array.m_pageWidth, sheet.width);
+        array.m_pageHeight = std::max(array.m_pageHeight, sheet.height);
+    }
+
+    // Shelf packing: the tallest sheets go first, every shelf is as tall as its first sheet
+    std::vector<Sheet *> order;
+    for (auto &sheet : sheets)
+    {
+        order.push_back(&sheet);
+    }
+    std::sort(order.begin(), order.end(), [](const Sheet *a, const Sheet *b) { return a->height > b->height; });
+
+    int page = 0;
+    int shelfX = 0;
+    int shelfY = 0;
+    int shelfHeight = 0;
+    for (Sheet *sheet : order)
+    {
+        if (shelfX + sheet->width > array.m_pageWidth)
+        {
+            // Start a new shelf
+            shelfY += shelfHeight + SHEET_PADDING;
+            shelfX = 0;
+            shelfHeight = 0;
+        }
+        if (shelfY + sheet->height > array.m_pageHeight)
+        {
+            // Start a new page
+            page++;
+            shelfX = 0;
+            shelfY = 0;
+            shelfHeight = 0;
+        }
+
+        sheet->page = page;
+        sheet->x = shelfX;
+        sheet->y = shelfY;
+
+        shelfX += sheet->width + SHEET_PADDING;
+        shelfHeight = std::max(shelfHeight, sheet->height);
+    }
+    array.m_pageCount = page + 1;
+
+    // The pages were as big as the packer allowed, but all of them can be cut down to the used area
+    array.m_pageWidth = 0;
+    array.m_pageHeight = 0;
+    for (const auto &sheet : sheets)
+    {
+        array.m_pageWidth = std::max(array.m_pageWidth, sheet.x + sheet.width);
+        array.m_pageHeight = std::max(array.m_pageHeight, sheet.y + sheet.height);
+    }
+
+    glGenTextures(1, &array.m_id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, array.m_id);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, array.m_pageWidth, array.m_pageHeight, array.m_pageCount, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, nullptr);
+
+    for (auto &sheet : sheets)
+    {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, sheet.x, sheet.y, sheet.page, sheet.width, sheet.height, 1, GL_RGBA,
+                        GL_UNSIGNED_BYTE, sheet.pixels);
+        if (sheet.decoded)
+        {
+            stbi_image_free(sheet.decoded);
+        }
+        sheet.cooked.close();
+
+        // The texture coordinates of the sheet are mapped into its place on the page
+        glm::vec4 uvRect((float) sheet.x / array.m_pageWidth, (float) sheet.y / array.m_pageHeight,
+                         (float) sheet.width / array.m_pageWidth, (float) sheet.height / array.m_pageHeight);
+        array.m_textures[sheet.path] = Texture(array.m_id, sheet.path, sheet.width, sheet.height, sheet.page, uvRect);
+    }
+
+    return array;
+}
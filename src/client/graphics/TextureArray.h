@@ -0,0 +1,61 @@
+#ifndef RPG_TEXTUREARRAY_H
+#define RPG_TEXTUREARRAY_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Texture.h"
+
+/**
+ * Several sprite sheets packed into the pages (layers) of one GL_TEXTURE_2D_ARRAY.
+ *
+ * The sprite batch samples all of them through a single sampler, so the number of sheets per draw call isn't limited.
+ * The returned textures are views into the array, they must not be destroyed by themselves.
+ */
+class TextureArray
+{
+    unsigned int m_id{};
+    int m_pageWidth{};
+    int m_pageHeight{};
+    int m_pageCount{};
+
+    std::unordered_map<std::string, Texture> m_textures;
+
+public:
+    TextureArray() = default;
+
+    /**
+     * Get a sprite sheet that was packed into the array.
+     *
+     * @param path the path the sheet was loaded from
+     * @return the texture or an empty texture if there is no such sheet
+     */
+    Texture getTexture(const std::string &path) const;
+
+    unsigned int getId() const noexcept;
+
+    int getPageCount() const;
+
+    /**
+     * Estimate the video memory used by all pages.
+     *
+     * @return the size in bytes
+     */
+    std::size_t getGpuMemorySize() const;
+
+    void destroy();
+
+    /**
+     * Load the sprite sheets and pack them into pages.
+     * Cooked RGBA8 sheets (.rtex) are copied without decoding, the others are decoded from the source image.
+     * Smaller sheets share pages, and the pages are cut down to the packed area.
+     * Prefer AssetCache::loadTextureArray, it shares the array and tracks its memory.
+     *
+     * @param paths the image paths
+     * @param minPageSize the width and height the packer fills before it starts a new page
+     * @return the texture array
+     */
+    static TextureArray create(const std::vector<std::string> &paths, int minPageSize = 512);
+};
+
+#endif // RPG_TEXTUREARRAY_H
@@ -0,0 +1,75 @@
+#ifndef RPG_TEXTURECONTAINER_H
+#define RPG_TEXTURECONTAINER_H
+
+#include "../../utils/Hash.h"
+#include "../../utils/Types.h"
+
+// Cooked texture container (.rtex) produced by tools/texture_cooker.
+// The file is mapped into memory and uploaded as is, so the layout is plain and 4-byte aligned:
+// [RtexHeader][RtexMip x mipCount][mip data...]
+// The rows are already flipped for OpenGL, the first row is the bottom one.
+// The header keeps the hash of the source image, so a cooked file which is older than its image isn't used.
+
+#define RTEX_MAGIC 0x58455452 // "RTEX"
+#define RTEX_VERSION 2
+
+enum class RtexFormat : u32
+{
+    RGBA8 = 0,
+    BC3 = 1 // DXT5, 4x4 blocks of 16 bytes
+};
+
+struct RtexHeader
+{
+    u32 magic;
+    u32 version;
+    RtexFormat format;
+    u32 width;
+    u32 height;
+    u32 mipCount;
+
+    // The FNV-1a hash and the size of the source image file
+    u64 sourceHash;
+    u32 sourceSize;
+};
+
+struct RtexMip
+{
+    u32 offset; // from the beginning of the file
+    u32 size;
+    u32 width;
+    u32 height;
+};
+
+/**
+ * Get the size a mip must have.
+ *
+ * @param format the format of the texture
+ * @param width the mip width
+ * @param height the mip height
+ * @return the size of the mip data in bytes
+ */
+inline u64 getRtexMipSize(RtexFormat format, u32 width, u32 height)
+{
+    if (format == RtexFormat::BC3)
+    {
+        return (u64) ((width + 3) / 4) * ((height + 3) / 4) * 16;
+    }
+    return (u64) width * height * 4;
+}
+
+/**
+ * Check whether the cooked texture was made from this source image.
+ * The cooked files are made by hand, so an edited image would keep its old look without the check.
+ *
+ * @param header the header of the cooked texture
+ * @param source the source image file
+ * @param size the size of the source image file
+ * @return true if the cooked texture is up to date
+ */
+inline bool isRtexSource(const RtexHeader &header, const u8 *source, std::size_t size)
+{
+    return header.sourceSize == size && header.sourceHash == Hash::fnv1a(source, size);
+}
+
+#endif // RPG_TEXTURECONTAINER_H
@@ -1,12 +1,6 @@
 #ifndef RPG_SPRITEANIMATIONCOMPONENT_HPP
 #define RPG_SPRITEANIMATIONCOMPONENT_HPP
 
-#include <vector>
-#include <variant>
-#include <unordered_map>
-#include <functional>
-#include <glm/vec3.hpp>
-
 #include "../../client/animation/SpriteAnimator.h"
 
 struct SpriteAnimatorComponent
@@ -14,16 +8,17 @@ struct SpriteAnimatorComponent
     const SpriteAnimator *animator;
     SpriteAnimatorParameterStorage parameterStorage;
 
-    struct
-    {
-        const SpriteAnimatorNode *node;
+    // The state of the instance, the indices point into the animator
+    u16 node;
+    u16 frame; // the index in the animator frames, not in the node
+    float time;
+
+    // The frame has changed since the sprite was updated
+    bool frameChanged;
 
-        struct
-        {
-            std::size_t index;
-            float time;
-        } frame;
-    } activeAnimation;
+    // The frames are picked by the vertex shader, the animator only handles the transitions,
+    // and only when the parameters change
+    bool gpuAnimation;
 };
 
 #endif // RPG_SPRITEANIMATIONCOMPONENT_HPP
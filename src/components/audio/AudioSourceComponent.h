@@ -16,9 +16,13 @@ struct AudioSourceComponent
 
     float volume{1.f};
     float pan{0.f};
+    float pitch{1.f};
     bool loop{false};
     bool global{false};
 
+    // The sounds with higher priority get the real voices first
+    int priority{0};
+
     float maxDistance{2000.f};
 
 public:
@@ -0,0 +1,22 @@
+#ifndef RPG_AUDIOSOURCEINSTANCECOMPONENT_H
+#define RPG_AUDIOSOURCEINSTANCECOMPONENT_H
+
+#include "../../client/audio/AudioSource.h"
+#include "../../utils/DynamicAabbTree.h"
+
+/**
+ * The audio source which plays the audio source component of the same entity.
+ * It's added and removed by the audio system together with the audio source component, don't add it by hand.
+ */
+struct AudioSourceInstanceComponent
+{
+    AudioSource *source{};
+
+    // The number of the last frame when the source was near the listener
+    u32 heardFrame{};
+
+    // The proxy in the audio system tree, only positional sources have it
+    i32 proxy{AABB_TREE_NULL};
+};
+
+#endif //RPG_AUDIOSOURCEINSTANCECOMPONENT_H
@@ -3,6 +3,12 @@
 
 #include "glm/glm.hpp"
 
+/**
+ * The place of the entity relative to its parent.
+ *
+ * The systems which keep the world positions (physics, audio, culling) learn about the moves from the patch signal,
+ * so the entities which are moved after their creation must be moved with registry.patch().
+ */
 struct TransformComponent
 {
     glm::vec2 position{};
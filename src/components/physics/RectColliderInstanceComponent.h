@@ -0,0 +1,18 @@
+#ifndef RPG_RECTCOLLIDERINSTANCECOMPONENT_H
+#define RPG_RECTCOLLIDERINSTANCECOMPONENT_H
+
+#include "../../utils/DynamicAabbTree.h"
+
+/**
+ * The place of the rect collider of the same entity in the physics system tree.
+ * It's added and removed by the physics system together with the rect collider component, don't add it by hand.
+ */
+struct RectColliderInstanceComponent
+{
+    i32 proxy{AABB_TREE_NULL};
+
+    // The collider is in the tree of the static colliders
+    bool isStatic{false};
+};
+
+#endif // RPG_RECTCOLLIDERINSTANCECOMPONENT_H
@@ -3,9 +3,24 @@
 
 #include "glm/glm.hpp"
 
+enum class BodyType
+{
+    Static,    // never moves, the same as a collider without a rigidbody
+    Kinematic, // moves with its velocity through everything, but blocks the dynamic bodies
+    Dynamic    // moves with its velocity and is blocked by the colliders
+};
+
+/**
+ * A body which is moved by the physics system.
+ * The velocity should be set through Physics::setVelocity(), so a sleeping body wakes up.
+ */
 struct RigidbodyComponent
 {
-    glm::vec2 velocity;
+    glm::vec2 velocity{0.f};
+    BodyType type{BodyType::Dynamic};
+
+    // How long the body has been almost still, it falls asleep after a while
+    float stillTime{0.f};
 };
 
 #endif //RPG_RIGIDBODYCOMPONENT_H
@@ -0,0 +1,12 @@
+#ifndef RPG_SLEEPINGCOMPONENT_H
+#define RPG_SLEEPINGCOMPONENT_H
+
+/**
+ * The body hasn't moved for a while, so the physics system skips it until it's woken up.
+ * It's added by the physics system and removed by Physics::wake().
+ */
+struct SleepingComponent
+{
+};
+
+#endif // RPG_SLEEPINGCOMPONENT_H
@@ -2,11 +2,16 @@
 #define RPG_CAMERACOMPONENT_H
 
 #include "glm/glm.hpp"
+#include "../../utils/Types.h"
 
 struct CameraComponent
 {
     float zoom{1.f};
 
+    // The renderables inside and outside the camera in the last frame, filled by the render system
+    u32 visibleCount{0};
+    u32 culledCount{0};
+
     glm::mat4 getProjectionMatrix() const;
 
     float getWidth() const;
@@ -0,0 +1,21 @@
+#ifndef RPG_RENDERBOUNDSCOMPONENT_H
+#define RPG_RENDERBOUNDSCOMPONENT_H
+
+#include <glm/glm.hpp>
+#include "../../utils/DynamicAabbTree.h"
+#include "../../utils/Types.h"
+
+/**
+ * The world rectangle which covers everything the entity renders: its sprite, its text and its light.
+ * It's added, updated and removed by the visibility system, don't add it by hand.
+ */
+struct RenderBoundsComponent
+{
+    glm::vec2 min{};
+    glm::vec2 max{};
+
+    // The proxy in the visibility tree
+    i32 proxy{AABB_TREE_NULL};
+};
+
+#endif // RPG_RENDERBOUNDSCOMPONENT_H
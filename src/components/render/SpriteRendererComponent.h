@@ -4,6 +4,7 @@
 #include "glm/glm.hpp"
 #include "../../client/graphics/Texture.h"
 #include "../../client/graphics/Rect.h"
+#include "../../utils/Types.h"
 
 struct SpriteRendererComponent
 {
@@ -14,6 +15,10 @@ struct SpriteRendererComponent
     int layer{0};
     int order{0};
 
+    // The sprite is animated by the vertex shader, the texture rect gives only its size
+    i32 animation{-1};
+    float animationStart{0.f};
+
     SpriteRendererComponent(Texture texture);
 };
 
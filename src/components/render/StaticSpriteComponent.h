@@ -0,0 +1,12 @@
+#ifndef RPG_STATICSPRITECOMPONENT_H
+#define RPG_STATICSPRITECOMPONENT_H
+
+/**
+ * The sprite of the entity is written into the GPU buffer once and isn't submitted every frame.
+ * If its transform or its renderer is changed, it must be done through registry.patch(), so the change is noticed.
+ */
+struct StaticSpriteComponent
+{
+};
+
+#endif // RPG_STATICSPRITECOMPONENT_H
@@ -0,0 +1,13 @@
+#ifndef RPG_STATICSPRITEINSTANCECOMPONENT_H
+#define RPG_STATICSPRITEINSTANCECOMPONENT_H
+
+/**
+ * The slot of a static sprite in the sprite batch.
+ * It's added and removed by the sprite render system, don't add it by hand.
+ */
+struct StaticSpriteInstanceComponent
+{
+    int slot{-1};
+};
+
+#endif // RPG_STATICSPRITEINSTANCECOMPONENT_H
@@ -0,0 +1,16 @@
+#ifndef RPG_VISIBLECOMPONENT_H
+#define RPG_VISIBLECOMPONENT_H
+
+#include "../../utils/Types.h"
+
+/**
+ * The entity is seen by the camera, so the render systems draw it.
+ * It's added and removed by the visibility system, don't add it by hand.
+ */
+struct VisibleComponent
+{
+    // The number of the last frame when the entity was seen
+    u32 frame{};
+};
+
+#endif // RPG_VISIBLECOMPONENT_H
@@ -21,6 +21,9 @@ struct Object
     glm::vec2 origin{};
 
     int orderPivot{0};
+
+    // The bodies can't walk through the tile with this object
+    bool solid{false};
 };
 
 class IWorldMapGenerator
@@ -31,6 +34,19 @@ public:
     virtual std::vector<Tile> generateTiles(int x, int y) = 0;
 
     virtual std::vector<Object> generateObjects(int x, int y, std::vector<Tile>) = 0;
+
+    /**
+     * Can the bodies walk through the tile? It's called by the physics system for every tile a body touches,
+     * so it must be cheap and must not create the tiles and the objects.
+     *
+     * @param x the tile X
+     * @param y the tile Y
+     * @return true if the tile is blocked
+     */
+    virtual bool isSolid(int x, int y)
+    {
+        return false;
+    }
 };
 
 struct WorldMapComponent
@@ -38,8 +38,22 @@ public:
         m_registry->remove<T>(m_entity);
     }
 
+    /**
+     * Change a component in place and let the observers of the component know about it.
+     *
+     * @param func the functions which change the component
+     * @return the component
+     */
+    template<typename T, typename... Func>
+    decltype(auto) patchComponent(Func &&... func)
+    {
+        return m_registry->patch<T>(m_entity, std::forward<Func>(func)...);
+    }
+
     operator bool() const { return m_entity != entt::null; }
 
+    operator entt::entity() const { return m_entity; }
+
     bool operator==(const Entity &entity)
     {
         return m_entity == entity.m_entity;
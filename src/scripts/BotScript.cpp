@@ -3,21 +3,24 @@
 
 #include "../utils/Hierarchy.h"
 #include "../components/physics/RigidbodyComponent.h"
+#include "../utils/Physics.h"
 #include "../components/animation/SpriteAnimatorComponent.h"
 #include <glm/gtc/random.hpp>
 
 void BotScript::onCreate()
 {
     m_spriteEntity = Hierarchy::find(getEntity(), "sprite");
+
+    auto &animator = m_spriteEntity.getComponent<SpriteAnimatorComponent>();
+    m_velocityParameter = animator.animator->getParameter<glm::vec2>("velocity");
 }
 
 void BotScript::onUpdate(float deltaTime)
 {
-    auto &rigidbody = getComponent<RigidbodyComponent>();
-
     if (m_currentState == IDLE)
     {
-        rigidbody.velocity = glm::vec2(0.f);
+        // The velocity isn't changed in this state, so the bot falls asleep
+        Physics::setVelocity(getEntity(), glm::vec2(0.f));
         if (m_time > m_idleTime)
         {
             m_currentState = WALK;
@@ -32,7 +35,7 @@ void BotScript::onUpdate(float deltaTime)
     }
     else if (m_currentState == WALK)
     {
-        rigidbody.velocity = glm::vec2(m_dir) * m_speed * 200.f;
+        Physics::setVelocity(getEntity(), glm::vec2(m_dir) * m_speed * 200.f);
         if (m_time > m_walkTime)
         {
             m_currentState = IDLE;
@@ -46,5 +49,5 @@ void BotScript::onUpdate(float deltaTime)
     // SpriteAnimator
     auto &animator = m_spriteEntity.getComponent<SpriteAnimatorComponent>();
 
-    animator.parameterStorage.at("velocity") = rigidbody.velocity;
+    animator.parameterStorage.set(m_velocityParameter, getComponent<RigidbodyComponent>().velocity);
 }
@@ -2,6 +2,7 @@
 #define RPG_BOTSCRIPT_H
 
 #include "../scene/Script.h"
+#include "../client/animation/SpriteAnimatorParameter.h"
 
 enum BotState
 {
@@ -14,6 +15,7 @@ class BotScript : public Script
     float m_speed{1.3f};
 
     Entity m_spriteEntity{};
+    SpriteAnimatorParameterHandle<glm::vec2> m_velocityParameter{};
 
     BotState m_currentState{IDLE};
     glm::ivec2 m_dir{0};
@@ -28,19 +28,27 @@ void DebugInfoScript::onUpdate(float deltaTime)
         m_lastTime = m_currentTime;
     }
 
-    auto &transform = getComponent<TransformComponent>();
     auto &cameraComponent = m_cameraEntity.getComponent<CameraComponent>();
+    getEntity().patchComponent<TransformComponent>([&](auto &transform)
+    {
+        transform.position = glm::vec2(-cameraComponent.getWidth() / 2, -cameraComponent.getHeight() / 2);
+        transform.scale = glm::vec2(1 / cameraComponent.zoom);
+    });
 
-    transform.position = glm::vec2(-cameraComponent.getWidth() / 2, -cameraComponent.getHeight() / 2);
-    transform.scale = glm::vec2(1 / cameraComponent.zoom);
+    std::string text = "FPS: " + std::to_string(m_fps);
 
-    auto &textRenderer = getComponent<TextRendererComponent>();
-    textRenderer.text = "FPS: " + std::to_string(m_fps);
+    text += "\nvisible: " + std::to_string(cameraComponent.visibleCount) +
+            " culled: " + std::to_string(cameraComponent.culledCount);
 
-    textRenderer.text += "\ntime: " + m_clockEntity.getComponent<ClockComponent>().clock.toString();
+    text += "\ntime: " + m_clockEntity.getComponent<ClockComponent>().clock.toString();
 
     Entity playerEntity = getComponent<HierarchyComponent>().parent;
     auto &playerPosition = playerEntity.getComponent<TransformComponent>().position;
 
-    textRenderer.text += "\nx: " + std::to_string(playerPosition.x / 64) + " y: " + std::to_string(playerPosition.y / 64);
+    text += "\nx: " + std::to_string(playerPosition.x / 64) + " y: " + std::to_string(playerPosition.y / 64);
+
+    if (getComponent<TextRendererComponent>().text != text)
+    {
+        getEntity().patchComponent<TextRendererComponent>([&](auto &textRenderer) { textRenderer.text = std::move(text); });
+    }
 }
@@ -17,22 +17,30 @@ void PlayerScript::onCreate()
     m_cameraEntity = Hierarchy::find(getEntity(), "camera");
     m_hpEntity = Hierarchy::find(getEntity(), "hp");
     m_spriteEntity = Hierarchy::find(getEntity(), "sprite");
+
+    auto &animator = m_spriteEntity.getComponent<SpriteAnimatorComponent>();
+    m_velocityParameter = animator.animator->getParameter<glm::vec2>("velocity");
 }
 
 void PlayerScript::onUpdate(float deltaTime)
 {
-    auto &textTransform = m_hpEntity.getComponent<TransformComponent>();
     auto &cameraComponent = m_cameraEntity.getComponent<CameraComponent>();
-
-    textTransform.position = glm::vec2(cameraComponent.getWidth() / 2, cameraComponent.getHeight() / 2);
-    textTransform.scale = glm::vec2(1 / cameraComponent.zoom);
+    m_hpEntity.patchComponent<TransformComponent>([&](auto &textTransform)
+    {
+        textTransform.position = glm::vec2(cameraComponent.getWidth() / 2, cameraComponent.getHeight() / 2);
+        textTransform.scale = glm::vec2(1 / cameraComponent.zoom);
+    });
 
     auto &hpComponent = getComponent<HpComponent>();
-    auto &textRenderer = m_hpEntity.getComponent<TextRendererComponent>();
-    textRenderer.text = "HP: " + std::to_string(hpComponent.value);
+    std::string hpText = "HP: " + std::to_string(hpComponent.value);
+    if (m_hpEntity.getComponent<TextRendererComponent>().text != hpText)
+    {
+        m_hpEntity.patchComponent<TextRendererComponent>([&](auto &textRenderer)
+                                                         { textRenderer.text = std::move(hpText); });
+    }
 
     // animator
     auto &animator = m_spriteEntity.getComponent<SpriteAnimatorComponent>();
     auto &rigidbody = getComponent<RigidbodyComponent>();
-    animator.parameterStorage.at("velocity") = rigidbody.velocity;
+    animator.parameterStorage.set(m_velocityParameter, rigidbody.velocity);
 }
@@ -2,6 +2,7 @@
 #define RPG_PLAYER_H
 
 #include "../scene/Script.h"
+#include "../client/animation/SpriteAnimatorParameter.h"
 
 // TODO: refactor
 class PlayerScript : public Script
@@ -9,6 +10,7 @@ class PlayerScript : public Script
     Entity m_cameraEntity{};
     Entity m_hpEntity{};
     Entity m_spriteEntity{};
+    SpriteAnimatorParameterHandle<glm::vec2> m_velocityParameter{};
 
 public:
     void onCreate() override;
@@ -25,8 +25,8 @@ void PumpkinScript::onUpdate(float deltaTime)
 
     IWindow &window = Engine::getWindow();
 
-    auto &textTransform = m_textEntity.getComponent<TransformComponent>();
-    textTransform.position.y = 5 * std::sin(t) + 32;
+    m_textEntity.patchComponent<TransformComponent>([&](auto &textTransform)
+                                                    { textTransform.position.y = 5 * std::sin(t) + 32; });
 
     auto &pumpkinTransform = getComponent<TransformComponent>();
     auto &playerTransform = m_playerEntity.getComponent<TransformComponent>();
@@ -34,17 +34,17 @@ void PumpkinScript::onUpdate(float deltaTime)
     auto &textRenderer = m_textEntity.getComponent<TextRendererComponent>();
     auto &audioSource = getComponent<AudioSourceComponent>();
 
-    if (glm::distance(pumpkinTransform.position, playerTransform.position) < 64.f)
+    bool playerNear = glm::distance(pumpkinTransform.position, playerTransform.position) < 64.f;
+    if (playerNear && window.getKey(Key::E))
     {
-        textRenderer.text = "Press [E]";
-        if (window.getKey(Key::E))
-        {
-            audioSource.play();
-        }
+        audioSource.play();
     }
-    else
+
+    // A patch makes the text bounds update, so it's done only when the text changes
+    const char *prompt = playerNear ? "Press [E]" : "";
+    if (textRenderer.text != prompt)
     {
-        textRenderer.text = "";
+        m_textEntity.patchComponent<TextRendererComponent>([&](auto &text) { text.text = prompt; });
     }
 
     if (audioSource.state == AudioState::Play)
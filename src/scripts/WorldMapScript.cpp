@@ -3,10 +3,12 @@
 
 #include "../client/graphics/Rect.h"
 #include "../client/Engine.h"
+#include "../utils/Hash.h"
 #include <vector>
 
-WorldMapGenerator::WorldMapGenerator(Texture &texture, Entity player)
-    : m_simplexNoise(DEBUG_SEED),
+WorldMapGenerator::WorldMapGenerator(Texture &texture, Entity player, u64 seed)
+    : m_seed(seed),
+      m_simplexNoise(seed),
       m_texture(texture),
       m_player(player)
 {
@@ -14,41 +16,174 @@ WorldMapGenerator::WorldMapGenerator(Texture &texture, Entity player)
 
 std::vector<Tile> WorldMapGenerator::generateTiles(int x, int y)
 {
-    auto &transform = m_player.getComponent<TransformComponent>();
+    glm::ivec2 tile(x, y);
+    WorldChunk &chunk = getChunk(WorldChunk::toChunk(tile));
 
-    double value = m_simplexNoise.getNoise(x, y);
-
-    if (value > 0.3f)
+    switch (chunk.tiles[WorldChunk::toIndex(WorldChunk::toLocal(tile))])
     {
+    case WorldTile::Sand:
+        return {sandTile};
+    case WorldTile::Grass:
+        return {grassTile};
+    case WorldTile::Dirt:
         return {dirtTile};
+    case WorldTile::GrassMushroom:
+        return {grassTile, mushroomTile};
     }
-    if (value > -0.2f)
+    return {};
+}
+
+std::vector<Object> WorldMapGenerator::generateObjects(int x, int y, std::vector<Tile> tiles)
+{
+    glm::ivec2 tile(x, y);
+    WorldChunk &chunk = getChunk(WorldChunk::toChunk(tile));
+
+    if (const Object *object = getObject(chunk.objects[WorldChunk::toIndex(WorldChunk::toLocal(tile))]))
     {
-        if ((int)(value * 10000) % 83 == 1)
-        {
-            return {grassTile, mushroomTile};
-        }
-        return {grassTile};
+        return {*object};
     }
-    return {sandTile};
+    return {};
 }
 
-std::vector<Object> WorldMapGenerator::generateObjects(int x, int y, std::vector<Tile> tiles)
+bool WorldMapGenerator::isSolid(int x, int y)
 {
-    double value = m_simplexNoise.getNoise(x, y);
+    glm::ivec2 tile(x, y);
+    WorldChunk &chunk = getChunk(WorldChunk::toChunk(tile));
+
+    const Object *object = getObject(chunk.objects[WorldChunk::toIndex(WorldChunk::toLocal(tile))]);
+    return object && object->solid;
+}
 
-    if (value > -0.15f && value < 0.3f && tiles.size() == 1)
+WorldChunk WorldMapGenerator::generateChunk(glm::ivec2 chunk) const
+{
+    WorldChunk result;
+    for (int localY = 0; localY < WORLD_CHUNK_SIZE; localY++)
     {
-        if ((int)(value * 10000) % 11 == 1)
+        for (int localX = 0; localX < WORLD_CHUNK_SIZE; localX++)
         {
-            return {treeObject};
+            int x = chunk.x * WORLD_CHUNK_SIZE + localX;
+            int y = chunk.y * WORLD_CHUNK_SIZE + localY;
+            int index = WorldChunk::toIndex({localX, localY});
+
+            double value = m_simplexNoise.getNoise(x, y);
+
+            WorldTile tile = WorldTile::Sand;
+            if (value > 0.3f)
+            {
+                tile = WorldTile::Dirt;
+            }
+            else if (value > -0.2f)
+            {
+                tile = random(x, y, 0) < MushroomChance ? WorldTile::GrassMushroom : WorldTile::Grass;
+            }
+            result.tiles[index] = tile;
+
+            // The objects grow only on the plain grass
+            WorldObject object = WorldObject::None;
+            if (value > -0.15f && value < 0.3f && tile == WorldTile::Grass)
+            {
+                float chance = random(x, y, 1);
+                if (chance < TreeChance)
+                {
+                    object = WorldObject::Tree;
+                }
+                else if (chance < TreeChance + BushChance)
+                {
+                    object = WorldObject::Bush;
+                }
+            }
+            result.objects[index] = object;
         }
-        else if ((int)(value * 10000) % 31 == 1)
+    }
+    return result;
+}
+
+void WorldMapGenerator::setObject(int x, int y, WorldObject object)
+{
+    glm::ivec2 tile(x, y);
+    glm::ivec2 chunkCoordinates = WorldChunk::toChunk(tile);
+
+    WorldChunk &chunk = getChunk(chunkCoordinates);
+    chunk.objects[WorldChunk::toIndex(WorldChunk::toLocal(tile))] = object;
+
+    glm::ivec2 region = RegionFile::toRegion(chunkCoordinates);
+    getRegion(region).write(chunkCoordinates - region * REGION_SIZE, chunk);
+}
+
+void WorldMapGenerator::save()
+{
+    for (auto &[key, region] : m_regions)
+    {
+        region->save();
+    }
+}
+
+WorldChunk &WorldMapGenerator::getChunk(glm::ivec2 chunk)
+{
+    u64 key = toKey(chunk);
+    if (m_lastChunk && m_lastChunkKey == key)
+    {
+        return *m_lastChunk;
+    }
+
+    auto it = m_chunks.find(key);
+    if (it == m_chunks.end())
+    {
+        // The noise is evaluated only for the chunks which were never generated in this world
+        glm::ivec2 region = RegionFile::toRegion(chunk);
+        glm::ivec2 local = chunk - region * REGION_SIZE;
+        RegionFile &regionFile = getRegion(region);
+
+        it = m_chunks.emplace(key, WorldChunk{}).first;
+        if (!regionFile.read(local, it->second))
         {
-            return {bushObject};
+            it->second = generateChunk(chunk);
+            regionFile.write(local, it->second);
         }
     }
-    return {};
+
+    // The map nodes don't move, so the pointer stays valid
+    m_lastChunkKey = key;
+    m_lastChunk = &it->second;
+    return it->second;
+}
+
+RegionFile &WorldMapGenerator::getRegion(glm::ivec2 region)
+{
+    auto &regionFile = m_regions[toKey(region)];
+    if (!regionFile)
+    {
+        std::string path = TRUERPG_SAVE_DIR "/world/" + Hash::toHex(m_seed) + "/r." + std::to_string(region.x) + "." +
+                           std::to_string(region.y) + ".rreg";
+        regionFile = std::make_unique<RegionFile>(path, m_seed, region);
+    }
+    return *regionFile;
+}
+
+const Object *WorldMapGenerator::getObject(WorldObject object) const
+{
+    switch (object)
+    {
+    case WorldObject::None:
+        return nullptr;
+    case WorldObject::Tree:
+        return &treeObject;
+    case WorldObject::Bush:
+        return &bushObject;
+    }
+    return nullptr;
+}
+
+float WorldMapGenerator::random(int x, int y, u64 salt) const
+{
+    // A hash of the place instead of the noise value, so the chances don't depend on the terrain
+    u64 hash = Hash::mix(m_seed ^ Hash::mix(toKey({x, y}) ^ Hash::mix(salt)));
+    return (float) (hash >> 40) / (float) (1 << 24);
+}
+
+u64 WorldMapGenerator::toKey(glm::ivec2 coordinates)
+{
+    return ((u64) (u32) coordinates.x << 32) | (u32) coordinates.y;
 }
 
 WorldMapScript::WorldMapScript(Texture &texture, Entity player)
@@ -69,4 +204,17 @@ void WorldMapScript::onUpdate(float deltaTime)
     float radius = std::max(window.getWidth(), window.getHeight()) / 2;
     float scale = std::max(m_worldTransform->scale.x, m_worldTransform->scale.y);
     m_worldMap->renderRadius = radius / (scale * m_worldMap->tileSize) + 3;
+
+    // The changes survive a crash, at most the last interval is lost
+    m_saveTime += deltaTime;
+    if (m_saveTime >= WORLD_SAVE_INTERVAL)
+    {
+        m_worldMapGenerator.save();
+        m_saveTime = 0.f;
+    }
+}
+
+void WorldMapScript::onDestroy()
+{
+    m_worldMapGenerator.save();
 }
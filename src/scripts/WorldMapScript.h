@@ -1,14 +1,34 @@
 #ifndef RPG_WORLDMAPSCRIPT_H
 #define RPG_WORLDMAPSCRIPT_H
 
+#include <memory>
+#include <unordered_map>
 #include "../scene/Script.h"
 #include "../utils/OpenSimplexNoise.h"
+#include "../utils/RegionFile.h"
+#include "../utils/WorldChunk.h"
 #include "../components/world/WorldMapComponent.h"
 
 #define DEBUG_SEED 2
 
+// How often the new and changed chunks are written into the region files, in seconds
+#define WORLD_SAVE_INTERVAL 30.f
+
+/**
+ * Generates the world map chunk by chunk. A chunk depends only on the seed and its coordinates.
+ *
+ * The generated chunks are kept in memory and in the region files, so the noise is evaluated only once for every
+ * place of the world, even across the game sessions. The changes of the map are kept in the same way.
+ * The regions are written every WORLD_SAVE_INTERVAL seconds and when the script is destroyed.
+ */
 class WorldMapGenerator : public IWorldMapGenerator
 {
+    // The chance of a tile to have a mushroom, a tree or a bush
+    static constexpr float MushroomChance = 1.f / 83;
+    static constexpr float TreeChance = 1.f / 11;
+    static constexpr float BushChance = 1.f / 31;
+
+    u64 m_seed;
     OpenSimplexNoise m_simplexNoise;
 
     Texture &m_texture;
@@ -18,16 +38,57 @@ class WorldMapGenerator : public IWorldMapGenerator
     Tile dirtTile{&m_texture, IntRect(160, 4224, 32, 32)};
     Tile mushroomTile{&m_texture, IntRect(0, 4000, 32, 32)};
 
-    Object treeObject{&m_texture, IntRect(64, 4160, 64, 64), glm::vec2(16, -8), 20};
+    Object treeObject{&m_texture, IntRect(64, 4160, 64, 64), glm::vec2(16, -8), 20, true};
     Object bushObject{&m_texture, IntRect(32, 4064, 32, 32), glm::vec2(0.f), 4};
 
     Entity m_player;
 
+    std::unordered_map<u64, WorldChunk> m_chunks;
+    std::unordered_map<u64, std::unique_ptr<RegionFile>> m_regions;
+
+    // Most of the tiles are asked in rows, so the last chunk is remembered
+    u64 m_lastChunkKey{};
+    WorldChunk *m_lastChunk{};
+
 public:
-    WorldMapGenerator(Texture &texture, Entity player);
+    WorldMapGenerator(Texture &texture, Entity player, u64 seed = DEBUG_SEED);
 
     std::vector<Tile> generateTiles(int x, int y) override;
     std::vector<Object> generateObjects(int x, int y, std::vector<Tile> tiles) override;
+    bool isSolid(int x, int y) override;
+
+    /**
+     * Generate a chunk from the noise. The result depends only on the seed and the chunk coordinates.
+     *
+     * @param chunk the chunk coordinates
+     * @return the chunk
+     */
+    WorldChunk generateChunk(glm::ivec2 chunk) const;
+
+    /**
+     * Put an object on the tile or remove it. The change is saved with the region.
+     *
+     * @param x the tile X
+     * @param y the tile Y
+     * @param object the object or WorldObject::None
+     */
+    void setObject(int x, int y, WorldObject object);
+
+    /**
+     * Write the new and changed chunks into the region files.
+     */
+    void save();
+
+private:
+    WorldChunk &getChunk(glm::ivec2 chunk);
+
+    RegionFile &getRegion(glm::ivec2 region);
+
+    const Object *getObject(WorldObject object) const;
+
+    float random(int x, int y, u64 salt) const;
+
+    static u64 toKey(glm::ivec2 coordinates);
 };
 
 class WorldMapScript : public Script
@@ -37,11 +98,15 @@ private:
     TransformComponent *m_worldTransform{};
     WorldMapGenerator m_worldMapGenerator;
 
+    // The time since the last save
+    float m_saveTime{};
+
 public:
     WorldMapScript(Texture &texture, Entity player);
 
     void onCreate() override;
     void onUpdate(float deltaTime) override;
+    void onDestroy() override;
 };
 
 #endif // RPG_WORLDMAPSCRIPT_H
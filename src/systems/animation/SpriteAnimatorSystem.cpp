@@ -1,10 +1,10 @@
 #include "../../pch.h"
 #include "SpriteAnimatorSystem.h"
 
-#include <algorithm>
-
 #include "../../components/render/SpriteRendererComponent.h"
 #include "../../components/animation/SpriteAnimatorComponent.h"
+#include "../../client/Engine.h"
+#include "../../client/graphics/SpriteAnimationTable.h"
 
 SpriteAnimatorSystem::SpriteAnimatorSystem(entt::registry &registry) : m_registry(registry)
 {
@@ -12,54 +12,89 @@ SpriteAnimatorSystem::SpriteAnimatorSystem(entt::registry &registry) : m_registr
 
 void SpriteAnimatorSystem::update(float deltaTime)
 {
-    auto view = m_registry.view<SpriteRendererComponent, SpriteAnimatorComponent>();
+    auto &animationTable = Engine::getSpriteAnimationTable();
+    animationTable.advance(deltaTime);
 
-    for (auto viewElement : view.each())
-    {
-        auto& rendererComponent = std::get<1>(viewElement);
-        auto& animatorComponent = std::get<2>(viewElement);
-        
-        // Handle transitions
+    // The animator states are updated in one pass over their packed array,
+    // the sprites are touched afterwards and only if their frame has changed
+    auto animators = m_registry.view<SpriteAnimatorComponent>();
 
-        auto transitionConditionMet = [&](SpriteAnimatorTransition *t) {
-            return t->condition(animatorComponent.parameterStorage);
-        };
+    for (auto [entity, animatorComponent] : animators.each())
+    {
+        const SpriteAnimator &animator = *animatorComponent.animator;
 
-        do
+        // The shader plays the animation, nothing can change until a parameter does
+        if (animatorComponent.gpuAnimation && !animatorComponent.parameterStorage.changed)
         {
-            auto *fromTransitions = &animatorComponent.activeAnimation.node->fromTransitions;
+            continue;
+        }
+        animatorComponent.parameterStorage.changed = false;
 
-            if (auto found = std::find_if(fromTransitions->begin(), fromTransitions->end(), transitionConditionMet);
-                found != fromTransitions->end())
+        // Handle transitions, a node can't be left more times than there are nodes
+        u16 node = animatorComponent.node;
+        for (std::size_t i = 0; i < animator.nodes.size(); i++)
+        {
+            u16 next = animator.findTransition(node, animatorComponent.parameterStorage);
+            if (next == node)
             {
-                animatorComponent.activeAnimation.node = (*found)->destination;
-                animatorComponent.activeAnimation.frame.index = 0;
-                animatorComponent.activeAnimation.frame.time = 0;
-                continue;
+                break;
             }
+            node = next;
+        }
 
-            break;
-        } while (true);
-
-        // Handle animation frame swap
+        const SpriteAnimatorNode &activeNode = animator.nodes[node];
 
-        auto &frames = animatorComponent.activeAnimation.node->animation.frames;
+        if (node != animatorComponent.node)
+        {
+            animatorComponent.node = node;
+            animatorComponent.frame = activeNode.firstFrame;
+            animatorComponent.time = 0;
+            animatorComponent.frameChanged = activeNode.frameCount != 0;
+        }
 
-        auto *activeFrameInfo = &animatorComponent.activeAnimation.frame;
-        auto *activeFrame = &frames[activeFrameInfo->index];
+        if (activeNode.frameCount == 0 || animatorComponent.gpuAnimation)
+        {
+            continue;
+        }
 
-        activeFrameInfo->time += deltaTime;
+        // Handle animation frame swap
+        animatorComponent.time += deltaTime;
 
-        while (activeFrame->duration < activeFrameInfo->time)
+        while (animator.frames[animatorComponent.frame].duration < animatorComponent.time)
         {
-            float leftTime = activeFrame->duration - activeFrameInfo->time;
+            float leftTime = animator.frames[animatorComponent.frame].duration - animatorComponent.time;
+
+            u16 index = animatorComponent.frame - activeNode.firstFrame;
+            animatorComponent.frame = activeNode.firstFrame + (index + 1) % activeNode.frameCount;
+            animatorComponent.time = leftTime;
+            animatorComponent.frameChanged = true;
+        }
+    }
 
-            activeFrameInfo->index = (activeFrameInfo->index + 1) % frames.size();
-            activeFrameInfo->time = leftTime;
+    auto view = m_registry.view<SpriteRendererComponent, SpriteAnimatorComponent>();
 
-            activeFrame = &frames[activeFrameInfo->index];
+    for (auto entity : view)
+    {
+        auto &animatorComponent = view.get<SpriteAnimatorComponent>(entity);
+        if (!animatorComponent.frameChanged)
+        {
+            continue;
         }
+        animatorComponent.frameChanged = false;
+
+        // Patched, so the visibility system measures the new frame
+        const SpriteAnimator &animator = *animatorComponent.animator;
+        m_registry.patch<SpriteRendererComponent>(entity, [&](auto &rendererComponent)
+        {
+            rendererComponent.textureRect = animator.frames[animatorComponent.frame].rect;
 
-        rendererComponent.textureRect = activeFrame->rect;
+            if (animatorComponent.gpuAnimation)
+            {
+                const SpriteAnimatorNode &node = animator.nodes[animatorComponent.node];
+                rendererComponent.animation = animationTable.getAnimation(&animator.frames[node.firstFrame],
+                                                                          node.frameCount);
+                rendererComponent.animationStart = animationTable.getTime();
+            }
+        });
     }
 }
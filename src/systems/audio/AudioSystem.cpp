@@ -6,58 +6,56 @@
 #include "../../utils/Hierarchy.h"
 
 AudioSystem::AudioSystem(entt::registry &registry)
-        : m_registry(registry)
+        : m_registry(registry),
+          m_transformObserver(registry, entt::collector.update<TransformComponent>())
 {
     // Let's catch the moment of creating/destroying components
     m_registry.on_construct<AudioSourceComponent>().connect<&AudioSystem::onConstruct>(this);
     m_registry.on_destroy<AudioSourceComponent>().connect<&AudioSystem::onDestroy>(this);
+    m_registry.on_destroy<AudioSourceInstanceComponent>().connect<&AudioSystem::onInstanceDestroy>(this);
 }
 
 void AudioSystem::update(float deltaTime)
 {
-    // Find the listener
-    entt::entity listenerEntity = entt::null;
+    // Receive the news from the audio thread
+    m_audioDevice.update();
+
+    // Only the sources which have moved get new places in the tree, a parent moves all its children
+    for (auto entity : m_transformObserver)
     {
-        auto view = m_registry.view<AudioListenerComponent>();
-        for (auto entity : view)
-        {
-            listenerEntity = entity;
-            break;
-        }
+        moveProxy(entity);
+        Hierarchy::forEachDescendant({entity, &m_registry}, [&](Entity child) { moveProxy(child); });
     }
+    m_transformObserver.clear();
 
     // If we don't have the listener, do nothing
+    entt::entity listenerEntity = findListener();
     if (listenerEntity == entt::null) return;
 
     // Compute the listener's coordinates
     TransformComponent listenerTransform = Hierarchy::computeTransform({listenerEntity, &m_registry});
     glm::vec2 listenerPosition = listenerTransform.position;
 
-    auto view = m_registry.view<AudioSourceComponent>();
+    m_frame++;
+    m_heardNow.clear();
+    float maxDistance = 0.f;
+
+    auto view = m_registry.view<AudioSourceComponent, AudioSourceInstanceComponent>();
     for (auto entity : view)
     {
-        auto &audioSourceComponent = view.get<AudioSourceComponent>(entity);
+        auto [audioSourceComponent, instance] = view.get<AudioSourceComponent, AudioSourceInstanceComponent>(entity);
+        auto *audioSource = instance.source;
 
-        float volumeFactor = 1.f;
-        float panFactor = 0.f;
-        if (!audioSourceComponent.global)
+        // The sound has reached the end, so it doesn't play anymore
+        if (audioSource->pollFinished() && audioSourceComponent.state == AudioState::Play)
         {
-            // Compute the source's coordinates
-            auto transformComponent = Hierarchy::computeTransform({entity, &m_registry});
-            glm::vec2 sourcePosition = transformComponent.position;
-
-            // Calculate the volume
-            volumeFactor = 1.f - glm::distance(listenerPosition, sourcePosition) / audioSourceComponent.maxDistance;
-            volumeFactor = std::clamp(volumeFactor, 0.f, 1.f);
-
-            // Calculate the panning
-            panFactor = (sourcePosition - listenerPosition).x / audioSourceComponent.maxDistance * 2.f;
+            audioSourceComponent.state = AudioState::Stop;
         }
 
-        auto* audioSource = m_audioSourceRegistry[entity];
-        audioSource->setVolume(audioSourceComponent.volume * volumeFactor);
-        audioSource->setPan(audioSourceComponent.pan + panFactor);
+        // The source sends only what has changed, so these are cheap
         audioSource->setLoop(audioSourceComponent.loop);
+        audioSource->setPitch(audioSourceComponent.pitch);
+        audioSource->setPriority(audioSourceComponent.priority);
 
         if (audioSourceComponent.state == AudioState::Play)
         {
@@ -71,36 +69,164 @@ void AudioSystem::update(float deltaTime)
         {
             audioSource->stop();
         }
+
+        if (audioSourceComponent.global)
+        {
+            if (instance.proxy != AABB_TREE_NULL)
+            {
+                m_tree.remove(instance.proxy);
+                instance.proxy = AABB_TREE_NULL;
+            }
+            setVolume(*audioSource, audioSourceComponent.volume);
+            setPan(*audioSource, audioSourceComponent.pan);
+            continue;
+        }
+
+        // New positional sources are put into the tree here, the rest is done for the ones near the listener
+        if (instance.proxy == AABB_TREE_NULL)
+        {
+            auto transformComponent = Hierarchy::computeTransform({entity, &m_registry});
+            instance.proxy = m_tree.insert(entity, transformComponent.position, transformComponent.position);
+        }
+        maxDistance = std::max(maxDistance, audioSourceComponent.maxDistance);
     }
+    m_maxDistance = maxDistance;
+
+    m_tree.queryRadius(listenerPosition, m_maxDistance, [&](entt::entity entity) { hear(entity, listenerPosition); });
+
+    // The sources which have gone too far since the last frame are muted once
+    for (auto entity : m_heard)
+    {
+        if (!m_registry.valid(entity)) continue;
+
+        auto *instance = m_registry.try_get<AudioSourceInstanceComponent>(entity);
+        if (instance && instance->heardFrame != m_frame)
+        {
+            instance->source->setVolume(0.f);
+        }
+    }
+    std::swap(m_heard, m_heardNow);
+
+    // Give the real voices to the sounds that are heard the most
+    m_audioDevice.updateVoices();
+}
+
+void AudioSystem::setMaxRealVoices(u32 maxRealVoices)
+{
+    m_audioDevice.setMaxRealVoices(maxRealVoices);
 }
 
 void AudioSystem::destroy()
 {
-    // Clear everything here
-    m_audioDevice.clear();
-    for (const auto &item : m_audioSourceRegistry)
+    // Clear everything here, the instances delete their sources
+    m_registry.clear<AudioSourceInstanceComponent>();
+
+    // The clips are usually released right after this, the audio thread mustn't read them anymore
+    m_audioDevice.drain();
+    m_tree.clear();
+    m_transformObserver.clear();
+    m_heard.clear();
+    m_listener = entt::null;
+}
+
+entt::entity AudioSystem::findListener()
+{
+    // The listener rarely changes, so the search is done only when the old one is gone
+    if (m_listener != entt::null && m_registry.valid(m_listener) && m_registry.all_of<AudioListenerComponent>(m_listener))
+    {
+        return m_listener;
+    }
+
+    m_listener = entt::null;
+    auto view = m_registry.view<AudioListenerComponent>();
+    for (auto entity : view)
+    {
+        m_listener = entity;
+        break;
+    }
+    return m_listener;
+}
+
+void AudioSystem::moveProxy(entt::entity entity)
+{
+    // The sources without a proxy are global or not in the tree yet
+    auto *instance = m_registry.try_get<AudioSourceInstanceComponent>(entity);
+    if (!instance || instance->proxy == AABB_TREE_NULL) return;
+
+    auto transformComponent = Hierarchy::computeTransform({entity, &m_registry});
+    m_tree.move(instance->proxy, transformComponent.position, transformComponent.position);
+}
+
+void AudioSystem::hear(entt::entity entity, glm::vec2 listenerPosition)
+{
+    auto &audioSourceComponent = m_registry.get<AudioSourceComponent>(entity);
+    auto &instance = m_registry.get<AudioSourceInstanceComponent>(entity);
+
+    // The tree gives the fattened boxes, so the distance still has to be checked
+    auto transformComponent = Hierarchy::computeTransform({entity, &m_registry});
+    glm::vec2 sourcePosition = transformComponent.position;
+    float distance = glm::distance(listenerPosition, sourcePosition);
+    if (distance >= audioSourceComponent.maxDistance) return;
+
+    instance.heardFrame = m_frame;
+    m_heardNow.push_back(entity);
+
+    // Calculate the volume
+    float volumeFactor = 1.f - distance / audioSourceComponent.maxDistance;
+    volumeFactor = std::clamp(volumeFactor, 0.f, 1.f);
+
+    // Calculate the panning
+    float panFactor = (sourcePosition - listenerPosition).x / audioSourceComponent.maxDistance * 2.f;
+
+    setVolume(*instance.source, audioSourceComponent.volume * volumeFactor);
+    setPan(*instance.source, audioSourceComponent.pan + panFactor);
+}
+
+void AudioSystem::setVolume(AudioSource &source, float volume)
+{
+    // Silence must be exact, otherwise a faded out source could stay slightly audible
+    if (std::abs(source.getVolume() - volume) > AUDIO_PARAM_EPSILON || (volume == 0.f) != (source.getVolume() == 0.f))
+    {
+        source.setVolume(volume);
+    }
+}
+
+void AudioSystem::setPan(AudioSource &source, float pan)
+{
+    if (std::abs(source.getPan() - pan) > AUDIO_PARAM_EPSILON)
     {
-        delete item.second;
+        source.setPan(pan);
     }
-    m_audioSourceRegistry.clear();
 }
 
 void AudioSystem::onConstruct(entt::registry &registry, entt::entity entity)
 {
     // At creation time, we create the corresponding audio source for the component
-    // and bind it with the entity in the audio source registry
+    // and keep it in the instance component of the same entity
     auto &audioSourceComponent = registry.get<AudioSourceComponent>(entity);
 
-    auto* audioSource = new AudioSource(*audioSourceComponent.audioClip);
-    m_audioSourceRegistry.insert({entity, audioSource});
+    auto *audioSource = new AudioSource(*audioSourceComponent.audioClip);
+
+    // It's silent until the first update finds out how far it is
+    audioSource->setVolume(0.f);
+
+    registry.emplace<AudioSourceInstanceComponent>(entity, audioSource);
     m_audioDevice.add(*audioSource);
 }
 
 void AudioSystem::onDestroy(entt::registry &registry, entt::entity entity)
 {
     // When the component is destroyed, the audio source must be destroyed as well
-    auto audioSource = m_audioSourceRegistry[entity];
-    m_audioDevice.remove(*audioSource);
-    delete audioSource;
-    m_audioSourceRegistry.erase(entity);
+    registry.remove<AudioSourceInstanceComponent>(entity);
+}
+
+void AudioSystem::onInstanceDestroy(entt::registry &registry, entt::entity entity)
+{
+    auto &instance = registry.get<AudioSourceInstanceComponent>(entity);
+    m_audioDevice.remove(*instance.source);
+    delete instance.source;
+    if (instance.proxy != AABB_TREE_NULL)
+    {
+        m_tree.remove(instance.proxy);
+    }
 }
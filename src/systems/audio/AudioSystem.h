@@ -3,18 +3,38 @@
 
 #include "entt.hpp"
 #include "../../components/audio/AudioSourceComponent.h"
+#include "../../components/audio/AudioSourceInstanceComponent.h"
 #include "../../client/audio/AudioSource.h"
 #include "../../client/audio/AudioDevice.h"
 #include "../../scene/ISystem.h"
+#include "../../utils/DynamicAabbTree.h"
+
+// How far a source can move before it's reinserted into the tree which is used to find the sources near the listener
+#define AUDIO_TREE_MARGIN 64.f
+
+// Smaller changes of the volume and the panning aren't heard, so they aren't sent to the audio thread
+#define AUDIO_PARAM_EPSILON 0.005f
 
 class AudioSystem : public ISystem
 {
     entt::registry &m_registry;
 
-    std::unordered_map<entt::entity, AudioSource*> m_audioSourceRegistry;
-
     AudioDevice m_audioDevice;
 
+    entt::entity m_listener{entt::null};
+
+    // The positional sources, only the ones near the listener are updated
+    DynamicAabbTree<entt::entity> m_tree{AUDIO_TREE_MARGIN};
+    float m_maxDistance{};
+
+    // The moved entities, the sources among them and their children are moved in the tree
+    entt::observer m_transformObserver;
+
+    // The sources which were near the listener in the last frame
+    std::vector<entt::entity> m_heard;
+    std::vector<entt::entity> m_heardNow;
+    u32 m_frame{};
+
 public:
     AudioSystem(entt::registry &registry);
 
@@ -22,9 +42,27 @@ public:
 
     void destroy() override;
 
+    /**
+     * Set the maximum number of sounds that are decoded at once, the other playing sounds become virtual.
+     *
+     * @param maxRealVoices the number of real voices
+     */
+    void setMaxRealVoices(u32 maxRealVoices);
+
 private:
+    entt::entity findListener();
+
+    void moveProxy(entt::entity entity);
+
+    void hear(entt::entity entity, glm::vec2 listenerPosition);
+
+    static void setVolume(AudioSource &source, float volume);
+
+    static void setPan(AudioSource &source, float pan);
+
     void onConstruct(entt::registry &registry, entt::entity entity);
     void onDestroy(entt::registry &registry, entt::entity entity);
+    void onInstanceDestroy(entt::registry &registry, entt::entity entity);
 };
 
 #endif //RPG_AUDIOSYSTEM_H
@@ -3,49 +3,313 @@
 
 #include "../../components/physics/RigidbodyComponent.h"
 #include "../../components/basic/TransformComponent.h"
-#include "../../client/graphics/Rect.h"
 #include "../../components/physics/RectColliderComponent.h"
+#include "../../components/physics/RectColliderInstanceComponent.h"
+#include "../../components/physics/SleepingComponent.h"
+#include "../../utils/Physics.h"
 
 PhysicsSystem::PhysicsSystem(entt::registry &registry)
-        : m_registry(registry) {}
+        : m_registry(registry),
+          m_colliderObserver(registry, entt::collector.update<TransformComponent>()
+                                               .where<RectColliderInstanceComponent>()
+                                               .update<RectColliderComponent>())
+{
+    m_registry.on_construct<RectColliderComponent>().connect<&PhysicsSystem::onConstruct>(this);
+    m_registry.on_destroy<RectColliderComponent>().connect<&PhysicsSystem::onDestroy>(this);
+    m_registry.on_destroy<RectColliderInstanceComponent>().connect<&PhysicsSystem::onInstanceDestroy>(this);
+
+    // A collider changes its tree when the rigidbody is added or removed
+    m_registry.on_construct<RigidbodyComponent>().connect<&PhysicsSystem::onBodyChange>(this);
+    m_registry.on_destroy<RigidbodyComponent>().connect<&PhysicsSystem::onBodyChange>(this);
+}
+
+PhysicsSystem::~PhysicsSystem()
+{
+    m_registry.on_construct<RectColliderComponent>().disconnect<&PhysicsSystem::onConstruct>(this);
+    m_registry.on_destroy<RectColliderComponent>().disconnect<&PhysicsSystem::onDestroy>(this);
+    m_registry.on_destroy<RectColliderInstanceComponent>().disconnect<&PhysicsSystem::onInstanceDestroy>(this);
+    m_registry.on_construct<RigidbodyComponent>().disconnect<&PhysicsSystem::onBodyChange>(this);
+    m_registry.on_destroy<RigidbodyComponent>().disconnect<&PhysicsSystem::onBodyChange>(this);
+}
 
 void PhysicsSystem::update(float deltaTime)
 {
-    auto view = m_registry.view<RigidbodyComponent>();
+    // The static colliders are moved only when they are patched
+    for (auto entity : m_colliderObserver)
+    {
+        syncCollider(entity, m_registry.get<TransformComponent>(entity).position);
+    }
+    m_colliderObserver.clear();
+
+    for (auto entity : m_dirtyColliders)
+    {
+        if (m_registry.valid(entity) && m_registry.all_of<RectColliderInstanceComponent>(entity))
+        {
+            syncCollider(entity, m_registry.get<TransformComponent>(entity).position);
+        }
+    }
+    m_dirtyColliders.clear();
+
+    findWorldMap();
+
+    auto view = m_registry.view<RigidbodyComponent>(entt::exclude<SleepingComponent>);
     for (auto entity : view)
     {
         auto &rigidbody = view.get<RigidbodyComponent>(entity);
         auto &transform = m_registry.get<TransformComponent>(entity);
+        bool hasCollider = m_registry.all_of<RectColliderComponent>(entity);
 
-        glm::vec2 nextPos = transform.position + rigidbody.velocity * deltaTime;
+        // The transform could be changed by a script, so the collider is brought up to date first.
+        // It costs nothing until the collider leaves its fattened box.
+        if (hasCollider)
+        {
+            syncCollider(entity, transform.position);
+        }
 
-        if (m_registry.all_of<RectColliderComponent>(entity))
+        if (rigidbody.type == BodyType::Static)
         {
-            auto &rectCollider = m_registry.get<RectColliderComponent>(entity);
+            m_fallingAsleep.push_back(entity);
+            continue;
+        }
 
-            auto otherView = m_registry.view<RectColliderComponent>();
-            for (auto otherEntity : otherView)
+        if (glm::length(rigidbody.velocity) < PHYSICS_SLEEP_VELOCITY)
+        {
+            rigidbody.stillTime += deltaTime;
+            if (rigidbody.stillTime >= PHYSICS_SLEEP_TIME)
             {
-                if (entity == otherEntity) continue;
-                auto &otherTransform = m_registry.get<TransformComponent>(otherEntity);
-                auto &otherRectCollider = m_registry.get<RectColliderComponent>(otherEntity);
-
-                bool collide = Rect{
-                    nextPos.x + rectCollider.offset.x,
-                    nextPos.y + rectCollider.offset.y,
-                    rectCollider.size.x, rectCollider.size.y
-                }.intersects({
-                       otherTransform.position.x + otherRectCollider.offset.x,
-                    otherTransform.position.y + otherRectCollider.offset.y,
-                    otherRectCollider.size.x, otherRectCollider.size.y
-                });
-
-                if (collide)
-                {
-                    nextPos = transform.position;
-                }
+                m_fallingAsleep.push_back(entity);
             }
         }
-        transform.position = nextPos;
+        else
+        {
+            rigidbody.stillTime = 0.f;
+        }
+
+        glm::vec2 displacement = rigidbody.velocity * deltaTime;
+        if (displacement == glm::vec2(0.f)) continue;
+
+        if (hasCollider)
+        {
+            if (rigidbody.type == BodyType::Dynamic)
+            {
+                displacement = sweep(entity, getColliderRect(entity, transform.position), displacement);
+            }
+            syncCollider(entity, transform.position + displacement);
+        }
+        m_registry.patch<TransformComponent>(entity, [&](auto &moved) { moved.position += displacement; });
+    }
+
+    for (auto entity : m_fallingAsleep)
+    {
+        m_registry.emplace_or_replace<SleepingComponent>(entity);
+    }
+    m_fallingAsleep.clear();
+}
+
+void PhysicsSystem::destroy()
+{
+    m_registry.clear<RectColliderInstanceComponent>();
+    m_tree.clear();
+    m_staticTree.clear();
+    m_colliderObserver.clear();
+    m_dirtyColliders.clear();
+}
+
+FloatRect PhysicsSystem::getColliderRect(entt::entity entity, glm::vec2 position)
+{
+    auto &rectCollider = m_registry.get<RectColliderComponent>(entity);
+    return {position.x + rectCollider.offset.x, position.y + rectCollider.offset.y,
+            rectCollider.size.x, rectCollider.size.y};
+}
+
+bool PhysicsSystem::isStatic(entt::entity entity)
+{
+    auto *rigidbody = m_registry.try_get<RigidbodyComponent>(entity);
+    return !rigidbody || rigidbody->type == BodyType::Static;
+}
+
+bool PhysicsSystem::isStuck(FloatRect rect, FloatRect other)
+{
+    // The overlap along each axis, the shallower one is the way out
+    float depthX = std::min(rect.getLeft() + rect.getWidth(), other.getLeft() + other.getWidth()) -
+                   std::max(rect.getLeft(), other.getLeft());
+    float depthY = std::min(rect.getBottom() + rect.getHeight(), other.getBottom() + other.getHeight()) -
+                   std::max(rect.getBottom(), other.getBottom());
+    return std::min(depthX, depthY) > PHYSICS_PENETRATION_SLOP;
+}
+
+void PhysicsSystem::syncCollider(entt::entity entity, glm::vec2 position)
+{
+    auto &instance = m_registry.get<RectColliderInstanceComponent>(entity);
+    FloatRect rect = getColliderRect(entity, position);
+    glm::vec2 min(rect.getLeft(), rect.getBottom());
+    glm::vec2 max = min + glm::vec2(rect.getWidth(), rect.getHeight());
+
+    // The body type has changed, so the collider goes to the other tree
+    bool colliderIsStatic = isStatic(entity);
+    if (instance.proxy != AABB_TREE_NULL && instance.isStatic != colliderIsStatic)
+    {
+        (instance.isStatic ? m_staticTree : m_tree).remove(instance.proxy);
+        instance.proxy = AABB_TREE_NULL;
+    }
+
+    auto &tree = colliderIsStatic ? m_staticTree : m_tree;
+    if (instance.proxy == AABB_TREE_NULL)
+    {
+        instance.proxy = tree.insert(entity, min, max);
+        instance.isStatic = colliderIsStatic;
+    }
+    else
+    {
+        tree.move(instance.proxy, min, max);
+    }
+}
+
+glm::vec2 PhysicsSystem::sweep(entt::entity entity, FloatRect rect, glm::vec2 displacement)
+{
+    if (displacement == glm::vec2(0.f)) return displacement;
+
+    glm::vec2 min(rect.getLeft(), rect.getBottom());
+    glm::vec2 max = min + glm::vec2(rect.getWidth(), rect.getHeight());
+
+    auto addObstacle = [&](entt::entity otherEntity)
+    {
+        if (entity == otherEntity) return;
+
+        FloatRect other = getColliderRect(otherEntity, m_registry.get<TransformComponent>(otherEntity).position);
+        if (!isStuck(rect, other))
+        {
+            m_obstacles.push_back({otherEntity, other});
+        }
+    };
+
+    // Everything that touches the box around the whole path
+    m_obstacles.clear();
+    glm::vec2 pathMin = glm::min(min, min + displacement);
+    glm::vec2 pathMax = glm::max(max, max + displacement);
+    m_tree.query(pathMin, pathMax, addObstacle);
+    m_staticTree.query(pathMin, pathMax, addObstacle);
+    addTileObstacles(rect, pathMin, pathMax);
+    glm::vec2 wanted = displacement;
+
+    // The obstacles in the way of the X movement are the ones which overlap the body along Y.
+    // The slop keeps the contacts, so a body which touches an obstacle a bit can't get through it.
+    const float slop = PHYSICS_PENETRATION_SLOP;
+    const float skin = PHYSICS_CONTACT_SKIN;
+    for (const auto &[otherEntity, other] : m_obstacles)
+    {
+        if (other.getBottom() >= max.y - slop || other.getBottom() + other.getHeight() <= min.y + slop) continue;
+
+        if (displacement.x > 0.f && other.getLeft() >= max.x - slop)
+        {
+            displacement.x = std::min(displacement.x, other.getLeft() - max.x - skin);
+        }
+        else if (displacement.x < 0.f && other.getLeft() + other.getWidth() <= min.x + slop)
+        {
+            displacement.x = std::max(displacement.x, other.getLeft() + other.getWidth() - min.x + skin);
+        }
+    }
+    min.x += displacement.x;
+    max.x += displacement.x;
+
+    // The Y movement starts where the X movement has stopped
+    for (const auto &[otherEntity, other] : m_obstacles)
+    {
+        if (other.getLeft() >= max.x - slop || other.getLeft() + other.getWidth() <= min.x + slop) continue;
+
+        if (displacement.y > 0.f && other.getBottom() >= max.y - slop)
+        {
+            displacement.y = std::min(displacement.y, other.getBottom() - max.y - skin);
+        }
+        else if (displacement.y < 0.f && other.getBottom() + other.getHeight() <= min.y + slop)
+        {
+            displacement.y = std::max(displacement.y, other.getBottom() + other.getHeight() - min.y + skin);
+        }
+    }
+
+    // The bodies which were hit wake up
+    if (displacement != wanted)
+    {
+        FloatRect moved(min.x, min.y + displacement.y, rect.getWidth(), rect.getHeight());
+        FloatRect touch(moved.getLeft() - 1.f, moved.getBottom() - 1.f, moved.getWidth() + 2.f, moved.getHeight() + 2.f);
+        for (const auto &[otherEntity, other] : m_obstacles)
+        {
+            if (otherEntity != entt::null && m_registry.all_of<SleepingComponent>(otherEntity) &&
+                touch.intersects(other))
+            {
+                Physics::wake({otherEntity, &m_registry});
+            }
+        }
+    }
+
+    return displacement;
+}
+
+void PhysicsSystem::onConstruct(entt::registry &registry, entt::entity entity)
+{
+    // The collider gets into the tree in the next update, when its transform is set
+    registry.emplace<RectColliderInstanceComponent>(entity);
+    m_dirtyColliders.push_back(entity);
+}
+
+void PhysicsSystem::findWorldMap()
+{
+    m_worldMap = nullptr;
+
+    auto view = m_registry.view<WorldMapComponent>();
+    for (auto entity : view)
+    {
+        auto &worldMapComponent = view.get<WorldMapComponent>(entity);
+        if (!worldMapComponent.generator) continue;
+
+        // The same tile size as WorldMapRenderSystem draws
+        auto &transform = m_registry.get<TransformComponent>(entity);
+        m_worldMap = worldMapComponent.generator;
+        m_tileSize = (float) worldMapComponent.tileSize * transform.scale;
+        break;
+    }
+}
+
+void PhysicsSystem::addTileObstacles(FloatRect rect, glm::vec2 pathMin, glm::vec2 pathMax)
+{
+    if (!m_worldMap) return;
+
+    glm::ivec2 from(glm::floor(pathMin / m_tileSize));
+    glm::ivec2 to(glm::floor(pathMax / m_tileSize));
+    for (int y = from.y; y <= to.y; y++)
+    {
+        for (int x = from.x; x <= to.x; x++)
+        {
+            if (!m_worldMap->isSolid(x, y)) continue;
+
+            // Like the colliders, only a tile which the body is stuck in doesn't block it
+            FloatRect tile((float) x * m_tileSize.x, (float) y * m_tileSize.y, m_tileSize.x, m_tileSize.y);
+            if (!isStuck(rect, tile))
+            {
+                m_obstacles.push_back({entt::null, tile});
+            }
+        }
+    }
+}
+
+void PhysicsSystem::onBodyChange(entt::registry &registry, entt::entity entity)
+{
+    if (registry.all_of<RectColliderComponent>(entity))
+    {
+        m_dirtyColliders.push_back(entity);
+    }
+}
+
+void PhysicsSystem::onDestroy(entt::registry &registry, entt::entity entity)
+{
+    registry.remove<RectColliderInstanceComponent>(entity);
+}
+
+void PhysicsSystem::onInstanceDestroy(entt::registry &registry, entt::entity entity)
+{
+    auto &instance = registry.get<RectColliderInstanceComponent>(entity);
+    if (instance.proxy != AABB_TREE_NULL)
+    {
+        (instance.isStatic ? m_staticTree : m_tree).remove(instance.proxy);
     }
 }
@@ -2,15 +2,113 @@
 #define RPG_PHYSICSSYSTEM_H
 
 #include "entt.hpp"
+#include <vector>
 #include "../../scene/ISystem.h"
+#include "../../client/graphics/Rect.h"
+#include "../../utils/DynamicAabbTree.h"
+#include "../../components/world/WorldMapComponent.h"
 
+// How far a collider can move before it's reinserted into the tree
+#define PHYSICS_TREE_MARGIN 16.f
+
+// A body which is slower than this for PHYSICS_SLEEP_TIME seconds falls asleep
+#define PHYSICS_SLEEP_VELOCITY 1.f
+#define PHYSICS_SLEEP_TIME 0.5f
+
+// A sweep stops this far before the obstacle, so the float error never makes the colliders overlap
+#define PHYSICS_CONTACT_SKIN 0.01f
+
+// An overlap shallower than this is a contact, a deeper one lets the body get out
+#define PHYSICS_PENETRATION_SLOP 0.1f
+
+/**
+ * Moves the rigidbodies and stops the dynamic ones at the colliders.
+ *
+ * Only the awake bodies are updated. The static colliders (the ones without a moving rigidbody) are kept
+ * in their own tree, which is changed only when their transform or collider is patched through registry.patch().
+ * So the cost of a step depends on the number of the awake bodies, not on the size of the world.
+ *
+ * The solid tiles of the world map block the dynamic bodies too. They aren't entities, the generator is asked
+ * about every tile a body touches.
+ */
 class PhysicsSystem : public ISystem
 {
+    struct Obstacle
+    {
+        entt::entity entity; // null for a tile
+        FloatRect rect;
+    };
+
     entt::registry& m_registry;
+
+    // The colliders of the moving bodies, a moving body is checked only against the ones near it
+    DynamicAabbTree<entt::entity> m_tree{PHYSICS_TREE_MARGIN};
+    DynamicAabbTree<entt::entity> m_staticTree{PHYSICS_TREE_MARGIN};
+
+    // The colliders which were patched
+    entt::observer m_colliderObserver;
+
+    // The colliders which are new or could have changed their tree
+    std::vector<entt::entity> m_dirtyColliders;
+
+    // The colliders which a body can hit during the current step, kept here to not allocate every time
+    std::vector<Obstacle> m_obstacles;
+
+    std::vector<entt::entity> m_fallingAsleep;
+
+    // The world map of the current step, it has no solid tiles if there is no generator
+    IWorldMapGenerator *m_worldMap{};
+    glm::vec2 m_tileSize{};
+
 public:
     PhysicsSystem(entt::registry& registry);
 
+    ~PhysicsSystem() override;
+
     void update(float deltaTime) override;
+
+    void destroy() override;
+
+private:
+    FloatRect getColliderRect(entt::entity entity, glm::vec2 position);
+
+    bool isStatic(entt::entity entity);
+
+    /**
+     * Check whether the body is stuck in the obstacle deeper than PHYSICS_PENETRATION_SLOP.
+     * Such an obstacle doesn't block the body, so the body can get out.
+     *
+     * @param rect the collider of the body
+     * @param other the obstacle
+     * @return true if the body is stuck in the obstacle
+     */
+    static bool isStuck(FloatRect rect, FloatRect other);
+
+    void syncCollider(entt::entity entity, glm::vec2 position);
+
+    /**
+     * Move the collider as far as it can go, first along X and then along Y.
+     * A blocked axis stops at the obstacle while the other one keeps moving, so the body slides along it.
+     * The whole path is checked, so a fast body can't jump over a thin collider.
+     * The collider stops PHYSICS_CONTACT_SKIN before the obstacle, a collider which touches the obstacle
+     * a bit is pushed back out.
+     * The sleeping bodies which stop the collider wake up.
+     *
+     * @param entity the moving entity
+     * @param rect the collider at the current position
+     * @param displacement the wanted movement
+     * @return the allowed movement
+     */
+    glm::vec2 sweep(entt::entity entity, FloatRect rect, glm::vec2 displacement);
+
+    void findWorldMap();
+
+    void addTileObstacles(FloatRect rect, glm::vec2 pathMin, glm::vec2 pathMax);
+
+    void onConstruct(entt::registry &registry, entt::entity entity);
+    void onDestroy(entt::registry &registry, entt::entity entity);
+    void onInstanceDestroy(entt::registry &registry, entt::entity entity);
+    void onBodyChange(entt::registry &registry, entt::entity entity);
 };
 
 #endif //RPG_PHYSICSSYSTEM_H
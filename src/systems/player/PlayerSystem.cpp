@@ -3,11 +3,12 @@
 
 #include "../../client/Engine.h"
 #include "../../components/player/PlayerComponent.h"
-#include "../../components/physics/RigidbodyComponent.h"
+#include "../../utils/Physics.h"
 #include "../../components/render/SpriteRendererComponent.h"
 #include "../../components/world/HpComponent.h"
 #include "../../components/world/InventoryComponent.h"
 #include "../../components/render/PointLightComponent.h"
+#include <glm/gtc/random.hpp>
 
 // TODO: refactor
 PlayerSystem::PlayerSystem(entt::registry &registry)
@@ -53,8 +54,7 @@ void PlayerSystem::update(float deltaTime)
 
         if (m_registry.all_of<PlayerComponent>(entity))
         {
-            auto &rigidbody = m_registry.get<RigidbodyComponent>(entity);
-            rigidbody.velocity = glm::vec2(movement) * player.speed * 200.f;
+            Physics::setVelocity({entity, &m_registry}, glm::vec2(movement) * player.speed * 200.f);
         }
 
         if (player.sprite && player.sprite.hasComponent<SpriteRendererComponent>())
@@ -123,13 +123,11 @@ void PlayerSystem::inventoryLogic(entt::entity entity)
 void PlayerSystem::torchLogic(entt::entity entity)
 {
     IWindow &window = Engine::getWindow();
-    auto& torch = m_registry.get<PointLightComponent>(entity);
-
     Key key = m_keyMappingConfig.getTorchKey();
 
     if (window.getKey(key) && !m_torchPressed)
     {
-        torch.enabled = !torch.enabled;
+        m_registry.patch<PointLightComponent>(entity, [](auto &torch) { torch.enabled = !torch.enabled; });
         m_torchPressed = true;
     }
     else if (!window.getKey(key))
@@ -198,11 +196,10 @@ void PlayerSystem::updateInput()
 
 void PlayerSystem::playAnimation(Entity sprite, glm::ivec2 movement, float deltaTime)
 {
-    auto &renderer = sprite.getComponent<SpriteRendererComponent>();
-
     if (m_animationDelay > 30.f)
     {
-        renderer.textureRect = IntRect(m_frame * 32, m_currentAnimation * 32, 32, 32);
+        sprite.patchComponent<SpriteRendererComponent>(
+            [&](auto &renderer) { renderer.textureRect = IntRect(m_frame * 32, m_currentAnimation * 32, 32, 32); });
         m_frame++;
         m_animationDelay = 0.f;
     }
@@ -227,6 +224,11 @@ void PlayerSystem::playSound(glm::ivec2 movement, AudioSourceComponent&audioSour
     }
     else
     {
+        // Every walk sounds a bit different
+        if (audioSourceComponent.state != AudioState::Play)
+        {
+            audioSourceComponent.pitch = glm::linearRand(0.9f, 1.1f);
+        }
         audioSourceComponent.play();
     }
 }
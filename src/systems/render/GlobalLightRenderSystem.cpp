@@ -3,10 +3,12 @@
 #include "GlobalLightRenderSystem.h"
 #include "../../components/world/ClockComponent.h"
 #include "../../utils/DayNightCycle.h"
+#include "../../client/Engine.h"
+#include "../../client/assets/AssetCache.h"
 
 GlobalLightRenderSystem::GlobalLightRenderSystem(entt::registry &registry)
     : m_registry(registry),
-      m_shader(Shader::createShader(TRUERPG_RES_DIR "/shaders/global_light.vs", TRUERPG_RES_DIR "/shaders/global_light.fs")),
+      m_shader(Engine::getAssetCache().loadShader(TRUERPG_RES_DIR "/shaders/global_light.vs", TRUERPG_RES_DIR "/shaders/global_light.fs")),
       m_quad()
 {
 }
@@ -23,16 +25,17 @@ void GlobalLightRenderSystem::draw()
 
     float brightness = DayNightCycle::computeSunBrightness(seconds);
 
-    m_shader.setUniform("brightness", brightness);
+    m_shader->setUniform("brightness", brightness);
     m_quad.draw();
 }
 
 Shader &GlobalLightRenderSystem::getShader()
 {
-    return m_shader;
+    return *m_shader;
 }
 
 void GlobalLightRenderSystem::destroy()
 {
     m_quad.destroy();
+    m_shader.reset();
 }
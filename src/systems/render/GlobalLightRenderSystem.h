@@ -3,12 +3,13 @@
 
 #include "ILightRenderSubsystem.h"
 #include "entt.hpp"
+#include <memory>
 #include "../../client/graphics/Quad.h"
 
 class GlobalLightRenderSystem : public ILightRenderSubsystem
 {
     entt::registry& m_registry;
-    Shader m_shader;
+    std::shared_ptr<Shader> m_shader;
     Quad m_quad;
 public:
     explicit GlobalLightRenderSystem(entt::registry& registry);
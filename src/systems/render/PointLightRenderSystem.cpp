@@ -2,19 +2,23 @@
 #include "PointLightRenderSystem.h"
 
 #include "../../components/render/PointLightComponent.h"
+#include "../../components/render/VisibleComponent.h"
 #include "../../utils/Hierarchy.h"
 #include "../../components/world/ClockComponent.h"
 #include "../../utils/DayNightCycle.h"
+#include "../../client/Engine.h"
+#include "../../client/assets/AssetCache.h"
 
 PointLightRenderSystem::PointLightRenderSystem(entt::registry &registry)
     : m_registry(registry),
-      m_shader(Shader::createShader(TRUERPG_RES_DIR "/shaders/point_light.vs", TRUERPG_RES_DIR "/shaders/point_light.fs")),
+      m_shader(Engine::getAssetCache().loadShader(TRUERPG_RES_DIR "/shaders/point_light.vs", TRUERPG_RES_DIR "/shaders/point_light.fs")),
       m_quad()
 { }
 
 void PointLightRenderSystem::draw()
 {
-    auto view = m_registry.view<PointLightComponent>();
+    // Every light is a quad over the whole screen, so only the ones the camera sees are drawn
+    auto view = m_registry.view<PointLightComponent, VisibleComponent>();
 
     for (auto entity : view)
     {
@@ -40,10 +44,10 @@ void PointLightRenderSystem::draw()
             intensity *= (1 - sunBrightness);
         }
 
-        m_shader.setUniform("light.pos", transformComponent.position);
-        m_shader.setUniform("light.color", pointLightComponent.color);
-        m_shader.setUniform("light.radius", pointLightComponent.radius);
-        m_shader.setUniform("light.intensity", intensity);
+        m_shader->setUniform("light.pos", transformComponent.position);
+        m_shader->setUniform("light.color", pointLightComponent.color);
+        m_shader->setUniform("light.radius", pointLightComponent.radius);
+        m_shader->setUniform("light.intensity", intensity);
 
         m_quad.draw();
     }
@@ -51,10 +55,11 @@ void PointLightRenderSystem::draw()
 
 Shader& PointLightRenderSystem::getShader()
 {
-    return m_shader;
+    return *m_shader;
 }
 
 void PointLightRenderSystem::destroy()
 {
     m_quad.destroy();
+    m_shader.reset();
 }
@@ -3,6 +3,7 @@
 
 #include "IRenderSubsystem.h"
 #include "entt.hpp"
+#include <memory>
 #include "ILightRenderSubsystem.h"
 
 #include "../../client/graphics/Quad.h"
@@ -10,7 +11,7 @@
 class PointLightRenderSystem : public ILightRenderSubsystem
 {
     entt::registry& m_registry;
-    Shader m_shader;
+    std::shared_ptr<Shader> m_shader;
     Quad m_quad;
 public:
     explicit PointLightRenderSystem(entt::registry& registry);
@@ -7,16 +7,21 @@
 #include "../../utils/Hierarchy.h"
 #include "../../components/world/WorldMapComponent.h"
 #include "../../client/Engine.h"
+#include "../../client/assets/AssetCache.h"
+#include "../../client/graphics/SpriteAnimationTable.h"
 
 RenderSystem::RenderSystem(entt::registry &registry)
         : m_registry(registry),
-          m_shader(Shader::createShader(TRUERPG_RES_DIR "/shaders/g_buffer.vs", TRUERPG_RES_DIR "/shaders/g_buffer.fs")),
-          m_uiShader(Shader::createShader(TRUERPG_RES_DIR "/shaders/ui.vs", TRUERPG_RES_DIR "/shaders/ui.fs")),
-          m_batch(m_shader, 30000)
+          m_shader(Engine::getAssetCache().loadShader(TRUERPG_RES_DIR "/shaders/g_buffer.vs", TRUERPG_RES_DIR "/shaders/g_buffer.fs")),
+          m_uiShader(Engine::getAssetCache().loadShader(TRUERPG_RES_DIR "/shaders/ui.vs", TRUERPG_RES_DIR "/shaders/ui.fs")),
+          m_batch(*m_shader, 30000, 10000),
+          m_visibility(registry)
 {
     auto& window = Engine::getWindow();
     window.getOnResize() += createEventHandler(*this, &RenderSystem::resize);
     createGBuffer(window.getWidth(), window.getHeight());
+
+    m_batch.setAnimationTable(&Engine::getSpriteAnimationTable());
 }
 
 RenderSystem::~RenderSystem()
@@ -35,26 +40,49 @@ RenderSystem::~RenderSystem()
     }
 }
 
+void RenderSystem::setTextureArrayMode(bool enabled)
+{
+    if (enabled)
+    {
+        m_arrayShader = Engine::getAssetCache().loadShader(TRUERPG_RES_DIR "/shaders/g_buffer.vs", TRUERPG_RES_DIR "/shaders/g_buffer_array.fs");
+    }
+    else
+    {
+        m_arrayShader.reset();
+    }
+}
+
 void RenderSystem::draw()
 {
     // Find the first camera
     auto cameraView = m_registry.view<CameraComponent>();
     if (cameraView.empty()) return;
-    auto cameraComponent = m_registry.get<CameraComponent>(cameraView[0]);
+    auto &cameraComponent = m_registry.get<CameraComponent>(cameraView[0]);
     TransformComponent cameraTransform = Hierarchy::computeTransform({cameraView[0], &m_registry});
 
+    // Mark what the camera sees, the subsystems draw only that
+    glm::vec2 cameraHalfSize(cameraComponent.getWidth() / 2, cameraComponent.getHeight() / 2);
+    m_visibility.update(cameraTransform.position - cameraHalfSize, cameraTransform.position + cameraHalfSize);
+    cameraComponent.visibleCount = m_visibility.getVisibleCount();
+    cameraComponent.culledCount = m_visibility.getCulledCount();
+
     // Geometry pass: render scene's geometry/color data into g-buffer
     glBindFramebuffer(GL_FRAMEBUFFER, m_gBuffer.id);
 
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glClearColor(0.f, 0.f, 0.f, 1.f);
-    glClear(GL_COLOR_BUFFER_BIT);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    // The sprites are drawn in order anyway, the depth is needed only for the static ones
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+
+    // The shader must be set first, the matrices are uniforms of the current shader
     glm::mat4 viewMatrix = glm::translate(glm::mat4(1), glm::vec3(-cameraTransform.position, 0));
+    m_batch.setShader(m_arrayShader ? *m_arrayShader : *m_shader);
     m_batch.setViewMatrix(viewMatrix);
     m_batch.setProjectionMatrix(cameraComponent.getProjectionMatrix());
-    m_batch.setShader(m_shader);
     m_batch.begin();
 
     for (auto &system : m_subsystems)
@@ -62,7 +90,8 @@ void RenderSystem::draw()
         system->draw(m_batch);
     }
 
-    m_batch.end();
+    m_batch.end(true);
+    glDisable(GL_DEPTH_TEST);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     // Lighting pass: calculate lighting by iterating over a screen filled quad pixel-by-pixel using the g-buffer's content
@@ -70,25 +99,27 @@ void RenderSystem::draw()
     glClear(GL_COLOR_BUFFER_BIT);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE);
 
+    glm::mat4 invViewProjection = glm::inverse(cameraComponent.getProjectionMatrix() * viewMatrix);
+    glm::vec2 screenSize(m_gBuffer.width, m_gBuffer.height);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_gBuffer.gAlbedoSpec);
+
     for (auto &system : m_lightSubsystems)
     {
         Shader lightShader = system->getShader();
         lightShader.use();
-        lightShader.setUniform("gPosition", 0);
-        lightShader.setUniform("gAlbedoSpec", 1);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, m_gBuffer.gPosition);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, m_gBuffer.gAlbedoSpec);
+        lightShader.setUniform("gAlbedoSpec", 0);
+        lightShader.setUniform("invViewProjection", invViewProjection);
+        lightShader.setUniform("screenSize", screenSize);
 
         system->draw();
     }
 
     // UI pass
+    m_batch.setShader(*m_uiShader);
     m_batch.setViewMatrix(viewMatrix);
     m_batch.setProjectionMatrix(cameraComponent.getProjectionMatrix());
-    m_batch.setShader(m_uiShader);
     m_batch.begin();
 
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -132,9 +163,12 @@ void RenderSystem::destroy()
     {
         system->destroy();
     }
+    m_visibility.destroy();
     m_batch.destroy();
-    m_shader.destroy();
-    m_uiShader.destroy();
+    destroyGBuffer();
+    m_shader.reset();
+    m_arrayShader.reset();
+    m_uiShader.reset();
 }
 
 // Every time when the window size is changed (by user or OS), this callback function is invoked
@@ -147,31 +181,45 @@ void RenderSystem::resize(int width, int height)
 void RenderSystem::createGBuffer(int width, int height)
 {
     // TODO: create a separate class for g-buffer
+    // The old buffer has the wrong size now
+    destroyGBuffer();
+
     // Create g-buffer
     glGenFramebuffers(1, &m_gBuffer.id);
     glBindFramebuffer(GL_FRAMEBUFFER, m_gBuffer.id);
-
-    // position color buffer
-    glGenTextures(1, &m_gBuffer.gPosition);
-    glBindTexture(GL_TEXTURE_2D, m_gBuffer.gPosition);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, width, height, 0, GL_RG, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_gBuffer.gPosition, 0);
+    m_gBuffer.width = width;
+    m_gBuffer.height = height;
 
     // color + specular color buffer
     glGenTextures(1, &m_gBuffer.gAlbedoSpec);
     glBindTexture(GL_TEXTURE_2D, m_gBuffer.gAlbedoSpec);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_gBuffer.gAlbedoSpec, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_gBuffer.gAlbedoSpec, 0);
 
-    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-    glDrawBuffers(2, attachments);
+    // depth buffer, it's never sampled
+    glGenRenderbuffers(1, &m_gBuffer.depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_gBuffer.depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_gBuffer.depth);
+
+    unsigned int attachments[1] = { GL_COLOR_ATTACHMENT0 };
+    glDrawBuffers(1, attachments);
 
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
         printf("Framebuffer not complete!");
     }
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
+
+void RenderSystem::destroyGBuffer()
+{
+    if (m_gBuffer.id)
+    {
+        glDeleteFramebuffers(1, &m_gBuffer.id);
+        glDeleteTextures(1, &m_gBuffer.gAlbedoSpec);
+        glDeleteRenderbuffers(1, &m_gBuffer.depth);
+    }
+    m_gBuffer = GBuffer();
+}
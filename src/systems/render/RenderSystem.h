@@ -2,30 +2,41 @@
 #define RPG_RENDERSYSTEM_H
 
 #include "entt.hpp"
+#include <memory>
 #include "../../client/graphics/SpriteBatch.h"
 #include "../../components/basic/TransformComponent.h"
 #include "IRenderSubsystem.h"
 #include "../../scene/ISystem.h"
 #include "../../utils/Types.h"
 #include "ILightRenderSubsystem.h"
+#include "VisibilitySystem.h"
 
 struct GBuffer
 {
-    unsigned int id;
+    unsigned int id{};
 
-    unsigned int gPosition;
-    unsigned int gAlbedoSpec;
+    // The world position isn't stored, the light shaders reconstruct it from gl_FragCoord
+    unsigned int gAlbedoSpec{};
+
+    // Puts the static sprites in the right order with the others
+    unsigned int depth{};
+
+    int width{};
+    int height{};
 };
 
 class RenderSystem : public ISystem
 {
     entt::registry &m_registry;
-    Shader m_shader;
-    Shader m_uiShader;
+    std::shared_ptr<Shader> m_shader;
+    std::shared_ptr<Shader> m_arrayShader; // used instead of m_shader when the sprites come from a texture array
+    std::shared_ptr<Shader> m_uiShader;
     SpriteBatch m_batch;
 
     GBuffer m_gBuffer;
 
+    VisibilitySystem m_visibility;
+
     std::vector<IRenderSubsystem *> m_subsystems;
     std::vector<ILightRenderSubsystem *> m_lightSubsystems;
     std::vector<IRenderSubsystem *> m_uiSubsystems;
@@ -56,6 +67,15 @@ public:
         return (T &)*m_uiSubsystems.back();
     }
 
+    /**
+     * Sample the geometry pass textures from one array texture instead of 16 separate slots.
+     * In this mode every textured sprite in the world must come from the same TextureArray.
+     * The UI pass isn't affected.
+     *
+     * @param enabled true to enable the mode
+     */
+    void setTextureArrayMode(bool enabled);
+
     void draw();
 
     void update(float deltaTime) override;
@@ -66,6 +86,8 @@ public:
 
 private:
     void createGBuffer(int width, int height);
+
+    void destroyGBuffer();
 };
 
 #endif // RPG_RENDERSYSTEM_H
@@ -2,37 +2,129 @@
 #include "SpriteRenderSystem.h"
 
 #include "../../components/render/SpriteRendererComponent.h"
+#include "../../components/render/StaticSpriteComponent.h"
+#include "../../components/render/StaticSpriteInstanceComponent.h"
+#include "../../components/render/VisibleComponent.h"
 #include "../../utils/Hierarchy.h"
 #include "../../components/render/AutoOrderComponent.h"
 
 SpriteRenderSystem::SpriteRenderSystem(entt::registry &registry)
-    : m_registry(registry)
+    : m_registry(registry),
+      m_staticObserver(registry, entt::collector.update<TransformComponent>()
+                                     .update<SpriteRendererComponent>()
+                                     .where<StaticSpriteInstanceComponent>())
 {
+    // A sprite stops being static when it loses any of these
+    m_registry.on_destroy<StaticSpriteComponent>().connect<&SpriteRenderSystem::onStaticDestroy>(this);
+    m_registry.on_destroy<SpriteRendererComponent>().connect<&SpriteRenderSystem::onStaticDestroy>(this);
+    m_registry.on_destroy<StaticSpriteInstanceComponent>().connect<&SpriteRenderSystem::onInstanceDestroy>(this);
+}
+
+SpriteRenderSystem::~SpriteRenderSystem()
+{
+    m_registry.on_destroy<StaticSpriteComponent>().disconnect<&SpriteRenderSystem::onStaticDestroy>(this);
+    m_registry.on_destroy<SpriteRendererComponent>().disconnect<&SpriteRenderSystem::onStaticDestroy>(this);
+    m_registry.on_destroy<StaticSpriteInstanceComponent>().disconnect<&SpriteRenderSystem::onInstanceDestroy>(this);
 }
 
 void SpriteRenderSystem::draw(SpriteBatch &batch)
 {
-    auto view = m_registry.view<SpriteRendererComponent>();
-    for (auto entity : view)
+    // Free the slots first, so the new static sprites can take them
+    for (int slot : m_releasedSlots)
     {
-        auto &spriteComponent = view.get<SpriteRendererComponent>(entity);
-        Sprite sprite(spriteComponent.texture);
-        sprite.setTextureRect(spriteComponent.textureRect);
-        sprite.setColor(spriteComponent.color);
-
-        auto transformComponent = Hierarchy::computeTransform({entity, &m_registry});
+        batch.removeStatic(slot);
+    }
+    m_releasedSlots.clear();
 
-        sprite.setPosition(transformComponent.position);
-        sprite.setOrigin(transformComponent.origin);
-        sprite.setScale(transformComponent.scale);
+    // Only the changes of the static sprites are written
+    for (auto entity : m_staticObserver)
+    {
+        updateStatic(batch, entity);
+        Hierarchy::forEachDescendant({entity, &m_registry}, [&](Entity child) { updateStatic(batch, child); });
+    }
+    m_staticObserver.clear();
 
-        int order = spriteComponent.order;
-        if (m_registry.all_of<AutoOrderComponent>(entity))
+    auto newStaticView = m_registry.view<SpriteRendererComponent, StaticSpriteComponent>(
+        entt::exclude<StaticSpriteInstanceComponent>);
+    for (auto entity : newStaticView)
+    {
+        int layer;
+        int order;
+        Sprite sprite = createSprite(entity, layer, order);
+        int slot = batch.addStatic(sprite, layer, order);
+        if (slot < 0)
         {
-            auto &orderComponent = m_registry.get<AutoOrderComponent>(entity);
-            order = -(int) transformComponent.position.y - orderComponent.orderPivot;
+            // It's drawn as a usual sprite then
+            std::cout << "The sprite can't be static, only the sprites from a texture array can" << std::endl;
+            m_registry.remove<StaticSpriteComponent>(entity);
+            continue;
         }
+        m_registry.emplace<StaticSpriteInstanceComponent>(entity, slot);
+    }
 
-        batch.draw(sprite, spriteComponent.layer, order);
+    auto view = m_registry.view<SpriteRendererComponent, VisibleComponent>(entt::exclude<StaticSpriteInstanceComponent>);
+    for (auto entity : view)
+    {
+        int layer;
+        int order;
+        Sprite sprite = createSprite(entity, layer, order);
+        batch.draw(sprite, layer, order);
     }
 }
+
+void SpriteRenderSystem::destroy()
+{
+    // The batch is destroyed together with its static buffer, so the slots are just forgotten
+    m_registry.on_destroy<StaticSpriteInstanceComponent>().disconnect<&SpriteRenderSystem::onInstanceDestroy>(this);
+    m_registry.clear<StaticSpriteInstanceComponent>();
+    m_registry.on_destroy<StaticSpriteInstanceComponent>().connect<&SpriteRenderSystem::onInstanceDestroy>(this);
+
+    m_releasedSlots.clear();
+    m_staticObserver.clear();
+}
+
+void SpriteRenderSystem::updateStatic(SpriteBatch &batch, entt::entity entity)
+{
+    auto *instance = m_registry.try_get<StaticSpriteInstanceComponent>(entity);
+    if (!instance) return;
+
+    int layer;
+    int order;
+    Sprite sprite = createSprite(entity, layer, order);
+    batch.updateStatic(instance->slot, sprite, layer, order);
+}
+
+Sprite SpriteRenderSystem::createSprite(entt::entity entity, int &layer, int &order)
+{
+    auto &spriteComponent = m_registry.get<SpriteRendererComponent>(entity);
+    Sprite sprite(spriteComponent.texture);
+    sprite.setTextureRect(spriteComponent.textureRect);
+    sprite.setColor(spriteComponent.color);
+    sprite.setAnimation(spriteComponent.animation, spriteComponent.animationStart);
+
+    auto transformComponent = Hierarchy::computeTransform({entity, &m_registry});
+
+    sprite.setPosition(transformComponent.position);
+    sprite.setOrigin(transformComponent.origin);
+    sprite.setScale(transformComponent.scale);
+
+    layer = spriteComponent.layer;
+    order = spriteComponent.order;
+    if (m_registry.all_of<AutoOrderComponent>(entity))
+    {
+        auto &orderComponent = m_registry.get<AutoOrderComponent>(entity);
+        order = -(int) transformComponent.position.y - orderComponent.orderPivot;
+    }
+
+    return sprite;
+}
+
+void SpriteRenderSystem::onStaticDestroy(entt::registry &registry, entt::entity entity)
+{
+    registry.remove<StaticSpriteInstanceComponent>(entity);
+}
+
+void SpriteRenderSystem::onInstanceDestroy(entt::registry &registry, entt::entity entity)
+{
+    m_releasedSlots.push_back(registry.get<StaticSpriteInstanceComponent>(entity).slot);
+}
@@ -9,10 +9,28 @@ class SpriteRenderSystem : public IRenderSubsystem
 {
     entt::registry& m_registry;
 
+    // The static sprites whose renderer was patched and all moved entities, a static sprite moves with its parents
+    entt::observer m_staticObserver;
+
+    // The slots of the removed static sprites, they are freed in the next draw
+    std::vector<int> m_releasedSlots;
+
 public:
     SpriteRenderSystem(entt::registry& registry);
 
+    ~SpriteRenderSystem() override;
+
     void draw(SpriteBatch& batch) override;
+
+    void destroy() override;
+
+private:
+    Sprite createSprite(entt::entity entity, int &layer, int &order);
+
+    void updateStatic(SpriteBatch &batch, entt::entity entity);
+
+    void onStaticDestroy(entt::registry &registry, entt::entity entity);
+    void onInstanceDestroy(entt::registry &registry, entt::entity entity);
 };
 
 #endif // RPG_SPRITERENDERSYSTEM_H
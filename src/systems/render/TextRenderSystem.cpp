@@ -2,6 +2,7 @@
 #include "TextRenderSystem.h"
 
 #include "../../components/render/TextRendererComponent.h"
+#include "../../components/render/VisibleComponent.h"
 #include "../../client/graphics/Text.h"
 #include "../../utils/Hierarchy.h"
 
@@ -12,37 +13,44 @@ TextRenderSystem::TextRenderSystem(entt::registry &registry)
 
 void TextRenderSystem::draw(SpriteBatch &batch)
 {
-    auto view = m_registry.view<TextRendererComponent>();
+    // Only the texts the camera sees are drawn
+    auto view = m_registry.view<TextRendererComponent, VisibleComponent>();
     for (auto entity : view)
     {
         auto &textComponent = view.get<TextRendererComponent>(entity);
-        Text text(*textComponent.font, textComponent.text);
-        text.setColor(textComponent.color);
-
         auto transformComponent = Hierarchy::computeTransform({entity, &m_registry});
 
-        text.setPosition(transformComponent.position);
-        FloatRect localBound = text.getLocalBounds();
-        glm::vec2 textOrigin = transformComponent.origin;
-        if (textComponent.horizontalAlign == HorizontalAlign::Center)
-        {
-            textOrigin += glm::vec2(localBound.getWidth() / 2, 0.f);
-        }
-        if (textComponent.horizontalAlign == HorizontalAlign::Right)
-        {
-            textOrigin += glm::vec2(localBound.getWidth(), 0.f);
-        }
-        if (textComponent.verticalAlign == VerticalAlign::Center)
-        {
-            textOrigin += glm::vec2(0.f, localBound.getHeight() / 2);
-        }
-        if (textComponent.verticalAlign == VerticalAlign::Top)
-        {
-            textOrigin += glm::vec2(0.f, localBound.getHeight());
-        }
-        text.setOrigin(textOrigin);
-        text.setScale(transformComponent.scale);
-
+        Text text = createText(textComponent, transformComponent);
         text.draw(batch, textComponent.layer, textComponent.order);
     }
 }
+
+Text TextRenderSystem::createText(const TextRendererComponent &textComponent, const TransformComponent &transformComponent)
+{
+    Text text(*textComponent.font, textComponent.text);
+    text.setColor(textComponent.color);
+
+    text.setPosition(transformComponent.position);
+    FloatRect localBound = text.getLocalBounds();
+    glm::vec2 textOrigin = transformComponent.origin;
+    if (textComponent.horizontalAlign == HorizontalAlign::Center)
+    {
+        textOrigin += glm::vec2(localBound.getWidth() / 2, 0.f);
+    }
+    if (textComponent.horizontalAlign == HorizontalAlign::Right)
+    {
+        textOrigin += glm::vec2(localBound.getWidth(), 0.f);
+    }
+    if (textComponent.verticalAlign == VerticalAlign::Center)
+    {
+        textOrigin += glm::vec2(0.f, localBound.getHeight() / 2);
+    }
+    if (textComponent.verticalAlign == VerticalAlign::Top)
+    {
+        textOrigin += glm::vec2(0.f, localBound.getHeight());
+    }
+    text.setOrigin(textOrigin);
+    text.setScale(transformComponent.scale);
+
+    return text;
+}
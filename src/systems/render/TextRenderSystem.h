@@ -3,6 +3,9 @@
 
 #include "entt.hpp"
 #include "../../client/graphics/SpriteBatch.h"
+#include "../../client/graphics/Text.h"
+#include "../../components/basic/TransformComponent.h"
+#include "../../components/render/TextRendererComponent.h"
 #include "IRenderSubsystem.h"
 
 class TextRenderSystem : public IRenderSubsystem
@@ -13,6 +16,15 @@ public:
     TextRenderSystem(entt::registry& registry);
 
     void draw(SpriteBatch& batch) override;
+
+    /**
+     * Lay out the text of the component at its place in the world.
+     *
+     * @param textComponent the text renderer
+     * @param transformComponent the world transform of the entity
+     * @return the text ready to be drawn
+     */
+    static Text createText(const TextRendererComponent &textComponent, const TransformComponent &transformComponent);
 };
 
 #endif // RPG_TEXTRENDERSYSTEM_H
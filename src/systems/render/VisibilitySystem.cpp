@@ -0,0 +1,199 @@
+#include "../../pch.h"
+#include "VisibilitySystem.h"
+
+#include "TextRenderSystem.h"
+#include "../../components/render/PointLightComponent.h"
+#include "../../components/render/RenderBoundsComponent.h"
+#include "../../components/render/SpriteRendererComponent.h"
+#include "../../components/render/StaticSpriteInstanceComponent.h"
+#include "../../components/render/TextRendererComponent.h"
+#include "../../components/render/VisibleComponent.h"
+#include "../../utils/Hierarchy.h"
+
+VisibilitySystem::VisibilitySystem(entt::registry &registry)
+        : m_registry(registry),
+          m_transformObserver(registry, entt::collector.update<TransformComponent>()),
+          m_rendererObserver(registry, entt::collector.group<SpriteRendererComponent>()
+                                           .update<SpriteRendererComponent>()
+                                           .group<TextRendererComponent>()
+                                           .update<TextRendererComponent>()
+                                           .group<PointLightComponent>()
+                                           .update<PointLightComponent>()
+                                           .group<StaticSpriteInstanceComponent>())
+{
+    m_registry.on_destroy<SpriteRendererComponent>().connect<&VisibilitySystem::onRenderableDestroy>(this);
+    m_registry.on_destroy<TextRendererComponent>().connect<&VisibilitySystem::onRenderableDestroy>(this);
+    m_registry.on_destroy<PointLightComponent>().connect<&VisibilitySystem::onRenderableDestroy>(this);
+    m_registry.on_destroy<StaticSpriteInstanceComponent>().connect<&VisibilitySystem::onRenderableDestroy>(this);
+    m_registry.on_destroy<RenderBoundsComponent>().connect<&VisibilitySystem::onBoundsDestroy>(this);
+}
+
+VisibilitySystem::~VisibilitySystem()
+{
+    m_registry.on_destroy<SpriteRendererComponent>().disconnect<&VisibilitySystem::onRenderableDestroy>(this);
+    m_registry.on_destroy<TextRendererComponent>().disconnect<&VisibilitySystem::onRenderableDestroy>(this);
+    m_registry.on_destroy<PointLightComponent>().disconnect<&VisibilitySystem::onRenderableDestroy>(this);
+    m_registry.on_destroy<StaticSpriteInstanceComponent>().disconnect<&VisibilitySystem::onRenderableDestroy>(this);
+    m_registry.on_destroy<RenderBoundsComponent>().disconnect<&VisibilitySystem::onBoundsDestroy>(this);
+}
+
+void VisibilitySystem::update(glm::vec2 viewMin, glm::vec2 viewMax)
+{
+    m_frame++;
+
+    // Only the entities which moved or changed what they render are measured again
+    for (auto entity : m_transformObserver)
+    {
+        updateBounds(entity);
+        Hierarchy::forEachDescendant({entity, &m_registry}, [&](Entity child) { updateBounds(child); });
+    }
+    m_transformObserver.clear();
+
+    for (auto entity : m_rendererObserver)
+    {
+        updateBounds(entity);
+    }
+    m_rendererObserver.clear();
+
+    // The component is still there in its destroy signal, so the entity is measured now
+    for (auto entity : m_removed)
+    {
+        if (m_registry.valid(entity))
+        {
+            updateBounds(entity);
+        }
+    }
+    m_removed.clear();
+
+    // The tree keeps the fattened boxes, so the bounds still have to be checked
+    m_visibleNow.clear();
+    m_tree.query(viewMin, viewMax, [&](entt::entity entity)
+    {
+        auto &boundsComponent = m_registry.get<RenderBoundsComponent>(entity);
+        if (boundsComponent.max.x < viewMin.x || boundsComponent.min.x > viewMax.x ||
+            boundsComponent.max.y < viewMin.y || boundsComponent.min.y > viewMax.y)
+        {
+            return;
+        }
+
+        m_registry.get_or_emplace<VisibleComponent>(entity).frame = m_frame;
+        m_visibleNow.push_back(entity);
+    });
+
+    // The entities which have left the camera since the last frame are hidden
+    for (auto entity : m_visible)
+    {
+        if (!m_registry.valid(entity)) continue;
+
+        auto *visibleComponent = m_registry.try_get<VisibleComponent>(entity);
+        if (visibleComponent && visibleComponent->frame != m_frame)
+        {
+            m_registry.remove<VisibleComponent>(entity);
+        }
+    }
+    std::swap(m_visible, m_visibleNow);
+
+    m_visibleCount = (u32) m_visible.size();
+    m_culledCount = m_tree.size() - m_visibleCount;
+}
+
+u32 VisibilitySystem::getVisibleCount() const
+{
+    return m_visibleCount;
+}
+
+u32 VisibilitySystem::getCulledCount() const
+{
+    return m_culledCount;
+}
+
+void VisibilitySystem::destroy()
+{
+    m_registry.clear<VisibleComponent>();
+    m_registry.clear<RenderBoundsComponent>();
+    m_tree.clear();
+    m_visible.clear();
+    m_visibleNow.clear();
+    m_transformObserver.clear();
+    m_rendererObserver.clear();
+    m_removed.clear();
+}
+
+void VisibilitySystem::updateBounds(entt::entity entity)
+{
+    auto *spriteComponent = m_registry.try_get<SpriteRendererComponent>(entity);
+    auto *textComponent = m_registry.try_get<TextRendererComponent>(entity);
+    auto *pointLightComponent = m_registry.try_get<PointLightComponent>(entity);
+
+    if (spriteComponent && m_registry.all_of<StaticSpriteInstanceComponent>(entity))
+    {
+        spriteComponent = nullptr;
+    }
+    if (pointLightComponent && !pointLightComponent->enabled)
+    {
+        pointLightComponent = nullptr;
+    }
+
+    if (!spriteComponent && !textComponent && !pointLightComponent)
+    {
+        m_registry.remove<RenderBoundsComponent>(entity);
+        return;
+    }
+
+    // Measure everything that is drawn, an entity can have a sprite, a text and a light at once
+    auto transformComponent = Hierarchy::computeTransform({entity, &m_registry});
+    glm::vec2 min(std::numeric_limits<float>::max());
+    glm::vec2 max(std::numeric_limits<float>::lowest());
+    auto extend = [&](glm::vec2 corner, glm::vec2 size)
+    {
+        min = glm::min(min, glm::min(corner, corner + size));
+        max = glm::max(max, glm::max(corner, corner + size));
+    };
+
+    if (spriteComponent)
+    {
+        // The same quad as SpriteBatch makes, the scale can be negative
+        glm::vec2 corner = transformComponent.position - transformComponent.origin * transformComponent.scale;
+        glm::vec2 size = glm::vec2(std::abs(spriteComponent->textureRect.getWidth()),
+                                   std::abs(spriteComponent->textureRect.getHeight())) * transformComponent.scale;
+        extend(corner, size);
+    }
+
+    if (textComponent)
+    {
+        FloatRect bounds = TextRenderSystem::createText(*textComponent, transformComponent).getGlobalBounds();
+        extend(glm::vec2(bounds.getLeft(), bounds.getBottom()), glm::vec2(bounds.getWidth(), bounds.getHeight()));
+    }
+
+    if (pointLightComponent)
+    {
+        extend(transformComponent.position - pointLightComponent->radius, glm::vec2(pointLightComponent->radius * 2.f));
+    }
+
+    // Moving the bounds costs nothing until the entity leaves its fattened box
+    auto &boundsComponent = m_registry.get_or_emplace<RenderBoundsComponent>(entity);
+    boundsComponent.min = min;
+    boundsComponent.max = max;
+    if (boundsComponent.proxy == AABB_TREE_NULL)
+    {
+        boundsComponent.proxy = m_tree.insert(entity, min, max);
+    }
+    else
+    {
+        m_tree.move(boundsComponent.proxy, min, max);
+    }
+}
+
+void VisibilitySystem::onRenderableDestroy(entt::registry &registry, entt::entity entity)
+{
+    m_removed.push_back(entity);
+}
+
+void VisibilitySystem::onBoundsDestroy(entt::registry &registry, entt::entity entity)
+{
+    auto &boundsComponent = registry.get<RenderBoundsComponent>(entity);
+    if (boundsComponent.proxy != AABB_TREE_NULL)
+    {
+        m_tree.remove(boundsComponent.proxy);
+    }
+}
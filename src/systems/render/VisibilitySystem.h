@@ -0,0 +1,81 @@
+#ifndef RPG_VISIBILITYSYSTEM_H
+#define RPG_VISIBILITYSYSTEM_H
+
+#include "entt.hpp"
+#include <vector>
+#include "../../utils/DynamicAabbTree.h"
+#include "../../utils/Types.h"
+
+// How far a renderable can move before it's reinserted into the tree
+#define VISIBILITY_TREE_MARGIN 32.f
+
+/**
+ * Finds the sprites, the texts and the point lights that the camera sees and marks them with VisibleComponent,
+ * so the render systems skip the rest.
+ *
+ * The world bounds of a renderable are measured when it moves or changes what it renders and kept in
+ * a dynamic AABB tree, so a frame only costs the query of the camera rectangle.
+ * The changes must be done through registry.patch(), so they are noticed.
+ * The static sprites aren't tested, they are drawn from their own buffer anyway.
+ */
+class VisibilitySystem
+{
+    entt::registry &m_registry;
+
+    DynamicAabbTree<entt::entity> m_tree{VISIBILITY_TREE_MARGIN};
+
+    // The moved entities, their children move with them
+    entt::observer m_transformObserver;
+
+    // The entities whose sprite, text or light was added or changed
+    entt::observer m_rendererObserver;
+
+    // The entities which lost one of their renderables
+    std::vector<entt::entity> m_removed;
+
+    // The entities which were visible in the last frame
+    std::vector<entt::entity> m_visible;
+    std::vector<entt::entity> m_visibleNow;
+
+    u32 m_frame{};
+    u32 m_visibleCount{};
+    u32 m_culledCount{};
+
+public:
+    explicit VisibilitySystem(entt::registry &registry);
+
+    ~VisibilitySystem();
+
+    /**
+     * Find the renderables in the camera rectangle.
+     *
+     * @param viewMin the minimal corner of the camera rectangle in the world
+     * @param viewMax the maximal corner of the camera rectangle in the world
+     */
+    void update(glm::vec2 viewMin, glm::vec2 viewMax);
+
+    /**
+     * Get the number of the renderables which were seen in the last update.
+     *
+     * @return the number of the visible entities
+     */
+    u32 getVisibleCount() const;
+
+    /**
+     * Get the number of the renderables which were skipped in the last update.
+     *
+     * @return the number of the culled entities
+     */
+    u32 getCulledCount() const;
+
+    void destroy();
+
+private:
+    void updateBounds(entt::entity entity);
+
+    void onRenderableDestroy(entt::registry &registry, entt::entity entity);
+
+    void onBoundsDestroy(entt::registry &registry, entt::entity entity);
+};
+
+#endif // RPG_VISIBILITYSYSTEM_H
@@ -20,6 +20,8 @@ public:
     virtual void draw(SpriteBatch& batch, glm::vec2 cursor) = 0;
 
     virtual void update(float deltaTime) {};
+
+    virtual void destroy() {};
 };
 
 #endif // RPG_IUIRENDERSUBSYSTEM_H
@@ -7,10 +7,12 @@
 #include "../../../components/world/ItemComponent.h"
 #include "../../../client/graphics/Text.h"
 #include "../../../client/Engine.h"
+#include "../../../client/assets/AssetCache.h"
 #include "GLFW/glfw3.h"
 
 InventoryRenderSystem::InventoryRenderSystem(entt::registry& registry)
-    : m_registry(registry)
+    : m_registry(registry),
+      m_font(Engine::getAssetCache().loadFont(TRUERPG_RES_DIR "/fonts/vt323.ttf", 32))
 {
 }
 
@@ -167,7 +169,7 @@ void InventoryRenderSystem::draw(SpriteBatch &batch, glm::vec2 cursor)
         {
             auto &itemComponent = m_selectedEntity.getComponent<ItemComponent>();
 
-            Text text(font, itemComponent.name + "\n" + normalizeText(itemComponent.description, 40));
+            Text text(*m_font, itemComponent.name + "\n" + normalizeText(itemComponent.description, 40));
             FloatRect localBounds = text.getLocalBounds();
             text.setPosition(cursor + glm::vec2(24, -localBounds.getHeight() - 24));
 
@@ -200,3 +202,8 @@ void InventoryRenderSystem::update(float deltaTime)
         m_descriptionTimer = 0;
     }
 }
+
+void InventoryRenderSystem::destroy()
+{
+    m_font.reset();
+}
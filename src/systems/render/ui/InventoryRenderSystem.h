@@ -3,6 +3,7 @@
 
 #include "IUIRenderSubsystem.h"
 #include "entt.hpp"
+#include <memory>
 #include "../../../scene/Entity.h"
 #include "../../../client/graphics/Font.h"
 
@@ -18,7 +19,7 @@ class InventoryRenderSystem : public IUIRenderSubsystem
     glm::ivec2 m_itemLastPos;
     glm::vec2 m_itemDelta;
 
-    Font font{TRUERPG_RES_DIR "/fonts/vt323.ttf", 32};
+    std::shared_ptr<Font> m_font;
 
     glm::vec2 prevCursor{};
     float m_descriptionTimer{DESCRIPTION_TIMER};
@@ -29,6 +30,8 @@ public:
     void draw(SpriteBatch& batch, glm::vec2 cursor) override;
 
     void update(float deltaTime) override;
+
+    void destroy() override;
 };
 
 #endif // RPG_INVENTORYRENDERSYSTEM_H
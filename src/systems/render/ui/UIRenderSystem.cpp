@@ -39,3 +39,11 @@ void UIRenderSystem::update(float deltaTime)
         system->update(deltaTime);
     }
 }
+
+void UIRenderSystem::destroy()
+{
+    for (auto &system : m_subsystems)
+    {
+        system->destroy();
+    }
+}
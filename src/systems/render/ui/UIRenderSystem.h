@@ -27,6 +27,8 @@ public:
     void draw(SpriteBatch& batch) override;
 
     void update(float deltaTime) override;
+
+    void destroy() override;
 };
 
 #endif // RPG_UIRENDERSYSTEM_H
@@ -1,209 +1,383 @@
 #include "../pch.h"
 #include "Animation.h"
 
+#include <algorithm>
+#include <filesystem>
+#include "Hash.h"
+#include "MappedFile.h"
+#include "../client/animation/AnimatorContainer.h"
+
 namespace
 {
-using ValueType = std::variant<bool, float, glm::vec2>;
+using ParameterOffsets = std::map<std::string, u16>;
 
-struct Expression
+// Compiles an expression into the code, every expression leaves exactly one value on the stack
+void compileExpression(const ParameterOffsets &parameters, std::string_view type, const YAML::Node &node,
+                       SpriteAnimatorCondition &condition)
 {
-    virtual ValueType evaluate(const SpriteAnimatorParameterStorage &storage) = 0;
-    virtual ~Expression() = default;
-};
+    auto compileComparison = [&](SpriteAnimatorOpcode opcode)
+    {
+        compileExpression(parameters, "l", node["l"], condition);
+        compileExpression(parameters, "r", node["r"], condition);
+        condition.code.push_back({opcode});
+    };
 
-struct FloatExpression : Expression
-{
-    ValueType evaluate(const SpriteAnimatorParameterStorage &storage) override { return value; }
+    if (type == "lt")
+    {
+        compileComparison(SpriteAnimatorOpcode::Lt);
+        return;
+    }
 
-    float value{};
-};
+    if (type == "le")
+    {
+        compileComparison(SpriteAnimatorOpcode::Le);
+        return;
+    }
 
-struct ParameterExpression : Expression
-{
-    ValueType evaluate(const SpriteAnimatorParameterStorage &storage) override
+    if (type == "gt")
     {
-        return std::visit([](auto value) { return value; }, storage.at(name));
+        compileComparison(SpriteAnimatorOpcode::Gt);
+        return;
     }
 
-    std::string name;
-};
+    if (type == "ge")
+    {
+        compileComparison(SpriteAnimatorOpcode::Ge);
+        return;
+    }
 
-struct AttributeExpression : Expression
-{
-    ValueType evaluate(const SpriteAnimatorParameterStorage &storage) override
+    if (type == "attr")
     {
-        auto leftValue = left->evaluate(storage);
+        auto left = node["l"];
+        auto right = node["r"].as<std::string>();
 
-        return std::visit(
-            [&](auto value)
+        auto parameter = left.IsScalar() ? parameters.find(left.as<std::string>()) : parameters.end();
+        if (parameter != parameters.end() && parameter->second != SPRITE_ANIMATOR_INVALID_PARAMETER &&
+            (right == "x" || right == "y"))
+        {
+            condition.code.push_back({SpriteAnimatorOpcode::Load, static_cast<u16>(parameter->second + (right == "x" ? 0 : 1))});
+            return;
+        }
+
+        std::cout << "Unknown animator attribute " << right << std::endl;
+        condition.code.push_back({SpriteAnimatorOpcode::Push});
+        return;
+    }
+
+    if (type == "l" || type == "r")
+    {
+        if (node.IsScalar())
+        {
+            auto value = node.as<std::string>();
+
+            if (parameters.find(value) != parameters.end())
             {
-                if constexpr (std::is_same_v<glm::vec2, decltype(value)>)
-                {
-                    if (right == "x")
-                    {
-                        return value.x;
-                    }
+                std::cout << "The animator parameter " << value << " can't be compared, use its attribute" << std::endl;
+                condition.code.push_back({SpriteAnimatorOpcode::Push});
+                return;
+            }
 
-                    if (right == "y")
-                    {
-                        return value.y;
-                    }
-                }
+            condition.code.push_back({SpriteAnimatorOpcode::Push, 0, node.as<float>()});
+            return;
+        }
 
-                return 0.f;
-            },
-            leftValue);
+        compileExpression(parameters, node.begin()->first.as<std::string>(), node.begin()->second, condition);
+        return;
     }
 
-    std::shared_ptr<Expression> left;
-    std::string right;
-};
+    condition.code.push_back({SpriteAnimatorOpcode::Push});
+}
 
-struct BinaryExpression : Expression
+// The deepest stack the code needs, or 0 if the code doesn't leave exactly one value on the stack
+std::size_t getStackDepth(const SpriteAnimatorInstruction *code, std::size_t size)
 {
-    std::shared_ptr<Expression> left;
-    std::shared_ptr<Expression> right;
-};
+    std::size_t depth = 0;
+    std::size_t maxDepth = 0;
+    for (std::size_t i = 0; i < size; i++)
+    {
+        if (code[i].opcode == SpriteAnimatorOpcode::Push || code[i].opcode == SpriteAnimatorOpcode::Load)
+        {
+            maxDepth = std::max(maxDepth, ++depth);
+        }
+        else if (depth < 2)
+        {
+            // A comparison takes two values
+            return 0;
+        }
+        else
+        {
+            depth--;
+        }
+    }
+    return depth == 1 ? maxDepth : 0;
+}
 
-struct LtExpression : BinaryExpression
+// Can the code be evaluated without leaving the stack, an empty code is always true
+bool isValidCode(const SpriteAnimatorInstruction *code, std::size_t size)
 {
-    ValueType evaluate(const SpriteAnimatorParameterStorage &storage) override
+    if (size == 0)
     {
-        return std::get<float>(left->evaluate(storage)) < std::get<float>(right->evaluate(storage));
+        return true;
     }
-};
+    std::size_t depth = getStackDepth(code, size);
+    return depth != 0 && depth <= SPRITE_ANIMATOR_STACK_SIZE;
+}
 
-struct GtExpression : BinaryExpression
+SpriteAnimatorCondition parseCondition(const ParameterOffsets &parameters, const YAML::Node &conditionNode)
 {
-    ValueType evaluate(const SpriteAnimatorParameterStorage &storage) override
+    auto expressionType = conditionNode.begin()->first.as<std::string>();
+    auto expressionNode = conditionNode.begin()->second;
+
+    SpriteAnimatorCondition condition;
+    compileExpression(parameters, expressionType, expressionNode, condition);
+
+    if (!isValidCode(condition.code.data(), condition.code.size()))
     {
-        return std::get<float>(left->evaluate(storage)) > std::get<float>(right->evaluate(storage));
+        std::cout << "The animator condition is too complex" << std::endl;
+
+        // Never true
+        condition.code = {{SpriteAnimatorOpcode::Push}};
     }
-};
 
-struct LeExpression : BinaryExpression
+    return condition;
+}
+
+} // namespace
+
+SpriteAnimator Animation::createAnimator(const std::function<void(SpriteAnimatorBuilder &)> &setup)
 {
-    ValueType evaluate(const SpriteAnimatorParameterStorage &storage) override
+    SpriteAnimatorBuilder builder;
+    setup(builder);
+
+    return builder.build();
+}
+
+SpriteAnimator Animation::loadAnimatorFromFile(const char *filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file)
     {
-        return std::get<float>(left->evaluate(storage)) <= std::get<float>(right->evaluate(storage));
+        std::cout << "Failed to open the animator " << filename << std::endl;
+        return createAnimator([](SpriteAnimatorBuilder &) {});
     }
-};
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
 
-struct GeExpression : BinaryExpression
-{
-    ValueType evaluate(const SpriteAnimatorParameterStorage &storage) override
+    // Reading and hashing the source is much cheaper than parsing it
+    u64 sourceHash = Hash::fnv1a(source);
+    std::string cachePath = TRUERPG_CACHE_DIR "/animators/" + Hash::toHex(sourceHash) + ".ranim";
+
+    SpriteAnimator animator;
+    if (loadCompiledAnimator(cachePath, sourceHash, animator))
     {
-        return std::get<float>(left->evaluate(storage)) >= std::get<float>(right->evaluate(storage));
+        return animator;
     }
-};
 
-std::shared_ptr<Expression> parseExpression(const std::set<std::string> &parameters, std::string_view type, const YAML::Node &node)
+    animator = parseAnimator(source);
+    saveCompiledAnimator(cachePath, sourceHash, animator);
+
+    return animator;
+}
+
+bool Animation::loadCompiledAnimator(const std::string &path, u64 sourceHash, SpriteAnimator &animator)
 {
-    if (type == "lt")
+    MappedFile file(path);
+    if (!file.isOpen())
     {
-        auto lt = std::make_shared<LtExpression>();
-        lt->left = parseExpression(parameters, "l", node["l"]);
-        lt->right = parseExpression(parameters, "r", node["r"]);
-
-        return lt;
+        return false;
     }
 
-    if (type == "le")
+    const u8 *data = file.getData();
+    auto header = (const RanimHeader *) data;
+    if (file.getSize() < sizeof(RanimHeader) || header->magic != RANIM_MAGIC || header->version != RANIM_VERSION ||
+        header->sourceHash != sourceHash)
     {
-        auto le = std::make_shared<LeExpression>();
-        le->left = parseExpression(parameters, "l", node["l"]);
-        le->right = parseExpression(parameters, "r", node["r"]);
-
-        return le;
+        return false;
     }
 
-    if (type == "gt")
+    std::size_t nodesOffset = sizeof(RanimHeader);
+    std::size_t framesOffset = nodesOffset + (std::size_t) header->nodeCount * sizeof(RanimNode);
+    std::size_t transitionsOffset = framesOffset + (std::size_t) header->frameCount * sizeof(RanimFrame);
+    std::size_t codeOffset = transitionsOffset + (std::size_t) header->transitionCount * sizeof(RanimTransition);
+    std::size_t parametersOffset = codeOffset + (std::size_t) header->instructionCount * sizeof(RanimInstruction);
+    std::size_t namesOffset = parametersOffset + (std::size_t) header->parameterCount * sizeof(RanimParameter);
+
+    if (header->nodeCount == 0 || header->nodeCount > SPRITE_ANIMATOR_MAX_ITEMS ||
+        header->frameCount > SPRITE_ANIMATOR_MAX_ITEMS || header->transitionCount > SPRITE_ANIMATOR_MAX_ITEMS ||
+        header->instructionCount > SPRITE_ANIMATOR_MAX_ITEMS || header->parameterCount > SPRITE_ANIMATOR_MAX_ITEMS ||
+        file.getSize() != namesOffset + header->namesSize)
     {
-        auto gt = std::make_shared<GtExpression>();
-        gt->left = parseExpression(parameters, "l", node["l"]);
-        gt->right = parseExpression(parameters, "r", node["r"]);
+        std::cout << "Broken compiled animator " << path << std::endl;
+        return false;
+    }
 
-        return gt;
+    auto nodes = (const RanimNode *) (data + nodesOffset);
+    auto frames = (const RanimFrame *) (data + framesOffset);
+    auto transitions = (const RanimTransition *) (data + transitionsOffset);
+    auto code = (const RanimInstruction *) (data + codeOffset);
+    auto parameters = (const RanimParameter *) (data + parametersOffset);
+    auto names = (const char *) (data + namesOffset);
+
+    // Everything is checked before it's used, a broken file is parsed again instead of crashing the game
+    auto isValidName = [&](u32 offset, u32 size) { return (u64) offset + size <= header->namesSize; };
+
+    SpriteAnimator result;
+    result.nodes.reserve(header->nodeCount);
+    for (u32 i = 0; i < header->nodeCount; i++)
+    {
+        const RanimNode &node = nodes[i];
+        if (!isValidName(node.nameOffset, node.nameSize) || node.firstFrame + node.frameCount > header->frameCount ||
+            node.firstTransition + node.transitionCount > header->transitionCount)
+        {
+            std::cout << "Broken compiled animator " << path << std::endl;
+            return false;
+        }
+        result.nodes.push_back({std::string(names + node.nameOffset, node.nameSize), node.firstFrame, node.frameCount,
+                                node.firstTransition, node.transitionCount});
     }
 
-    if (type == "ge")
+    result.frames.reserve(header->frameCount);
+    for (u32 i = 0; i < header->frameCount; i++)
     {
-        auto ge = std::make_shared<GeExpression>();
-        ge->left = parseExpression(parameters, "l", node["l"]);
-        ge->right = parseExpression(parameters, "r", node["r"]);
+        const RanimFrame &frame = frames[i];
+        result.frames.push_back({IntRect(frame.left, frame.bottom, frame.width, frame.height), frame.duration});
+    }
 
-        return ge;
+    result.transitions.reserve(header->transitionCount);
+    for (u32 i = 0; i < header->transitionCount; i++)
+    {
+        const RanimTransition &transition = transitions[i];
+        if (transition.destination >= header->nodeCount ||
+            transition.firstInstruction + transition.instructionCount > header->instructionCount)
+        {
+            std::cout << "Broken compiled animator " << path << std::endl;
+            return false;
+        }
+        result.transitions.push_back({transition.destination, transition.firstInstruction, transition.instructionCount});
     }
 
-    if (type == "attr")
+    result.code.reserve(header->instructionCount);
+    for (u32 i = 0; i < header->instructionCount; i++)
     {
-        auto attr = std::make_shared<AttributeExpression>();
-        attr->left = parseExpression(parameters, "l", node["l"]);
-        attr->right = node["r"].as<std::string>();
+        const RanimInstruction &instruction = code[i];
+        if (instruction.opcode > (u32) SpriteAnimatorOpcode::Ge ||
+            (instruction.opcode == (u32) SpriteAnimatorOpcode::Load && instruction.offset >= SPRITE_ANIMATOR_MAX_PARAMETER_VALUES))
+        {
+            std::cout << "Broken compiled animator " << path << std::endl;
+            return false;
+        }
+        result.code.push_back({(SpriteAnimatorOpcode) instruction.opcode, (u16) instruction.offset, instruction.value});
+    }
 
-        return attr;
+    // The evaluation doesn't check the stack, so every condition must be balanced and fit into it
+    for (const auto &transition : result.transitions)
+    {
+        if (!isValidCode(result.code.data() + transition.firstInstruction, transition.instructionCount))
+        {
+            std::cout << "Broken compiled animator " << path << std::endl;
+            return false;
+        }
     }
 
-    if (type == "l" || type == "r")
+    result.parameters.reserve(header->parameterCount);
+    for (u32 i = 0; i < header->parameterCount; i++)
     {
-        if (node.IsScalar())
+        const RanimParameter &parameter = parameters[i];
+        // A parameter which didn't fit into the storage has the invalid offset, the others must fit as a whole
+        if (!isValidName(parameter.nameOffset, parameter.nameSize) || parameter.type != (u32) SpriteAnimatorParameterType::Vec2 ||
+            (parameter.offset != SPRITE_ANIMATOR_INVALID_PARAMETER &&
+             parameter.offset + getSpriteAnimatorParameterSize((SpriteAnimatorParameterType) parameter.type) >
+                 SPRITE_ANIMATOR_MAX_PARAMETER_VALUES))
         {
-            auto value = node.as<std::string>();
+            std::cout << "Broken compiled animator " << path << std::endl;
+            return false;
+        }
+        result.parameters.push_back({std::string(names + parameter.nameOffset, parameter.nameSize),
+                                     (SpriteAnimatorParameterType) parameter.type, (u16) parameter.offset});
+    }
 
-            if (parameters.find(value) != parameters.end())
-            {
-                auto parameterExpression = std::make_shared<ParameterExpression>();
-                parameterExpression->name = std::move(value);
+    animator = std::move(result);
+    return true;
+}
 
-                return parameterExpression;
-            }
+void Animation::saveCompiledAnimator(const std::string &path, u64 sourceHash, const SpriteAnimator &animator)
+{
+    std::string names;
+    auto addName = [&](const std::string &name)
+    {
+        auto offset = (u32) names.size();
+        names += name;
+        return offset;
+    };
 
-            auto floatExpression = std::make_shared<FloatExpression>();
-            floatExpression->value = node.as<float>();
+    std::vector<RanimNode> nodes;
+    for (const auto &node : animator.nodes)
+    {
+        nodes.push_back({addName(node.name), (u32) node.name.size(), node.firstFrame, node.frameCount,
+                         node.firstTransition, node.transitionCount});
+    }
 
-            return floatExpression;
-        }
+    std::vector<RanimFrame> frames;
+    for (const auto &frame : animator.frames)
+    {
+        frames.push_back({frame.rect.getLeft(), frame.rect.getBottom(), frame.rect.getWidth(), frame.rect.getHeight(),
+                          frame.duration});
+    }
 
-        return parseExpression(parameters, node.begin()->first.as<std::string>(), node.begin()->second);
+    std::vector<RanimTransition> transitions;
+    for (const auto &transition : animator.transitions)
+    {
+        transitions.push_back({transition.destination, transition.firstInstruction, transition.instructionCount, 0});
     }
 
-    return std::make_shared<FloatExpression>();
-}
+    std::vector<RanimInstruction> code;
+    for (const auto &instruction : animator.code)
+    {
+        code.push_back({(u32) instruction.opcode, instruction.offset, instruction.value});
+    }
 
-std::function<bool(const SpriteAnimatorParameterStorage &)> parseCondition(
-    const std::set<std::string> &parameters, const YAML::Node &conditionNode)
-{
-    auto expressionType = conditionNode.begin()->first.as<std::string>();
-    auto expressionNode = conditionNode.begin()->second;
+    std::vector<RanimParameter> parameters;
+    for (const auto &parameter : animator.parameters)
+    {
+        parameters.push_back({addName(parameter.name), (u32) parameter.name.size(), (u32) parameter.type, parameter.offset});
+    }
 
-    auto expression = parseExpression(parameters, expressionType, expressionNode);
+    // The names go last, so they are padded to keep the file size a multiple of 4
+    names.resize((names.size() + 3) & ~(std::size_t) 3, '\0');
 
-    return [e = std::move(expression)](const SpriteAnimatorParameterStorage &storage) {
-        return std::get<bool>(e->evaluate(storage));
-    };
-}
+    RanimHeader header{RANIM_MAGIC,          RANIM_VERSION,          sourceHash,
+                       (u32) nodes.size(),   (u32) frames.size(),    (u32) transitions.size(),
+                       (u32) code.size(),    (u32) parameters.size(), (u32) names.size()};
 
-} // namespace
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
 
-SpriteAnimator Animation::createAnimator(const std::function<void(SpriteAnimatorBuilder &)> &setup)
-{
-    SpriteAnimatorBuilder builder;
-    setup(builder);
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cout << "Failed to write the animator cache " << path << std::endl;
+        return;
+    }
 
-    return builder.build();
+    file.write((const char *) &header, sizeof(header));
+    file.write((const char *) nodes.data(), (std::streamsize) (nodes.size() * sizeof(RanimNode)));
+    file.write((const char *) frames.data(), (std::streamsize) (frames.size() * sizeof(RanimFrame)));
+    file.write((const char *) transitions.data(), (std::streamsize) (transitions.size() * sizeof(RanimTransition)));
+    file.write((const char *) code.data(), (std::streamsize) (code.size() * sizeof(RanimInstruction)));
+    file.write((const char *) parameters.data(), (std::streamsize) (parameters.size() * sizeof(RanimParameter)));
+    file.write(names.data(), (std::streamsize) names.size());
 }
 
-SpriteAnimator Animation::loadAnimatorFromFile(const char *filename)
+SpriteAnimator Animation::parseAnimator(const std::string &source)
 {
     return createAnimator(
-        [=](SpriteAnimatorBuilder &builder)
+        [&](SpriteAnimatorBuilder &builder)
         {
-            auto root = YAML::LoadFile(filename);
+            auto root = YAML::Load(source);
 
             auto nodes = root["nodes"];
             auto parameters = root["parameters"];
 
-            std::set<std::string> parameterSet;
+            ParameterOffsets parameterOffsets;
 
             for (auto p = parameters.begin(); p != parameters.end(); ++p)
             {
@@ -220,8 +394,8 @@ SpriteAnimator Animation::loadAnimatorFromFile(const char *filename)
                     return SpriteAnimatorParameterType::Vec2;
                 }();
 
-                parameterSet.insert(name);
-                builder.parameter(std::move(name), type);
+                auto parameter = builder.parameter(name, type);
+                parameterOffsets.emplace(std::move(name), parameter.getOffset());
             }
 
             std::map<std::string, SpriteAnimatorBuilder::Node> nodesByName;
@@ -265,7 +439,7 @@ SpriteAnimator Animation::loadAnimatorFromFile(const char *filename)
 
                 if (entry.IsDefined() && entry.as<bool>())
                 {
-                    builder.entry().transition(srcNode, [](const auto &s) { return true; });
+                    builder.entry().transition(srcNode, {});
                 }
 
                 for (auto t = transitions.begin(); t != transitions.end(); ++t)
@@ -273,29 +447,23 @@ SpriteAnimator Animation::loadAnimatorFromFile(const char *filename)
                     auto dstNode = nodesByName.at((*t)["to"].as<std::string>());
                     auto conditionNode = (*t)["condition"];
 
-                    srcNode.transition(dstNode, parseCondition(parameterSet, conditionNode));
+                    srcNode.transition(dstNode, parseCondition(parameterOffsets, conditionNode));
                 }
             }
         });
 }
 
-void Animation::addAnimator(Entity entity, const SpriteAnimator *animator)
+void Animation::addAnimator(Entity entity, const SpriteAnimator *animator, bool gpuAnimation)
 {
     auto &animatorComponent = entity.addComponent<SpriteAnimatorComponent>();
 
     animatorComponent.animator = animator;
 
-    for (const auto &parameter : animator->parameters)
-    {
-        switch (parameter.type)
-        {
-        case SpriteAnimatorParameterType::Vec2:
-            animatorComponent.parameterStorage.emplace(parameter.name, glm::vec2{});
-            break;
-        }
-    }
+    animatorComponent.parameterStorage = {};
 
-    animatorComponent.activeAnimation.node = &animator->nodes.front();
-    animatorComponent.activeAnimation.frame.index = 0;
-    animatorComponent.activeAnimation.frame.time = 0;
+    animatorComponent.node = SPRITE_ANIMATOR_ENTRY_NODE;
+    animatorComponent.frame = 0;
+    animatorComponent.time = 0;
+    animatorComponent.frameChanged = false;
+    animatorComponent.gpuAnimation = gpuAnimation;
 }
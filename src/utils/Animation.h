@@ -9,9 +9,37 @@ class Animation
 public:
     static SpriteAnimator createAnimator(const std::function<void(SpriteAnimatorBuilder&)>& setup);
 
+    /**
+     * Load an animator from a YAML file.
+     * The compiled animator is cached, so the file is parsed again only when it changes.
+     *
+     * @param filename the file path
+     * @return the animator
+     */
     static SpriteAnimator loadAnimatorFromFile(const char* filename);
 
-    static void addAnimator(Entity entity, const SpriteAnimator *animator);
+    /**
+     * Parse an animator from YAML.
+     *
+     * @param source the YAML text
+     * @return the animator
+     */
+    static SpriteAnimator parseAnimator(const std::string &source);
+
+    /**
+     * Animate the sprite of the entity.
+     *
+     * @param entity the entity with a sprite renderer
+     * @param animator the animator, it must live longer than the entity
+     * @param gpuAnimation true to let the vertex shader pick the frames, it's cheaper for the animations
+     *                     whose parameters don't change every frame
+     */
+    static void addAnimator(Entity entity, const SpriteAnimator *animator, bool gpuAnimation = false);
+
+private:
+    static bool loadCompiledAnimator(const std::string &path, u64 sourceHash, SpriteAnimator &animator);
+
+    static void saveCompiledAnimator(const std::string &path, u64 sourceHash, const SpriteAnimator &animator);
 };
 
 #endif // RPG_ANIMATION_HPP
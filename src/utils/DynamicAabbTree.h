@@ -0,0 +1,474 @@
+#ifndef RPG_DYNAMICAABBTREE_H
+#define RPG_DYNAMICAABBTREE_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Types.h"
+
+// The proxy of nothing
+#define AABB_TREE_NULL -1
+
+// The deepest path a query can walk, the tree is kept balanced, so it's far more than enough
+#define AABB_TREE_STACK_SIZE 256
+
+/**
+ * Bounding volume hierarchy of axis-aligned boxes which can be moved, inserted and removed at any time.
+ * Every item is kept in a leaf with a box fattened by the margin, so a small movement doesn't change the tree.
+ * The inner nodes are kept height-balanced by rotations.
+ *
+ * The queries give the items whose fattened boxes match, the caller has to check them precisely.
+ *
+ * @tparam T the item type
+ */
+template <typename T>
+class DynamicAabbTree
+{
+    struct Node
+    {
+        glm::vec2 min{};
+        glm::vec2 max{};
+        T item{};
+
+        // The next free node when the node is free
+        i32 parent{AABB_TREE_NULL};
+        i32 left{AABB_TREE_NULL};
+        i32 right{AABB_TREE_NULL};
+
+        // A leaf is 0, a free node is -1
+        i32 height{-1};
+
+        bool isLeaf() const
+        {
+            return left == AABB_TREE_NULL;
+        }
+    };
+
+    float m_margin;
+    std::vector<Node> m_nodes;
+    i32 m_root{AABB_TREE_NULL};
+    i32 m_freeList{AABB_TREE_NULL};
+    u32 m_count{0};
+
+public:
+    /**
+     * Create a tree.
+     *
+     * @param margin how far an item can move before it's reinserted, should be close to the usual movement
+     */
+    explicit DynamicAabbTree(float margin)
+            : m_margin(margin) {}
+
+    /**
+     * Insert an item.
+     *
+     * @param item the item
+     * @param min the minimal corner of the item box
+     * @param max the maximal corner of the item box
+     * @return the proxy which refers to the item in the tree
+     */
+    i32 insert(T item, glm::vec2 min, glm::vec2 max)
+    {
+        i32 proxy = allocateNode();
+        Node &node = m_nodes[proxy];
+        node.min = min - m_margin;
+        node.max = max + m_margin;
+        node.item = item;
+        node.height = 0;
+
+        insertLeaf(proxy);
+        m_count++;
+        return proxy;
+    }
+
+    /**
+     * Remove an item.
+     *
+     * @param proxy the proxy of the item
+     */
+    void remove(i32 proxy)
+    {
+        removeLeaf(proxy);
+        freeNode(proxy);
+        m_count--;
+    }
+
+    /**
+     * Move an item. Nothing changes if the new box is still inside the fattened one.
+     *
+     * @param proxy the proxy of the item
+     * @param min the minimal corner of the new item box
+     * @param max the maximal corner of the new item box
+     * @return true if the item was reinserted
+     */
+    bool move(i32 proxy, glm::vec2 min, glm::vec2 max)
+    {
+        Node &node = m_nodes[proxy];
+        if (node.min.x <= min.x && node.min.y <= min.y && max.x <= node.max.x && max.y <= node.max.y)
+        {
+            return false;
+        }
+
+        removeLeaf(proxy);
+        m_nodes[proxy].min = min - m_margin;
+        m_nodes[proxy].max = max + m_margin;
+        insertLeaf(proxy);
+        return true;
+    }
+
+    /**
+     * Get the item of a proxy.
+     *
+     * @param proxy the proxy
+     * @return the item
+     */
+    const T &getItem(i32 proxy) const
+    {
+        return m_nodes[proxy].item;
+    }
+
+    /**
+     * Call the callback for every item whose box overlaps the rectangle.
+     *
+     * @param min the minimal corner of the rectangle
+     * @param max the maximal corner of the rectangle
+     * @param callback the function which takes an item
+     */
+    template <typename Callback>
+    void query(glm::vec2 min, glm::vec2 max, Callback callback) const
+    {
+        visit([&](const Node &node)
+              {
+                  return node.min.x <= max.x && min.x <= node.max.x && node.min.y <= max.y && min.y <= node.max.y;
+              },
+              callback);
+    }
+
+    /**
+     * Call the callback for every item whose box touches the circle.
+     *
+     * @param center the center of the circle
+     * @param radius the radius of the circle
+     * @param callback the function which takes an item
+     */
+    template <typename Callback>
+    void queryRadius(glm::vec2 center, float radius, Callback callback) const
+    {
+        float radiusSquared = radius * radius;
+        visit([&](const Node &node)
+              {
+                  glm::vec2 closest = glm::clamp(center, node.min, node.max);
+                  glm::vec2 delta = center - closest;
+                  return glm::dot(delta, delta) <= radiusSquared;
+              },
+              callback);
+    }
+
+    /**
+     * Call the callback for every item whose box is crossed by the segment.
+     * The items aren't sorted by the distance.
+     *
+     * @param from the start of the segment
+     * @param to the end of the segment
+     * @param callback the function which takes an item
+     */
+    template <typename Callback>
+    void raycast(glm::vec2 from, glm::vec2 to, Callback callback) const
+    {
+        glm::vec2 direction = to - from;
+        visit([&](const Node &node) { return segmentIntersects(from, direction, node.min, node.max); }, callback);
+    }
+
+    /**
+     * Get the number of items.
+     *
+     * @return the number of items
+     */
+    u32 size() const
+    {
+        return m_count;
+    }
+
+    void clear()
+    {
+        m_nodes.clear();
+        m_root = AABB_TREE_NULL;
+        m_freeList = AABB_TREE_NULL;
+        m_count = 0;
+    }
+
+private:
+    template <typename Test, typename Callback>
+    void visit(Test test, Callback callback) const
+    {
+        if (m_root == AABB_TREE_NULL) return;
+
+        std::array<i32, AABB_TREE_STACK_SIZE> stack;
+        std::size_t stackSize = 0;
+        stack[stackSize++] = m_root;
+
+        while (stackSize > 0)
+        {
+            const Node &node = m_nodes[stack[--stackSize]];
+            if (!test(node)) continue;
+
+            if (node.isLeaf())
+            {
+                callback(node.item);
+                continue;
+            }
+            stack[stackSize++] = node.left;
+            stack[stackSize++] = node.right;
+        }
+    }
+
+    static bool segmentIntersects(glm::vec2 from, glm::vec2 direction, glm::vec2 min, glm::vec2 max)
+    {
+        // The slab test, the segment is from + direction * t for t in [0, 1]
+        float tMin = 0.f;
+        float tMax = 1.f;
+        for (int axis = 0; axis < 2; axis++)
+        {
+            if (std::abs(direction[axis]) < 1e-6f)
+            {
+                if (from[axis] < min[axis] || from[axis] > max[axis]) return false;
+                continue;
+            }
+
+            float t1 = (min[axis] - from[axis]) / direction[axis];
+            float t2 = (max[axis] - from[axis]) / direction[axis];
+            tMin = std::max(tMin, std::min(t1, t2));
+            tMax = std::min(tMax, std::max(t1, t2));
+            if (tMin > tMax) return false;
+        }
+        return true;
+    }
+
+    static float perimeter(glm::vec2 min, glm::vec2 max)
+    {
+        return 2.f * (max.x - min.x + max.y - min.y);
+    }
+
+    i32 allocateNode()
+    {
+        if (m_freeList == AABB_TREE_NULL)
+        {
+            m_nodes.emplace_back();
+            return (i32) m_nodes.size() - 1;
+        }
+
+        i32 index = m_freeList;
+        m_freeList = m_nodes[index].parent;
+        m_nodes[index] = Node{};
+        return index;
+    }
+
+    void freeNode(i32 index)
+    {
+        m_nodes[index].parent = m_freeList;
+        m_nodes[index].height = -1;
+        m_freeList = index;
+    }
+
+    void insertLeaf(i32 leaf)
+    {
+        if (m_root == AABB_TREE_NULL)
+        {
+            m_root = leaf;
+            m_nodes[leaf].parent = AABB_TREE_NULL;
+            return;
+        }
+
+        // Go down to the sibling which makes the tree grow the least
+        glm::vec2 leafMin = m_nodes[leaf].min;
+        glm::vec2 leafMax = m_nodes[leaf].max;
+        i32 index = m_root;
+        while (!m_nodes[index].isLeaf())
+        {
+            const Node &node = m_nodes[index];
+
+            float area = perimeter(node.min, node.max);
+            float combinedArea = perimeter(glm::min(node.min, leafMin), glm::max(node.max, leafMax));
+
+            // Making a new parent here costs the combined box, going deeper also grows this box
+            float cost = 2.f * combinedArea;
+            float inheritanceCost = 2.f * (combinedArea - area);
+
+            float leftCost = childCost(node.left, leafMin, leafMax) + inheritanceCost;
+            float rightCost = childCost(node.right, leafMin, leafMax) + inheritanceCost;
+
+            if (cost < leftCost && cost < rightCost) break;
+
+            index = leftCost < rightCost ? node.left : node.right;
+        }
+        i32 sibling = index;
+
+        // The new parent takes the place of the sibling
+        i32 oldParent = m_nodes[sibling].parent;
+        i32 newParent = allocateNode();
+        m_nodes[newParent].parent = oldParent;
+        m_nodes[newParent].min = glm::min(m_nodes[sibling].min, leafMin);
+        m_nodes[newParent].max = glm::max(m_nodes[sibling].max, leafMax);
+        m_nodes[newParent].height = m_nodes[sibling].height + 1;
+        m_nodes[newParent].left = sibling;
+        m_nodes[newParent].right = leaf;
+        m_nodes[sibling].parent = newParent;
+        m_nodes[leaf].parent = newParent;
+
+        if (oldParent == AABB_TREE_NULL)
+        {
+            m_root = newParent;
+        }
+        else if (m_nodes[oldParent].left == sibling)
+        {
+            m_nodes[oldParent].left = newParent;
+        }
+        else
+        {
+            m_nodes[oldParent].right = newParent;
+        }
+
+        refit(m_nodes[leaf].parent);
+    }
+
+    float childCost(i32 child, glm::vec2 leafMin, glm::vec2 leafMax) const
+    {
+        const Node &node = m_nodes[child];
+        float combinedArea = perimeter(glm::min(node.min, leafMin), glm::max(node.max, leafMax));
+        return node.isLeaf() ? combinedArea : combinedArea - perimeter(node.min, node.max);
+    }
+
+    void removeLeaf(i32 leaf)
+    {
+        if (leaf == m_root)
+        {
+            m_root = AABB_TREE_NULL;
+            return;
+        }
+
+        // The sibling takes the place of the parent
+        i32 parent = m_nodes[leaf].parent;
+        i32 grandParent = m_nodes[parent].parent;
+        i32 sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+
+        m_nodes[sibling].parent = grandParent;
+        freeNode(parent);
+
+        if (grandParent == AABB_TREE_NULL)
+        {
+            m_root = sibling;
+            return;
+        }
+
+        if (m_nodes[grandParent].left == parent)
+        {
+            m_nodes[grandParent].left = sibling;
+        }
+        else
+        {
+            m_nodes[grandParent].right = sibling;
+        }
+        refit(grandParent);
+    }
+
+    // Fix the boxes and the heights from the node up to the root
+    void refit(i32 index)
+    {
+        while (index != AABB_TREE_NULL)
+        {
+            index = balance(index);
+
+            Node &node = m_nodes[index];
+            const Node &left = m_nodes[node.left];
+            const Node &right = m_nodes[node.right];
+            node.height = 1 + std::max(left.height, right.height);
+            node.min = glm::min(left.min, right.min);
+            node.max = glm::max(left.max, right.max);
+
+            index = node.parent;
+        }
+    }
+
+    // Rotate the taller child up if the children heights differ by more than one, return the new subtree root
+    i32 balance(i32 a)
+    {
+        Node &nodeA = m_nodes[a];
+        if (nodeA.isLeaf() || nodeA.height < 2)
+        {
+            return a;
+        }
+
+        i32 b = nodeA.left;
+        i32 c = nodeA.right;
+        i32 difference = m_nodes[c].height - m_nodes[b].height;
+
+        if (difference > 1)
+        {
+            return rotate(a, c, b, false);
+        }
+        if (difference < -1)
+        {
+            return rotate(a, b, c, true);
+        }
+        return a;
+    }
+
+    // The child goes up in place of the node, the other child stays with the node
+    i32 rotate(i32 a, i32 child, i32 other, bool childIsLeft)
+    {
+        Node &nodeA = m_nodes[a];
+        Node &nodeChild = m_nodes[child];
+        i32 f = nodeChild.left;
+        i32 g = nodeChild.right;
+
+        nodeChild.left = a;
+        nodeChild.parent = nodeA.parent;
+        nodeA.parent = child;
+
+        if (nodeChild.parent == AABB_TREE_NULL)
+        {
+            m_root = child;
+        }
+        else if (m_nodes[nodeChild.parent].left == a)
+        {
+            m_nodes[nodeChild.parent].left = child;
+        }
+        else
+        {
+            m_nodes[nodeChild.parent].right = child;
+        }
+
+        // The taller grandchild stays with the child, the shorter one goes to the node
+        i32 taller = m_nodes[f].height > m_nodes[g].height ? f : g;
+        i32 shorter = taller == f ? g : f;
+
+        nodeChild.right = taller;
+        if (childIsLeft)
+        {
+            nodeA.left = shorter;
+        }
+        else
+        {
+            nodeA.right = shorter;
+        }
+        m_nodes[shorter].parent = a;
+
+        const Node &nodeOther = m_nodes[other];
+        const Node &nodeShorter = m_nodes[shorter];
+        const Node &nodeTaller = m_nodes[taller];
+
+        nodeA.min = glm::min(nodeOther.min, nodeShorter.min);
+        nodeA.max = glm::max(nodeOther.max, nodeShorter.max);
+        nodeA.height = 1 + std::max(nodeOther.height, nodeShorter.height);
+
+        nodeChild.min = glm::min(nodeA.min, nodeTaller.min);
+        nodeChild.max = glm::max(nodeA.max, nodeTaller.max);
+        nodeChild.height = 1 + std::max(nodeA.height, nodeTaller.height);
+
+        return child;
+    }
+};
+
+#endif // RPG_DYNAMICAABBTREE_H
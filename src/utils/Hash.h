@@ -0,0 +1,76 @@
+#ifndef RPG_HASH_H
+#define RPG_HASH_H
+
+#include <string>
+#include "Types.h"
+
+#define FNV1A_OFFSET_BASIS 14695981039346656037ull
+#define FNV1A_PRIME 1099511628211ull
+
+/**
+ * Utility class for non-cryptographic hashing of cache keys.
+ */
+class Hash
+{
+public:
+    /**
+     * Compute the 64-bit FNV-1a hash of the given data.
+     *
+     * @param data the data
+     * @param size the size of the data in bytes
+     * @param seed the previous hash, allows to hash several pieces of data as one
+     * @return the hash
+     */
+    static u64 fnv1a(const void *data, std::size_t size, u64 seed = FNV1A_OFFSET_BASIS)
+    {
+        auto bytes = (const u8 *) data;
+        u64 hash = seed;
+        for (std::size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= FNV1A_PRIME;
+        }
+        return hash;
+    }
+
+    static u64 fnv1a(const std::string &data, u64 seed = FNV1A_OFFSET_BASIS)
+    {
+        return fnv1a(data.data(), data.size(), seed);
+    }
+
+    /**
+     * Scramble the bits of a number (the splitmix64 finalizer), close numbers give unrelated results.
+     *
+     * @param value the number
+     * @return the hash
+     */
+    static u64 mix(u64 value)
+    {
+        value ^= value >> 30;
+        value *= 0xbf58476d1ce4e5b9ull;
+        value ^= value >> 27;
+        value *= 0x94d049bb133111ebull;
+        value ^= value >> 31;
+        return value;
+    }
+
+    /**
+     * Convert the hash to a hex string, so it can be used as a file name.
+     *
+     * @param hash the hash
+     * @return 16 hex digits
+     */
+    static std::string toHex(u64 hash)
+    {
+        static const char digits[] = "0123456789abcdef";
+        std::string result(16, '0');
+        for (int i = 15; i >= 0; i--)
+        {
+            result[i] = digits[hash & 0xf];
+            hash >>= 4;
+        }
+        return result;
+    }
+};
+
+#endif // RPG_HASH_H
@@ -20,6 +20,9 @@ void Hierarchy::addChild(Entity parent, Entity child)
     parentHierarchy.children++;
 
     childHierarchy.parent = parent;
+
+    // The world transform of the child has changed
+    child.patchComponent<TransformComponent>();
 }
 
 Entity Hierarchy::find(Entity parent, const std::string& name)
@@ -3,6 +3,7 @@
 
 #include "../scene/Entity.h"
 #include "../components/basic/TransformComponent.h"
+#include "../components/basic/HierarchyComponent.h"
 
 /**
  * Utility class which contains useful functions for the entity hierarchy.
@@ -35,6 +36,25 @@ public:
      * @return calculated transformation
      */
     static TransformComponent computeTransform(Entity entity);
+
+    /**
+     * Call the function for every child of the given entity, the children of the children are visited too.
+     * The world transforms of all of them depend on the transform of the entity.
+     *
+     * @param entity the entity
+     * @param function the function which takes the child entity
+     */
+    template <typename F>
+    static void forEachDescendant(Entity entity, F function)
+    {
+        Entity current = entity.getComponent<HierarchyComponent>().firstChild;
+        while (current)
+        {
+            function(current);
+            forEachDescendant(current, function);
+            current = current.getComponent<HierarchyComponent>().next;
+        }
+    }
 };
 
 #endif //RPG_HIERARCHY_H
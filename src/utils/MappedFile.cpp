@@ -0,0 +1,121 @@
+#include "../pch.h"
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string &path)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return;
+    }
+
+    m_data = (const u8 *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m_data)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return;
+    }
+    m_file = file;
+    m_mapping = mapping;
+    m_size = (std::size_t) size.QuadPart;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) return;
+
+    struct stat info{};
+    if (fstat(fd, &info) == -1 || info.st_size == 0)
+    {
+        ::close(fd);
+        return;
+    }
+
+    void *data = mmap(nullptr, (std::size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after closing the descriptor
+    ::close(fd);
+    if (data == MAP_FAILED) return;
+
+    m_data = (const u8 *) data;
+    m_size = (std::size_t) info.st_size;
+#endif
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+#ifdef _WIN32
+        std::swap(m_file, other.m_file);
+        std::swap(m_mapping, other.m_mapping);
+#endif
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::isOpen() const
+{
+    return m_data != nullptr;
+}
+
+const u8 *MappedFile::getData() const
+{
+    return m_data;
+}
+
+std::size_t MappedFile::getSize() const
+{
+    return m_size;
+}
+
+void MappedFile::close()
+{
+    if (!m_data) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+    CloseHandle(m_file);
+    m_file = nullptr;
+    m_mapping = nullptr;
+#else
+    munmap((void *) m_data, m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
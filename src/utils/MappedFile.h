@@ -0,0 +1,48 @@
+#ifndef RPG_MAPPEDFILE_H
+#define RPG_MAPPEDFILE_H
+
+#include <string>
+#include "Types.h"
+
+/**
+ * Read-only memory mapped file.
+ * The file is unmapped when the object is destroyed.
+ */
+class MappedFile
+{
+    const u8 *m_data{};
+    std::size_t m_size{};
+#ifdef _WIN32
+    void *m_file{};
+    void *m_mapping{};
+#endif
+
+public:
+    MappedFile() = default;
+
+    /**
+     * Map the whole file into memory.
+     * Use isOpen() to check if it succeeded.
+     *
+     * @param path the file path
+     */
+    explicit MappedFile(const std::string &path);
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    ~MappedFile();
+
+    bool isOpen() const;
+
+    const u8 *getData() const;
+
+    std::size_t getSize() const;
+
+    void close();
+};
+
+#endif // RPG_MAPPEDFILE_H
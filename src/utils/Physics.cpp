@@ -0,0 +1,20 @@
+#include "../pch.h"
+#include "Physics.h"
+
+#include "../components/physics/RigidbodyComponent.h"
+#include "../components/physics/SleepingComponent.h"
+
+void Physics::setVelocity(Entity entity, glm::vec2 velocity)
+{
+    auto &rigidbody = entity.getComponent<RigidbodyComponent>();
+    if (rigidbody.velocity == velocity) return;
+
+    rigidbody.velocity = velocity;
+    wake(entity);
+}
+
+void Physics::wake(Entity entity)
+{
+    entity.getComponent<RigidbodyComponent>().stillTime = 0.f;
+    entity.removeComponent<SleepingComponent>();
+}
@@ -0,0 +1,28 @@
+#ifndef RPG_PHYSICS_H
+#define RPG_PHYSICS_H
+
+#include "../scene/Entity.h"
+
+/**
+ * Utility class which contains functions for the rigidbodies.
+ */
+class Physics
+{
+public:
+    /**
+     * Set the velocity of the body. The body wakes up if the velocity is changed.
+     *
+     * @param entity the entity with a rigidbody
+     * @param velocity the new velocity
+     */
+    static void setVelocity(Entity entity, glm::vec2 velocity);
+
+    /**
+     * Wake the body up, so it's moved by the physics system again.
+     *
+     * @param entity the entity with a rigidbody
+     */
+    static void wake(Entity entity);
+};
+
+#endif // RPG_PHYSICS_H
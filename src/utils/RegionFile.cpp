@@ -0,0 +1,143 @@
+#include "../pch.h"
+#include "RegionFile.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+RegionFile::RegionFile(std::string path, u64 seed, glm::ivec2 region)
+        : m_path(std::move(path)),
+          m_seed(seed),
+          m_region(region)
+{
+    map();
+}
+
+bool RegionFile::read(glm::ivec2 local, WorldChunk &chunk) const
+{
+    int index = local.y * REGION_SIZE + local.x;
+
+    auto it = m_changed.find(index);
+    if (it != m_changed.end())
+    {
+        chunk = it->second;
+        return true;
+    }
+
+    if (!m_table || m_table[index] == 0)
+    {
+        return false;
+    }
+
+    std::memcpy(&chunk, &m_records[m_table[index] - 1], sizeof(WorldChunk));
+    return true;
+}
+
+void RegionFile::write(glm::ivec2 local, const WorldChunk &chunk)
+{
+    m_changed[local.y * REGION_SIZE + local.x] = chunk;
+}
+
+void RegionFile::save()
+{
+    if (m_changed.empty()) return;
+
+    // The records keep the order of the table, the unchanged ones are copied from the old file
+    std::vector<u32> table(REGION_CHUNKS, 0);
+    std::vector<WorldChunk> records;
+    for (int index = 0; index < REGION_CHUNKS; index++)
+    {
+        WorldChunk chunk;
+        if (read({index % REGION_SIZE, index / REGION_SIZE}, chunk))
+        {
+            records.push_back(chunk);
+            table[index] = (u32) records.size();
+        }
+    }
+
+    RegionHeader header{REGION_MAGIC, REGION_VERSION, m_seed, m_region.x, m_region.y, (u32) records.size(), 0};
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(m_path).parent_path(), error);
+
+    std::string tempPath = m_path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file)
+        {
+            std::cout << "Failed to write the region " << m_path << std::endl;
+            return;
+        }
+
+        file.write((const char *) &header, sizeof(header));
+        file.write((const char *) table.data(), (std::streamsize) (table.size() * sizeof(u32)));
+        file.write((const char *) records.data(), (std::streamsize) (records.size() * sizeof(WorldChunk)));
+        if (!file)
+        {
+            std::cout << "Failed to write the region " << m_path << std::endl;
+            return;
+        }
+    }
+
+    // The old file can't be replaced while it's mapped on Windows
+    m_file.close();
+    m_table = nullptr;
+    m_records = nullptr;
+
+    std::filesystem::rename(tempPath, m_path, error);
+    if (error)
+    {
+        std::cout << "Failed to replace the region " << m_path << ": " << error.message() << std::endl;
+        map();
+        return;
+    }
+
+    m_changed.clear();
+    map();
+}
+
+glm::ivec2 RegionFile::toRegion(glm::ivec2 chunk)
+{
+    return {WorldChunk::floorDiv(chunk.x, REGION_SIZE), WorldChunk::floorDiv(chunk.y, REGION_SIZE)};
+}
+
+void RegionFile::map()
+{
+    m_file = MappedFile(m_path);
+    if (!m_file.isOpen()) return;
+
+    std::size_t tableEnd = sizeof(RegionHeader) + REGION_CHUNKS * sizeof(u32);
+    if (m_file.getSize() < tableEnd)
+    {
+        m_file.close();
+        return;
+    }
+
+    RegionHeader header{};
+    std::memcpy(&header, m_file.getData(), sizeof(header));
+    if (header.magic != REGION_MAGIC || header.version != REGION_VERSION || header.seed != m_seed ||
+        header.x != m_region.x || header.y != m_region.y ||
+        m_file.getSize() != tableEnd + header.chunkCount * sizeof(WorldChunk))
+    {
+        std::cout << "The region " << m_path << " is damaged or belongs to another world, it's ignored" << std::endl;
+        m_file.close();
+        return;
+    }
+
+    m_table = (const u32 *) (m_file.getData() + sizeof(RegionHeader));
+    m_records = (const WorldChunk *) (m_file.getData() + tableEnd);
+
+    // A table entry which points past the records would read outside the file
+    for (int index = 0; index < REGION_CHUNKS; index++)
+    {
+        if (m_table[index] > header.chunkCount)
+        {
+            std::cout << "The region " << m_path << " is damaged, it's ignored" << std::endl;
+            m_file.close();
+            m_table = nullptr;
+            m_records = nullptr;
+            return;
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef RPG_REGIONFILE_H
+#define RPG_REGIONFILE_H
+
+#include <string>
+#include <unordered_map>
+#include "MappedFile.h"
+#include "WorldChunk.h"
+
+// Region file (.rreg), it keeps a square of REGION_SIZE x REGION_SIZE chunks of the world map.
+// The file is mapped into memory, so a chunk is read only when it's needed, and it's copied as it is:
+// [RegionHeader][u32 x REGION_CHUNKS][WorldChunk x chunkCount]
+// The table gives the index + 1 of the record of every chunk of the region, 0 means the chunk wasn't generated yet.
+
+#define REGION_MAGIC 0x47455252 // "RREG"
+#define REGION_VERSION 1
+
+// The number of chunks along a side of a region
+#define REGION_SIZE 16
+#define REGION_CHUNKS (REGION_SIZE * REGION_SIZE)
+
+struct RegionHeader
+{
+    u32 magic;
+    u32 version;
+    u64 seed; // the world seed, the file belongs to another world if it doesn't match
+    i32 x;
+    i32 y;
+    u32 chunkCount;
+    u32 padding;
+};
+
+/**
+ * The chunks of a region: the ones in the file and the ones which were changed since it was saved.
+ */
+class RegionFile
+{
+    std::string m_path;
+    u64 m_seed;
+    glm::ivec2 m_region;
+
+    MappedFile m_file;
+    const u32 *m_table{};
+    const WorldChunk *m_records{};
+
+    // The chunks which are new or changed, they are written by save()
+    std::unordered_map<int, WorldChunk> m_changed;
+
+public:
+    /**
+     * Open the region file. A missing, damaged or foreign file is treated as an empty region.
+     *
+     * @param path the file path
+     * @param seed the world seed
+     * @param region the region coordinates
+     */
+    RegionFile(std::string path, u64 seed, glm::ivec2 region);
+
+    RegionFile(const RegionFile &) = delete;
+    RegionFile &operator=(const RegionFile &) = delete;
+
+    /**
+     * Read a chunk.
+     *
+     * @param local the chunk coordinates inside the region
+     * @param chunk the chunk to fill
+     * @return false if the region doesn't have the chunk
+     */
+    bool read(glm::ivec2 local, WorldChunk &chunk) const;
+
+    /**
+     * Put a chunk into the region, it's written into the file by save().
+     *
+     * @param local the chunk coordinates inside the region
+     * @param chunk the chunk
+     */
+    void write(glm::ivec2 local, const WorldChunk &chunk);
+
+    /**
+     * Write the changed chunks into the file. Nothing happens if nothing was changed.
+     * The new file is written next to the old one first, so a failed save doesn't lose the region.
+     */
+    void save();
+
+    /**
+     * Get the region which contains the chunk.
+     *
+     * @param chunk the chunk coordinates in the world
+     * @return the region coordinates
+     */
+    static glm::ivec2 toRegion(glm::ivec2 chunk);
+
+private:
+    void map();
+};
+
+#endif // RPG_REGIONFILE_H
@@ -0,0 +1,70 @@
+#ifndef RPG_SPSCQUEUE_H
+#define RPG_SPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Lock-free bounded queue for exactly one producer thread and one consumer thread.
+ * Neither push nor pop ever blocks or allocates, so it's safe to use on the real-time audio thread.
+ *
+ * @tparam T the item type
+ * @tparam Capacity the maximum number of items, must be a power of two
+ */
+template <typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "The capacity must be a power of two");
+
+    std::array<T, Capacity> m_items{};
+
+    // The indices only grow, the position in the array is index & (Capacity - 1).
+    // They are on different cache lines, so the threads don't fight for one line.
+    alignas(64) std::atomic<std::size_t> m_head{0}; // written by the consumer
+    alignas(64) std::atomic<std::size_t> m_tail{0}; // written by the producer
+
+public:
+    /**
+     * Add an item. Must be called only from the producer thread.
+     *
+     * @param item the item
+     * @return false if the queue is full
+     */
+    bool push(const T &item)
+    {
+        std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+        m_items[tail & (Capacity - 1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Take the oldest item. Must be called only from the consumer thread.
+     *
+     * @param item the taken item
+     * @return false if the queue is empty
+     */
+    bool pop(T &item)
+    {
+        std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = m_items[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+};
+
+#endif // RPG_SPSCQUEUE_H
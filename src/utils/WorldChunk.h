@@ -0,0 +1,75 @@
+#ifndef RPG_WORLDCHUNK_H
+#define RPG_WORLDCHUNK_H
+
+#include <array>
+#include <glm/glm.hpp>
+#include "Types.h"
+
+// The number of tiles along a side of a chunk
+#define WORLD_CHUNK_SIZE 32
+#define WORLD_CHUNK_TILES (WORLD_CHUNK_SIZE * WORLD_CHUNK_SIZE)
+
+enum class WorldTile : u8
+{
+    Sand,
+    Grass,
+    Dirt,
+    GrassMushroom
+};
+
+enum class WorldObject : u8
+{
+    None,
+    Tree,
+    Bush
+};
+
+/**
+ * A square piece of the world map. It only says what is where, the look is decided by the generator.
+ * It's plain bytes, so it's copied into the region files as it is.
+ */
+struct WorldChunk
+{
+    std::array<WorldTile, WORLD_CHUNK_TILES> tiles{};
+    std::array<WorldObject, WORLD_CHUNK_TILES> objects{};
+
+    /**
+     * Get the index of a tile in the arrays.
+     *
+     * @param local the tile coordinates inside the chunk
+     * @return the index
+     */
+    static int toIndex(glm::ivec2 local)
+    {
+        return local.y * WORLD_CHUNK_SIZE + local.x;
+    }
+
+    /**
+     * Get the chunk which contains the tile.
+     *
+     * @param tile the tile coordinates in the world
+     * @return the chunk coordinates
+     */
+    static glm::ivec2 toChunk(glm::ivec2 tile)
+    {
+        return {floorDiv(tile.x, WORLD_CHUNK_SIZE), floorDiv(tile.y, WORLD_CHUNK_SIZE)};
+    }
+
+    /**
+     * Get the coordinates of the tile inside its chunk.
+     *
+     * @param tile the tile coordinates in the world
+     * @return the tile coordinates inside the chunk
+     */
+    static glm::ivec2 toLocal(glm::ivec2 tile)
+    {
+        return tile - toChunk(tile) * WORLD_CHUNK_SIZE;
+    }
+
+    static int floorDiv(int value, int divisor)
+    {
+        return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+    }
+};
+
+#endif // RPG_WORLDCHUNK_H
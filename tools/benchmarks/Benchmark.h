@@ -0,0 +1,41 @@
+#ifndef RPG_BENCHMARK_H
+#define RPG_BENCHMARK_H
+
+// Tiny helpers shared by the benchmarks. Every benchmark prints a table of "name: time" lines,
+// the "before" rows run a copy of the replaced code, so both numbers come from the same machine and build.
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// Keeps the compiler from throwing away the results it thinks are unused
+template <typename T>
+inline void doNotOptimize(const T &value)
+{
+    static volatile const T *sink;
+    sink = &value;
+}
+
+// Run the function and return how long it took in milliseconds
+template <typename F>
+inline double measureMs(F function)
+{
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+    return time.count();
+}
+
+inline void printResult(const std::string &name, double ms, const std::string &unit = "", double perUnit = 0.0)
+{
+    std::cout << std::left << std::setw(56) << name << std::right << std::setw(12) << std::fixed << std::setprecision(3)
+              << ms << " ms";
+    if (perUnit > 0.0)
+    {
+        std::cout << "  (" << std::setprecision(1) << ms * 1e6 / perUnit << " ns per " << unit << ")";
+    }
+    std::cout << std::endl;
+}
+
+#endif // RPG_BENCHMARK_H
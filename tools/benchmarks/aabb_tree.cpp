@@ -0,0 +1,199 @@
+// AABB tree benchmark: inserting, moving and querying 100k proxies.
+//
+// Usage: aabb-tree-benchmark [frames]
+// The "before" rows run what the tree replaced: the boxes kept in a plain array and every query testing all of them.
+// The "after" rows run DynamicAabbTree with the margin of the visibility system. Every frame all the proxies move
+// by a walking step and one in a hundred jumps far away, then the camera rectangle
+// and the collider-sized rectangles of the physics sweeps are queried.
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "../../src/utils/DynamicAabbTree.h"
+
+#define PROXY_COUNT 100000
+#define WORLD_SIZE 20000.f
+#define PROXY_SIZE 32.f
+#define TREE_MARGIN 32.f
+
+// A 720p camera and the sweeps of the moving bodies
+#define VIEW_SIZE glm::vec2(1280.f, 720.f)
+#define SWEEP_QUERY_COUNT 1000
+#define SWEEP_QUERY_SIZE 64.f
+
+// One in this many proxies teleports every frame
+#define TELEPORT_EVERY 100
+
+struct Box
+{
+    glm::vec2 min;
+    glm::vec2 max;
+};
+
+// The positions of every frame are made up front, so both sides get the same work and no random calls are measured
+struct Scene
+{
+    std::vector<glm::vec2> start;
+    std::vector<std::vector<glm::vec2>> positions;
+    std::vector<std::vector<glm::vec2>> queries;
+};
+
+static Scene makeScene(int frames)
+{
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> world(0.f, WORLD_SIZE);
+    std::uniform_real_distribution<float> step(-2.f, 2.f);
+
+    Scene scene;
+    scene.start.resize(PROXY_COUNT);
+    for (auto &position : scene.start)
+    {
+        position = {world(random), world(random)};
+    }
+
+    std::vector<glm::vec2> current = scene.start;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        for (std::size_t i = 0; i < current.size(); i++)
+        {
+            if ((i + frame) % TELEPORT_EVERY == 0)
+            {
+                current[i] = {world(random), world(random)};
+            }
+            else
+            {
+                current[i] += glm::vec2(step(random), step(random));
+            }
+        }
+        scene.positions.push_back(current);
+
+        auto &queries = scene.queries.emplace_back(SWEEP_QUERY_COUNT);
+        for (auto &query : queries)
+        {
+            query = {world(random), world(random)};
+        }
+    }
+    return scene;
+}
+
+static glm::vec2 getViewMin(int frame)
+{
+    // The camera walks across the world
+    return glm::vec2(WORLD_SIZE * 0.25f) + glm::vec2((float) frame * 4.f);
+}
+
+static void benchmarkBefore(const Scene &scene, int frames)
+{
+    std::vector<Box> boxes;
+    double insert = measureMs([&] {
+        boxes.reserve(PROXY_COUNT);
+        for (auto position : scene.start)
+        {
+            boxes.push_back({position, position + PROXY_SIZE});
+        }
+        doNotOptimize(boxes[0]);
+    });
+
+    auto overlaps = [](const Box &box, glm::vec2 min, glm::vec2 max)
+    { return box.min.x <= max.x && min.x <= box.max.x && box.min.y <= max.y && min.y <= box.max.y; };
+
+    double move = 0.0;
+    double view = 0.0;
+    double sweeps = 0.0;
+    std::size_t found = 0;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        const auto &positions = scene.positions[frame];
+        move += measureMs([&] {
+            for (std::size_t i = 0; i < boxes.size(); i++)
+            {
+                boxes[i] = {positions[i], positions[i] + PROXY_SIZE};
+            }
+            doNotOptimize(boxes[0]);
+        });
+
+        glm::vec2 viewMin = getViewMin(frame);
+        view += measureMs([&] {
+            for (const auto &box : boxes)
+            {
+                found += overlaps(box, viewMin, viewMin + VIEW_SIZE);
+            }
+        });
+
+        sweeps += measureMs([&] {
+            for (auto query : scene.queries[frame])
+            {
+                for (const auto &box : boxes)
+                {
+                    found += overlaps(box, query, query + SWEEP_QUERY_SIZE);
+                }
+            }
+        });
+    }
+    doNotOptimize(found);
+
+    printResult("before, insert (array)", insert, "proxy", PROXY_COUNT);
+    printResult("before, move (per frame)", move / frames, "proxy", PROXY_COUNT);
+    printResult("before, camera query (per frame)", view / frames);
+    printResult("before, sweep queries (per frame)", sweeps / frames, "query", SWEEP_QUERY_COUNT);
+}
+
+static void benchmarkAfter(const Scene &scene, int frames)
+{
+    DynamicAabbTree<u32> tree(TREE_MARGIN);
+    std::vector<i32> proxies(PROXY_COUNT);
+    double insert = measureMs([&] {
+        for (u32 i = 0; i < PROXY_COUNT; i++)
+        {
+            proxies[i] = tree.insert(i, scene.start[i], scene.start[i] + PROXY_SIZE);
+        }
+        doNotOptimize(proxies[0]);
+    });
+
+    double move = 0.0;
+    double view = 0.0;
+    double sweeps = 0.0;
+    std::size_t found = 0;
+    std::size_t reinserted = 0;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        const auto &positions = scene.positions[frame];
+        move += measureMs([&] {
+            for (std::size_t i = 0; i < proxies.size(); i++)
+            {
+                reinserted += tree.move(proxies[i], positions[i], positions[i] + PROXY_SIZE);
+            }
+        });
+
+        glm::vec2 viewMin = getViewMin(frame);
+        view += measureMs([&] { tree.query(viewMin, viewMin + VIEW_SIZE, [&](u32 item) { found++; }); });
+
+        sweeps += measureMs([&] {
+            for (auto query : scene.queries[frame])
+            {
+                tree.query(query, query + SWEEP_QUERY_SIZE, [&](u32 item) { found++; });
+            }
+        });
+    }
+    doNotOptimize(found);
+
+    printResult("after, insert (tree)", insert, "proxy", PROXY_COUNT);
+    printResult("after, move (per frame)", move / frames, "proxy", PROXY_COUNT);
+    printResult("after, camera query (per frame)", view / frames);
+    printResult("after, sweep queries (per frame)", sweeps / frames, "query", SWEEP_QUERY_COUNT);
+    std::cout << "reinserted " << (double) reinserted / frames << " proxies per frame" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 20;
+
+    std::cout << PROXY_COUNT << " proxies, " << frames << " frames" << std::endl;
+    Scene scene = makeScene(frames);
+    benchmarkBefore(scene, frames);
+    benchmarkAfter(scene, frames);
+    return 0;
+}
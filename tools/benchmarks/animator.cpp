@@ -0,0 +1,360 @@
+// Animator benchmark: the transition checks and frame swaps of 10k animated entities.
+//
+// Usage: animator-benchmark [animator.yml] [frames]
+// The "before" rows run a copy of the old animator: conditions parsed into shared_ptr expression trees,
+// evaluated through virtual calls returning std::variant, with the parameters looked up by name.
+// The "after" rows run the compiled animator with the same loop as SpriteAnimatorSystem
+// (without the sprite update, it needs a GL context).
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <list>
+#include <memory>
+#include <set>
+#include <variant>
+
+#include <entt.hpp>
+
+#include "Benchmark.h"
+#include "../../src/pch.h"
+#include "../../src/utils/Animation.h"
+
+#define ENTITY_COUNT 10000
+#define FRAME_TIME (1.f / 60.f)
+
+// How many frames an entity keeps walking in one direction
+#define DIRECTION_FRAMES 30
+
+namespace before
+{
+using ValueType = std::variant<bool, float, glm::vec2>;
+using ParameterStorage = std::unordered_map<std::string, std::variant<glm::vec2>>;
+
+struct Expression
+{
+    virtual ValueType evaluate(const ParameterStorage &storage) = 0;
+    virtual ~Expression() = default;
+};
+
+struct FloatExpression : Expression
+{
+    ValueType evaluate(const ParameterStorage &storage) override { return value; }
+
+    float value{};
+};
+
+struct ParameterExpression : Expression
+{
+    ValueType evaluate(const ParameterStorage &storage) override
+    {
+        return std::visit([](auto value) { return value; }, storage.at(name));
+    }
+
+    std::string name;
+};
+
+struct AttributeExpression : Expression
+{
+    ValueType evaluate(const ParameterStorage &storage) override
+    {
+        auto leftValue = left->evaluate(storage);
+
+        return std::visit(
+            [&](auto value)
+            {
+                if constexpr (std::is_same_v<glm::vec2, decltype(value)>)
+                {
+                    if (right == "x")
+                    {
+                        return value.x;
+                    }
+
+                    if (right == "y")
+                    {
+                        return value.y;
+                    }
+                }
+
+                return 0.f;
+            },
+            leftValue);
+    }
+
+    std::shared_ptr<Expression> left;
+    std::string right;
+};
+
+template <typename Compare>
+struct CompareExpression : Expression
+{
+    ValueType evaluate(const ParameterStorage &storage) override
+    {
+        return Compare()(std::get<float>(left->evaluate(storage)), std::get<float>(right->evaluate(storage)));
+    }
+
+    std::shared_ptr<Expression> left;
+    std::shared_ptr<Expression> right;
+};
+
+std::shared_ptr<Expression> parseExpression(const std::set<std::string> &parameters, std::string_view type,
+                                            const YAML::Node &node)
+{
+    auto parseComparison = [&](auto comparison)
+    {
+        comparison->left = parseExpression(parameters, "l", node["l"]);
+        comparison->right = parseExpression(parameters, "r", node["r"]);
+        return comparison;
+    };
+
+    if (type == "lt") return parseComparison(std::make_shared<CompareExpression<std::less<float>>>());
+    if (type == "le") return parseComparison(std::make_shared<CompareExpression<std::less_equal<float>>>());
+    if (type == "gt") return parseComparison(std::make_shared<CompareExpression<std::greater<float>>>());
+    if (type == "ge") return parseComparison(std::make_shared<CompareExpression<std::greater_equal<float>>>());
+
+    if (type == "attr")
+    {
+        auto attr = std::make_shared<AttributeExpression>();
+        attr->left = parseExpression(parameters, "l", node["l"]);
+        attr->right = node["r"].as<std::string>();
+        return attr;
+    }
+
+    if (type == "l" || type == "r")
+    {
+        if (node.IsScalar())
+        {
+            auto value = node.as<std::string>();
+            if (parameters.find(value) != parameters.end())
+            {
+                auto parameterExpression = std::make_shared<ParameterExpression>();
+                parameterExpression->name = std::move(value);
+                return parameterExpression;
+            }
+
+            auto floatExpression = std::make_shared<FloatExpression>();
+            floatExpression->value = node.as<float>();
+            return floatExpression;
+        }
+
+        return parseExpression(parameters, node.begin()->first.as<std::string>(), node.begin()->second);
+    }
+
+    return std::make_shared<FloatExpression>();
+}
+
+struct Node;
+
+struct Transition
+{
+    Node *destination;
+    std::function<bool(const ParameterStorage &)> condition;
+};
+
+struct Node
+{
+    std::vector<SpriteAnimationFrame> frames;
+    std::vector<Transition *> fromTransitions;
+};
+
+struct Animator
+{
+    std::list<Node> nodes;
+    std::list<Transition> transitions;
+};
+
+struct AnimatorComponent
+{
+    const Animator *animator;
+    ParameterStorage parameterStorage;
+    Node *node;
+    std::size_t frame;
+    float time;
+};
+
+void parseAnimator(const std::string &source, Animator &animator)
+{
+    auto root = YAML::Load(source);
+    auto nodes = root["nodes"];
+
+    std::set<std::string> parameters;
+    for (auto p = root["parameters"].begin(); p != root["parameters"].end(); ++p)
+    {
+        parameters.insert(p->first.as<std::string>());
+    }
+
+    Node &entry = animator.nodes.emplace_back();
+    std::map<std::string, Node *> nodesByName;
+    for (auto n = nodes.begin(); n != nodes.end(); ++n)
+    {
+        Node &node = animator.nodes.emplace_back();
+        for (auto f = n->second["frames"].begin(); f != n->second["frames"].end(); ++f)
+        {
+            auto duration = (*f)["duration"];
+            node.frames.push_back({(*f)["rect"].as<IntRect>(),
+                                   duration.IsDefined() ? static_cast<float>(duration.as<int>()) * 1e-3f : 0.f});
+        }
+        nodesByName[n->first.as<std::string>()] = &node;
+    }
+
+    for (auto n = nodes.begin(); n != nodes.end(); ++n)
+    {
+        Node *source = nodesByName.at(n->first.as<std::string>());
+        if (n->second["entry"].IsDefined() && n->second["entry"].as<bool>())
+        {
+            entry.fromTransitions.push_back(
+                &animator.transitions.emplace_back(Transition{source, [](const auto &) { return true; }}));
+        }
+
+        for (auto t = n->second["transitions"].begin(); t != n->second["transitions"].end(); ++t)
+        {
+            auto conditionNode = (*t)["condition"];
+            auto expression = parseExpression(parameters, conditionNode.begin()->first.as<std::string>(),
+                                              conditionNode.begin()->second);
+            auto condition = [e = std::move(expression)](const ParameterStorage &storage)
+            { return std::get<bool>(e->evaluate(storage)); };
+
+            source->fromTransitions.push_back(&animator.transitions.emplace_back(
+                Transition{nodesByName.at((*t)["to"].as<std::string>()), std::move(condition)}));
+        }
+    }
+}
+} // namespace before
+
+// Every entity walks in one of the directions or stands still, and changes it from time to time
+static glm::vec2 getVelocity(std::size_t entity, int frame)
+{
+    static const glm::vec2 directions[] = {{0.f, 0.f}, {-1.f, 0.f}, {1.f, 0.f}, {0.f, 1.f}, {0.f, -1.f}};
+    return directions[(entity + frame / DIRECTION_FRAMES) % 5] * 100.f;
+}
+
+static double benchmarkBefore(const std::string &source, int frames)
+{
+    before::Animator animator;
+    before::parseAnimator(source, animator);
+
+    entt::registry registry;
+    for (std::size_t i = 0; i < ENTITY_COUNT; i++)
+    {
+        auto &component = registry.emplace<before::AnimatorComponent>(registry.create());
+        component.animator = &animator;
+        component.parameterStorage.emplace("velocity", glm::vec2{});
+        component.node = &animator.nodes.front();
+        component.frame = 0;
+        component.time = 0.f;
+    }
+
+    return measureMs([&] {
+        for (int frame = 0; frame < frames; frame++)
+        {
+            auto view = registry.view<before::AnimatorComponent>();
+            for (auto [entity, component] : view.each())
+            {
+                component.parameterStorage["velocity"] = getVelocity(entt::to_integral(entity), frame);
+
+                auto conditionMet = [&](before::Transition *t) { return t->condition(component.parameterStorage); };
+                while (true)
+                {
+                    auto &fromTransitions = component.node->fromTransitions;
+                    auto found = std::find_if(fromTransitions.begin(), fromTransitions.end(), conditionMet);
+                    if (found == fromTransitions.end()) break;
+
+                    component.node = (*found)->destination;
+                    component.frame = 0;
+                    component.time = 0;
+                }
+
+                auto &nodeFrames = component.node->frames;
+                if (nodeFrames.empty()) continue;
+
+                component.time += FRAME_TIME;
+                while (nodeFrames[component.frame].duration < component.time)
+                {
+                    float leftTime = nodeFrames[component.frame].duration - component.time;
+                    component.frame = (component.frame + 1) % nodeFrames.size();
+                    component.time = leftTime;
+                }
+            }
+        }
+    });
+}
+
+static double benchmarkAfter(const std::string &source, int frames)
+{
+    SpriteAnimator animator = Animation::parseAnimator(source);
+    auto velocity = animator.getParameter<glm::vec2>("velocity");
+
+    entt::registry registry;
+    for (std::size_t i = 0; i < ENTITY_COUNT; i++)
+    {
+        auto &component = registry.emplace<SpriteAnimatorComponent>(registry.create());
+        component.animator = &animator;
+        component.parameterStorage = {};
+        component.node = SPRITE_ANIMATOR_ENTRY_NODE;
+        component.frame = 0;
+        component.time = 0.f;
+        component.frameChanged = false;
+        component.gpuAnimation = false;
+    }
+
+    return measureMs([&] {
+        for (int frame = 0; frame < frames; frame++)
+        {
+            auto view = registry.view<SpriteAnimatorComponent>();
+            for (auto [entity, component] : view.each())
+            {
+                component.parameterStorage.set(velocity, getVelocity(entt::to_integral(entity), frame));
+                component.parameterStorage.changed = false;
+
+                u16 node = component.node;
+                for (std::size_t i = 0; i < animator.nodes.size(); i++)
+                {
+                    u16 next = animator.findTransition(node, component.parameterStorage);
+                    if (next == node) break;
+                    node = next;
+                }
+
+                const SpriteAnimatorNode &activeNode = animator.nodes[node];
+                if (node != component.node)
+                {
+                    component.node = node;
+                    component.frame = activeNode.firstFrame;
+                    component.time = 0;
+                    component.frameChanged = activeNode.frameCount != 0;
+                }
+                if (activeNode.frameCount == 0) continue;
+
+                component.time += FRAME_TIME;
+                while (animator.frames[component.frame].duration < component.time)
+                {
+                    float leftTime = animator.frames[component.frame].duration - component.time;
+                    u16 index = component.frame - activeNode.firstFrame;
+                    component.frame = activeNode.firstFrame + (index + 1) % activeNode.frameCount;
+                    component.time = leftTime;
+                    component.frameChanged = true;
+                }
+            }
+        }
+    });
+}
+
+int main(int argc, char **argv)
+{
+    std::string path = argc > 1 ? argv[1] : TRUERPG_RES_DIR "/animators/character.yml";
+    int frames = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 600;
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cout << "Failed to open the animator " << path << std::endl;
+        return 1;
+    }
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::cout << ENTITY_COUNT << " animated entities, " << frames << " frames" << std::endl;
+    double before = benchmarkBefore(source, frames);
+    double after = benchmarkAfter(source, frames);
+    printResult("before, expression trees (per frame)", before / frames, "entity", (double) ENTITY_COUNT);
+    printResult("after, compiled conditions (per frame)", after / frames, "entity", (double) ENTITY_COUNT);
+    return 0;
+}
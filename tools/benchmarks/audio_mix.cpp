@@ -0,0 +1,194 @@
+// Audio mix benchmark: the cost of mixing 256 voices at once.
+//
+// Usage: audio-mix-benchmark [seconds]
+// The kernel rows compare the old per-voice mix loop (an allocation per voice and callback, the pan gains computed
+// per sample) with AudioMixer. The device rows render sine voices through an offline AudioDevice,
+// once with every voice decoded and once with the default number of real voices.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "../../src/client/audio/AudioDevice.h"
+#include "../../src/client/audio/AudioMixer.h"
+
+#define VOICE_COUNT MAX_VOICES
+
+// An endless sine wave, so the voices never run out of sound
+class SineAudioClip : public IAudioClip
+{
+    ma_uint32 m_sampleRate;
+    double m_frequency;
+
+public:
+    SineAudioClip(ma_uint32 sampleRate, double frequency)
+        : m_sampleRate(sampleRate),
+          m_frequency(frequency) {}
+
+    std::string getPath() const override
+    {
+        return "sine";
+    }
+
+protected:
+    ma_data_source *createDataSource() const override
+    {
+        auto *waveform = new ma_waveform();
+        ma_waveform_config config = ma_waveform_config_init(FORMAT, CHANNELS, m_sampleRate, ma_waveform_type_sine, 0.2,
+                                                            m_frequency);
+        if (ma_waveform_init(&config, waveform) != MA_SUCCESS)
+        {
+            delete waveform;
+            return nullptr;
+        }
+        return waveform;
+    }
+
+    void destroyDataSource(ma_data_source *dataSource) const override
+    {
+        auto *waveform = (ma_waveform *) dataSource;
+        ma_waveform_uninit(waveform);
+        delete waveform;
+    }
+};
+
+struct KernelVoice
+{
+    float volume;
+    float pan;
+};
+
+// The mix loop before the rework, the input read is replaced with a copy
+static void mixBefore(const KernelVoice &voice, const float *input, float *pOutputF32, ma_uint32 frameCount)
+{
+    auto *temp = new float[frameCount * CHANNELS];
+    std::copy(input, input + frameCount * CHANNELS, temp);
+
+    for (ma_uint32 sample = 0; sample < frameCount * CHANNELS; sample += CHANNELS)
+    {
+        float left = 1 - std::clamp(voice.pan, 0.f, 1.f);
+        pOutputF32[sample] += voice.volume * left * temp[sample];
+        float right = 1 - std::abs(std::clamp(voice.pan, -1.f, 0.f));
+        pOutputF32[sample + 1] += voice.volume * right * temp[sample + 1];
+    }
+
+    delete[] temp;
+}
+
+static void mixAfter(const KernelVoice &voice, const float *input, float *scratch, float *pOutputF32,
+                     ma_uint32 frameCount)
+{
+    std::copy(input, input + frameCount * CHANNELS, scratch);
+
+    float left = voice.volume * (1.f - std::clamp(voice.pan, 0.f, 1.f));
+    float right = voice.volume * (1.f + std::clamp(voice.pan, -1.f, 0.f));
+    AudioMixer::mixStereo(pOutputF32, scratch, frameCount, left, right, left, right);
+}
+
+static void benchmarkKernel(double seconds)
+{
+    const auto totalFrames = (ma_uint64) (seconds * SAMPLE_RATE);
+    const ma_uint64 blockCount = totalFrames / MIX_BLOCK_FRAMES;
+
+    std::vector<KernelVoice> voices(VOICE_COUNT);
+    std::vector<float> input(MIX_BLOCK_FRAMES * CHANNELS);
+    for (std::size_t i = 0; i < voices.size(); i++)
+    {
+        voices[i] = {0.5f + 0.5f * (float) (i % 7) / 7.f, (float) (i % 21) / 10.f - 1.f};
+    }
+    for (std::size_t i = 0; i < input.size(); i++)
+    {
+        input[i] = 0.2f * std::sin((float) i * 0.05f);
+    }
+
+    std::vector<float> output(MIX_BLOCK_FRAMES * CHANNELS);
+    std::vector<float> scratch(MIX_BLOCK_FRAMES * CHANNELS);
+
+    double before = measureMs([&] {
+        for (ma_uint64 block = 0; block < blockCount; block++)
+        {
+            std::fill(output.begin(), output.end(), 0.f);
+            for (const auto &voice : voices)
+            {
+                mixBefore(voice, input.data(), output.data(), MIX_BLOCK_FRAMES);
+            }
+            doNotOptimize(output[0]);
+        }
+    });
+
+    float limiterGain = 1.f;
+    double after = measureMs([&] {
+        for (ma_uint64 block = 0; block < blockCount; block++)
+        {
+            std::fill(output.begin(), output.end(), 0.f);
+            for (const auto &voice : voices)
+            {
+                mixAfter(voice, input.data(), scratch.data(), output.data(), MIX_BLOCK_FRAMES);
+            }
+            AudioMixer::limit(output.data(), MIX_BLOCK_FRAMES, SAMPLE_RATE, limiterGain);
+            doNotOptimize(output[0]);
+        }
+    });
+
+    // Per second of mixed audio, it's what the audio thread has to fit into one second
+    printResult("kernel, before (256 voices, per s of audio)", before / seconds);
+    printResult("kernel, after (256 voices, per s of audio)", after / seconds);
+}
+
+static void benchmarkDevice(double seconds, u32 maxRealVoices, bool resample)
+{
+    std::string wavPath = "audio-mix-benchmark.wav";
+
+    // Half of the clips have another rate, so those voices go through the resampler
+    std::vector<std::unique_ptr<SineAudioClip>> clips;
+    std::vector<std::unique_ptr<AudioSource>> sources;
+    for (int i = 0; i < VOICE_COUNT; i++)
+    {
+        ma_uint32 sampleRate = resample && i % 2 ? 44100 : SAMPLE_RATE;
+        clips.push_back(std::make_unique<SineAudioClip>(sampleRate, 110.0 + i * 3.0));
+        sources.push_back(std::make_unique<AudioSource>(*clips.back()));
+    }
+
+    double mixMs;
+    {
+        AudioDevice device(wavPath, false);
+        device.setMaxRealVoices(maxRealVoices);
+        for (int i = 0; i < VOICE_COUNT; i++)
+        {
+            AudioSource &source = *sources[i];
+            source.setVolume(0.5f + 0.5f * (float) (i % 7) / 7.f);
+            source.setPan((float) (i % 21) / 10.f - 1.f);
+            source.setLoop(true);
+            device.add(source);
+            source.play();
+        }
+        device.updateVoices();
+        device.render((ma_uint32) (seconds * SAMPLE_RATE));
+        mixMs = device.getMixStats().seconds * 1000.0;
+
+        device.clear();
+        device.update();
+    }
+    std::remove(wavPath.c_str());
+
+    std::string name = "device, " + std::to_string(maxRealVoices) + " real voices" + (resample ? ", resampled" : "") +
+                       " (per s of audio)";
+    printResult(name, mixMs / seconds);
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? std::max(std::atof(argv[1]), 0.1) : 10.0;
+
+    std::cout << "Mixing " << VOICE_COUNT << " voices, " << seconds << " s of audio" << std::endl;
+    benchmarkKernel(seconds);
+    benchmarkDevice(seconds, VOICE_COUNT, false);
+    benchmarkDevice(seconds, VOICE_COUNT, true);
+    benchmarkDevice(seconds, DEFAULT_MAX_REAL_VOICES, false);
+    return 0;
+}
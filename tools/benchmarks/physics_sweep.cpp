@@ -0,0 +1,231 @@
+// Physics sweep benchmark: the solver cost per moving body.
+//
+// Usage: physics-sweep-benchmark [frames]
+// A few thousand bots walk between a grid of walls and turn from time to time, so they keep hitting them.
+// The "before" rows run a copy of the old solver: every collider synced into one tree each frame
+// and the body put back to its old position on any overlap. The "after" rows run PhysicsSystem
+// with the per-axis sweeps, the static tree and the sleeping bodies.
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <entt.hpp>
+
+#include "Benchmark.h"
+#include "../../src/pch.h"
+#include "../../src/components/basic/TransformComponent.h"
+#include "../../src/components/physics/RectColliderComponent.h"
+#include "../../src/components/physics/RigidbodyComponent.h"
+#include "../../src/systems/physics/PhysicsSystem.h"
+
+#define BODY_COUNT 5000
+#define FRAME_TIME (1.f / 60.f)
+
+// The walls are blocks of a grid, the bots walk in the corridors between them
+#define WALL_GRID 100
+#define WALL_SIZE 64.f
+#define WALL_SPACING 160.f
+#define BODY_SIZE 24.f
+#define BODY_SPEED 200.f
+
+// How many frames a bot keeps walking in one direction
+#define TURN_FRAMES 30
+
+namespace before
+{
+struct ColliderProxyComponent
+{
+    i32 proxy{AABB_TREE_NULL};
+};
+
+FloatRect getColliderRect(entt::registry &registry, entt::entity entity, glm::vec2 position)
+{
+    auto &rectCollider = registry.get<RectColliderComponent>(entity);
+    return {position.x + rectCollider.offset.x, position.y + rectCollider.offset.y, rectCollider.size.x,
+            rectCollider.size.y};
+}
+
+void syncCollider(entt::registry &registry, DynamicAabbTree<entt::entity> &tree, entt::entity entity,
+                  glm::vec2 position)
+{
+    auto &instance = registry.get_or_emplace<ColliderProxyComponent>(entity);
+    FloatRect rect = getColliderRect(registry, entity, position);
+    glm::vec2 min(rect.getLeft(), rect.getBottom());
+    glm::vec2 max = min + glm::vec2(rect.getWidth(), rect.getHeight());
+
+    if (instance.proxy == AABB_TREE_NULL)
+    {
+        instance.proxy = tree.insert(entity, min, max);
+    }
+    else
+    {
+        tree.move(instance.proxy, min, max);
+    }
+}
+
+void update(entt::registry &registry, DynamicAabbTree<entt::entity> &tree, float deltaTime)
+{
+    auto colliderView = registry.view<RectColliderComponent>();
+    for (auto entity : colliderView)
+    {
+        syncCollider(registry, tree, entity, registry.get<TransformComponent>(entity).position);
+    }
+
+    auto view = registry.view<RigidbodyComponent>();
+    for (auto entity : view)
+    {
+        auto &rigidbody = view.get<RigidbodyComponent>(entity);
+        auto &transform = registry.get<TransformComponent>(entity);
+
+        glm::vec2 nextPos = transform.position + rigidbody.velocity * deltaTime;
+
+        if (registry.all_of<RectColliderComponent>(entity))
+        {
+            FloatRect rect = getColliderRect(registry, entity, nextPos);
+            glm::vec2 min(rect.getLeft(), rect.getBottom());
+            glm::vec2 max = min + glm::vec2(rect.getWidth(), rect.getHeight());
+
+            tree.query(min, max, [&](entt::entity otherEntity)
+            {
+                if (entity == otherEntity) return;
+
+                auto &otherTransform = registry.get<TransformComponent>(otherEntity);
+                bool collide = getColliderRect(registry, entity, nextPos)
+                        .intersects(getColliderRect(registry, otherEntity, otherTransform.position));
+
+                if (collide)
+                {
+                    nextPos = transform.position;
+                }
+            });
+
+            syncCollider(registry, tree, entity, nextPos);
+        }
+        transform.position = nextPos;
+    }
+}
+} // namespace before
+
+// Every bot walks along one of the diagonals and changes it from time to time
+static glm::vec2 getVelocity(std::size_t body, int frame)
+{
+    static const glm::vec2 directions[] = {{1.f, 1.f}, {-1.f, 1.f}, {-1.f, -1.f}, {1.f, -1.f}, {1.f, 0.f}};
+    return directions[(body + frame / TURN_FRAMES) % 5] * BODY_SPEED;
+}
+
+static std::vector<entt::entity> createScene(entt::registry &registry)
+{
+    for (int y = 0; y < WALL_GRID; y++)
+    {
+        for (int x = 0; x < WALL_GRID; x++)
+        {
+            auto wall = registry.create();
+            registry.emplace<TransformComponent>(wall).position = glm::vec2(x, y) * WALL_SPACING;
+            registry.emplace<RectColliderComponent>(wall, glm::vec2(0.f), glm::vec2(WALL_SIZE));
+        }
+    }
+
+    // The bots start in the corridors, one in a cell at most
+    std::mt19937 random(42);
+    std::vector<int> cells(WALL_GRID * WALL_GRID);
+    for (std::size_t i = 0; i < cells.size(); i++)
+    {
+        cells[i] = (int) i;
+    }
+    std::shuffle(cells.begin(), cells.end(), random);
+
+    std::vector<entt::entity> bodies;
+    for (int i = 0; i < BODY_COUNT; i++)
+    {
+        glm::vec2 position = glm::vec2(cells[i] % WALL_GRID, cells[i] / WALL_GRID) * WALL_SPACING +
+                             glm::vec2(WALL_SIZE + (WALL_SPACING - WALL_SIZE - BODY_SIZE) / 2.f);
+
+        auto body = registry.create();
+        registry.emplace<TransformComponent>(body).position = position;
+        registry.emplace<RectColliderComponent>(body, glm::vec2(0.f), glm::vec2(BODY_SIZE));
+        registry.emplace<RigidbodyComponent>(body);
+        bodies.push_back(body);
+    }
+    return bodies;
+}
+
+// The bodies which ended up inside a wall, a solver which lets them tunnel shows it here
+static int countStuck(entt::registry &registry, const std::vector<entt::entity> &bodies)
+{
+    int stuck = 0;
+    for (auto body : bodies)
+    {
+        glm::vec2 position = registry.get<TransformComponent>(body).position;
+        FloatRect rect(position.x, position.y, BODY_SIZE, BODY_SIZE);
+
+        glm::ivec2 cell(glm::floor(position / WALL_SPACING));
+        bool inWall = false;
+        for (int y = cell.y; y <= cell.y + 1; y++)
+        {
+            for (int x = cell.x; x <= cell.x + 1; x++)
+            {
+                FloatRect wall((float) x * WALL_SPACING, (float) y * WALL_SPACING, WALL_SIZE, WALL_SIZE);
+                bool isWall = x >= 0 && y >= 0 && x < WALL_GRID && y < WALL_GRID;
+                inWall = inWall || (isWall && rect.intersects(wall));
+            }
+        }
+        stuck += inWall;
+    }
+    return stuck;
+}
+
+static double benchmarkBefore(int frames)
+{
+    entt::registry registry;
+    std::vector<entt::entity> bodies = createScene(registry);
+    DynamicAabbTree<entt::entity> tree(PHYSICS_TREE_MARGIN);
+
+    double ms = measureMs([&] {
+        for (int frame = 0; frame < frames; frame++)
+        {
+            for (std::size_t i = 0; i < bodies.size(); i++)
+            {
+                registry.get<RigidbodyComponent>(bodies[i]).velocity = getVelocity(i, frame);
+            }
+            before::update(registry, tree, FRAME_TIME);
+        }
+    });
+    std::cout << "before: " << countStuck(registry, bodies) << " bodies inside a wall" << std::endl;
+    return ms;
+}
+
+static double benchmarkAfter(int frames)
+{
+    // The system has to see the colliders being added
+    entt::registry registry;
+    PhysicsSystem physicsSystem(registry);
+    std::vector<entt::entity> bodies = createScene(registry);
+
+    double ms = measureMs([&] {
+        for (int frame = 0; frame < frames; frame++)
+        {
+            for (std::size_t i = 0; i < bodies.size(); i++)
+            {
+                registry.get<RigidbodyComponent>(bodies[i]).velocity = getVelocity(i, frame);
+            }
+            physicsSystem.update(FRAME_TIME);
+        }
+    });
+    std::cout << "after: " << countStuck(registry, bodies) << " bodies inside a wall" << std::endl;
+    physicsSystem.destroy();
+    return ms;
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 600;
+
+    std::cout << BODY_COUNT << " bodies, " << WALL_GRID * WALL_GRID << " walls, " << frames << " frames" << std::endl;
+    double before = benchmarkBefore(frames);
+    double after = benchmarkAfter(frames);
+    printResult("before, reset on overlap (per frame)", before / frames, "body", BODY_COUNT);
+    printResult("after, per-axis sweeps (per frame)", after / frames, "body", BODY_COUNT);
+    return 0;
+}
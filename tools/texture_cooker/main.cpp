@@ -0,0 +1,296 @@
+// Texture cooker: converts images into the .rtex container that Texture::create loads with a single mmap.
+//
+// Usage: texture-cooker [--mips] [--bc3] <image>...
+// The output is written next to the input, "base.png" becomes "base.rtex".
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <stb_image.h>
+
+#include "../../src/client/graphics/TextureContainer.h"
+
+struct Image
+{
+    u32 width;
+    u32 height;
+    std::vector<u8> pixels; // RGBA8
+};
+
+// Box filter, the odd row/column is just dropped
+static Image downsample(const Image &image)
+{
+    Image result{std::max(image.width / 2, 1u), std::max(image.height / 2, 1u), {}};
+    result.pixels.resize(result.width * result.height * 4);
+
+    for (u32 y = 0; y < result.height; y++)
+    {
+        for (u32 x = 0; x < result.width; x++)
+        {
+            for (u32 c = 0; c < 4; c++)
+            {
+                u32 sum = 0;
+                for (u32 dy = 0; dy < 2; dy++)
+                {
+                    for (u32 dx = 0; dx < 2; dx++)
+                    {
+                        u32 sx = std::min(x * 2 + dx, image.width - 1);
+                        u32 sy = std::min(y * 2 + dy, image.height - 1);
+                        sum += image.pixels[(sy * image.width + sx) * 4 + c];
+                    }
+                }
+                result.pixels[(y * result.width + x) * 4 + c] = (u8) ((sum + 2) / 4);
+            }
+        }
+    }
+    return result;
+}
+
+static u16 toRgb565(const u8 *color)
+{
+    return (u16) (((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+}
+
+static void fromRgb565(u16 value, int *color)
+{
+    int r = (value >> 11) & 31;
+    int g = (value >> 5) & 63;
+    int b = value & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// A simple BC3 encoder: the endpoints are the bounding box of the block, every texel takes the closest palette entry.
+// It isn't the best quality, but it's fast and good enough for flat pixel art.
+static void encodeBlock(const u8 *block, u8 *out)
+{
+    // Alpha: 8 interpolated values between max and min
+    u8 minAlpha = 255;
+    u8 maxAlpha = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        minAlpha = std::min(minAlpha, block[i * 4 + 3]);
+        maxAlpha = std::max(maxAlpha, block[i * 4 + 3]);
+    }
+    out[0] = maxAlpha;
+    out[1] = minAlpha;
+
+    u64 alphaBits = 0;
+    if (maxAlpha != minAlpha)
+    {
+        int range = maxAlpha - minAlpha;
+        for (int i = 0; i < 16; i++)
+        {
+            // 0 is the min, 7 is the max, the palette order is max, min, then from max to min
+            int step = ((block[i * 4 + 3] - minAlpha) * 7 + range / 2) / range;
+            u64 index = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+            alphaBits |= index << (3 * i);
+        }
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        out[2 + i] = (u8) (alphaBits >> (8 * i));
+    }
+
+    // Color: 4 colors between two RGB565 endpoints
+    u8 minColor[3] = {255, 255, 255};
+    u8 maxColor[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            minColor[c] = std::min(minColor[c], block[i * 4 + c]);
+            maxColor[c] = std::max(maxColor[c], block[i * 4 + c]);
+        }
+    }
+
+    u16 color0 = toRgb565(maxColor);
+    u16 color1 = toRgb565(minColor);
+    if (color0 < color1) std::swap(color0, color1);
+
+    int palette[4][3];
+    fromRgb565(color0, palette[0]);
+    fromRgb565(color1, palette[1]);
+    for (int c = 0; c < 3; c++)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    u32 colorBits = 0;
+    if (color0 != color1)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            u32 best = 0;
+            int bestDistance = INT32_MAX;
+            for (u32 p = 0; p < 4; p++)
+            {
+                int distance = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    int d = block[i * 4 + c] - palette[p][c];
+                    distance += d * d;
+                }
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            colorBits |= best << (2 * i);
+        }
+    }
+
+    out[8] = (u8) color0;
+    out[9] = (u8) (color0 >> 8);
+    out[10] = (u8) color1;
+    out[11] = (u8) (color1 >> 8);
+    for (int i = 0; i < 4; i++)
+    {
+        out[12 + i] = (u8) (colorBits >> (8 * i));
+    }
+}
+
+static std::vector<u8> encodeBc3(const Image &image)
+{
+    u32 blocksX = (image.width + 3) / 4;
+    u32 blocksY = (image.height + 3) / 4;
+    std::vector<u8> result(blocksX * blocksY * 16);
+
+    u8 block[16 * 4];
+    for (u32 by = 0; by < blocksY; by++)
+    {
+        for (u32 bx = 0; bx < blocksX; bx++)
+        {
+            // Blocks on the edge repeat the last texel
+            for (u32 y = 0; y < 4; y++)
+            {
+                for (u32 x = 0; x < 4; x++)
+                {
+                    u32 sx = std::min(bx * 4 + x, image.width - 1);
+                    u32 sy = std::min(by * 4 + y, image.height - 1);
+                    std::memcpy(&block[(y * 4 + x) * 4], &image.pixels[(sy * image.width + sx) * 4], 4);
+                }
+            }
+            encodeBlock(block, &result[(by * blocksX + bx) * 16]);
+        }
+    }
+    return result;
+}
+
+static bool cook(const std::string &path, bool mips, bool bc3)
+{
+    int width;
+    int height;
+    int channels;
+
+    // Flip the rows right here, so the game doesn't need to
+    stbi_set_flip_vertically_on_load(1);
+    u8 *data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+    if (!data)
+    {
+        std::cerr << "Failed to load " << path << std::endl;
+        return false;
+    }
+
+    std::vector<Image> levels;
+    levels.push_back({(u32) width, (u32) height, std::vector<u8>(data, data + width * height * 4)});
+    stbi_image_free(data);
+
+    while (mips && (levels.back().width > 1 || levels.back().height > 1))
+    {
+        levels.push_back(downsample(levels.back()));
+    }
+
+    std::vector<std::vector<u8>> payloads;
+    for (const auto &level : levels)
+    {
+        payloads.push_back(bc3 ? encodeBc3(level) : level.pixels);
+    }
+
+    // The game checks the cooked file against the image it was made from
+    std::ifstream sourceFile(path, std::ios::binary);
+    std::vector<u8> source((std::istreambuf_iterator<char>(sourceFile)), std::istreambuf_iterator<char>());
+
+    RtexHeader header{};
+    header.magic = RTEX_MAGIC;
+    header.version = RTEX_VERSION;
+    header.format = bc3 ? RtexFormat::BC3 : RtexFormat::RGBA8;
+    header.width = (u32) width;
+    header.height = (u32) height;
+    header.mipCount = (u32) levels.size();
+    header.sourceHash = Hash::fnv1a(source.data(), source.size());
+    header.sourceSize = (u32) source.size();
+
+    std::vector<RtexMip> mipTable;
+    u32 offset = (u32) (sizeof(RtexHeader) + levels.size() * sizeof(RtexMip));
+    for (std::size_t i = 0; i < levels.size(); i++)
+    {
+        mipTable.push_back({offset, (u32) payloads[i].size(), levels[i].width, levels[i].height});
+        // Both payload sizes are multiples of 4, so every mip stays aligned
+        offset += (u32) payloads[i].size();
+    }
+
+    std::string outputPath = std::filesystem::path(path).replace_extension(".rtex").string();
+    std::ofstream output(outputPath, std::ios::binary);
+    if (!output)
+    {
+        std::cerr << "Failed to write " << outputPath << std::endl;
+        return false;
+    }
+    output.write((const char *) &header, sizeof(header));
+    output.write((const char *) mipTable.data(), (std::streamsize) (mipTable.size() * sizeof(RtexMip)));
+    for (const auto &payload : payloads)
+    {
+        output.write((const char *) payload.data(), (std::streamsize) payload.size());
+    }
+
+    std::cout << path << " -> " << outputPath << " (" << width << "x" << height << ", " << levels.size() << " mips, "
+              << (bc3 ? "BC3" : "RGBA8") << ", " << offset / 1024 << " KiB)" << std::endl;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    bool mips = false;
+    bool bc3 = false;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--mips")
+        {
+            mips = true;
+        }
+        else if (arg == "--bc3")
+        {
+            bc3 = true;
+        }
+        else
+        {
+            inputs.push_back(arg);
+        }
+    }
+
+    if (inputs.empty())
+    {
+        std::cout << "Usage: " << argv[0] << " [--mips] [--bc3] <image>..." << std::endl;
+        return 1;
+    }
+
+    bool success = true;
+    for (const auto &input : inputs)
+    {
+        success &= cook(input, mips, bc3);
+    }
+    return success ? 0 : 1;
+}